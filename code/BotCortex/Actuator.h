@@ -40,6 +40,10 @@ class Actuator
 		void changeAngle(float angle,uint32_t pDuration_ms) {
 			drive()->changeAngle(angle,pDuration_ms);
 		};
+		// reach the angle at the passed time, after all movements that are queued already
+		void appendAngle(float angle,uint32_t pTime_ms) {
+			drive()->appendAngle(angle,pTime_ms);
+		};
 		float getCurrentAngle() {
 			return drive()->getCurrentAngle();
 		}
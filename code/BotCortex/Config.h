@@ -27,10 +27,13 @@
 #define SERVO_SAMPLE_RATE  56				// every [ms] the motors get a new position. 11.2ms is the unit Herkulex servos are working with, sample rate should be a multiple of that
 #define SERVO_MOVE_DURATION 12				// herkulex servos have their own PID controller, so we need to add some time to a sample to make the movement smooth.
 #define PIBOT_PULSE_WIDTH_US 2				// pulse width of one step which can be recognized by PiBot Driver (I tried this out)
+#define STEP_TIMER_PERIOD_US 20				// [us] tick of the step generator, an impulse is high for one tick, so this limits the step rate to 25KHz
+#define STEP_TIMER_PRIORITY 32				// steps interrupt the UARTs and I2C (lower number is higher priority)
 
 #define I2C_BUS_RATE I2C_RATE_400			// frequency of i2c bus (1MHz KHz)
 #define I2C_BUS_TYPE I2C_OP_MODE_ISR		// I2C library is using interrupts
 #define ENCODER_FILTER_RESPONSE_TIME 5		// complementary filter of rotary encoder has this response time in [ms]
+#define ENCODER_SAMPLE_TIMEOUT 5			// [ms] a non-blocking encoder reading taking longer than this has failed
 
 #define HAND_HERKULEX_MOTOR_ID    0xFD		// this is the HERKULEX_BROADCAST_ID used for all servos
 #define GRIPPER_HERKULEX_MOTOR_ID 0xFC		// this ID has been programmed into the gripper servo explicitly
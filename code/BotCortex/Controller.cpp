@@ -16,30 +16,21 @@
 #include "core.h"
 #include "limits.h"
 #include "LightsController.h"
+#include "StepGenerator.h"
+#include "EncoderSampler.h"
 
 Controller controller;
 TimePassedBy servoLoopTimer;
 TimePassedBy encoderLoopTimer;
 bool adjustWhat = false;
 
-// stepperloop needs to be called as often as possible, since the stepper impulse has to happen at 5000Hz at top speed
-// So, call that whereever you can, even during delay() 
-void plainStepperLoop() {
-	controller.stepperLoop(); // take care that nothing happens inside until everything is properly initialized
-}
-
-// yield is called in delay(), used to leverage breaks during serial communication time
-void yield() {
-	controller.stepperLoop();
-}
-
 Controller::Controller()
 {
 	currentMotor = NULL;				// current motor used for manual control
 	numberOfActuators = 0;				// number of motors that have been initialized
 	numberOfEncoders = 0;				// number of rotary encoders that have been initialized
 	numberOfSteppers = 0;				// number of steppers that have been initialized
-	setuped= false;						// flag to indicate a finished setup (used in stepperloop())
+	setuped= false;						// flag to indicate a finished setup
 	enabled = false;					// motors are disabled until explicitly enabled
 }
 
@@ -182,6 +173,10 @@ bool Controller::setup(bool force /* =false */) {
 		logger->println(F("--- initializing actuators"));
 	}
 
+	// steppers add themselves to the step generator
+	stepGenerator.setup();
+	encoderSampler.setup();
+
 	for (numberOfActuators = 0;numberOfActuators<MAX_ACTUATORS;numberOfActuators++) {
 		watchdogReset(); // this takes a bit longer, kick the dog regularly
 
@@ -250,6 +245,10 @@ bool Controller::setup(bool force /* =false */) {
 				logFatal(F("unknown actuator type"));
 		}
 	}
+	// step impulses are generated in a timer interrupt
+	if (!stepGenerator.begin())
+		logFatal(F("no timer for steps"));
+
 	// get measurement of encoder and ensure that it is plausible 
 	// (variance of a couple of samples needs to be low)
 	for (int i = 0;i<numberOfEncoders;i++) {
@@ -265,6 +264,10 @@ bool Controller::setup(bool force /* =false */) {
 			logger->println(F(" ok"));
 		}
 	}
+
+	// from now on, encoders are read in the background, the sampler's numbering is the same
+	for (int i = 0;i<numberOfEncoders;i++)
+		encoderSampler.addEncoder(&encoders[i]);
 	
 	// set measured angle of the actuators and define that angle as current position by setting the movement
 	for (int i = 0;i<numberOfActuators;i++) {
@@ -366,16 +369,9 @@ void Controller::switchServoPowerSupply(bool on) {
 }
 
 
-void Controller::stepperLoop() {
-	if (isSetup()) {
-		for (int currentStepper = 0;currentStepper<numberOfSteppers;currentStepper++)
-			steppers[currentStepper].loop();
-	}
-}
-
 void Controller::loop(uint32_t now) {
-
-	stepperLoop(); // send impulses to steppers
+	// continue reading the encoders
+	encoderSampler.loop();
 
 	// check the manual control by knob
 	if (currentMotor != NULL) {
@@ -415,7 +411,6 @@ void Controller::loop(uint32_t now) {
 	// update the servo position
 	if (servoLoopTimer.isDue_ms(SERVO_SAMPLE_RATE,now)) {
 		servos[0].loop(millis());
-		stepperLoop(); // meanwhile, send impulses to steppers
 		servos[1].loop(millis());
 	}
 
@@ -435,19 +430,24 @@ void Controller::loop(uint32_t now) {
 					logFatal(F("wrong stepper identified"));
 				}
 				bool angleFromEncoderIsOk = false;
+				bool sampleIsFresh = true;
 				if (encoders[encoderIdx].isOk()) {
-					// encoders needs some delay between being asked, otherwise
-					// many communication failure happen
-					angleFromEncoderIsOk = encoders[encoderIdx].readNewAngleFromSensor(); // measure the encoder's angle
+					// take the latest reading of the sampler. Without a new one the stepper keeps
+					// its speed, a stale angle would make the controller correct the same error twice
+					EncoderSample sample;
+					sampleIsFresh = encoderSampler.getSample(encoderIdx, sample);
+					if (sampleIsFresh)
+						angleFromEncoderIsOk = encoders[encoderIdx].setSample(sample);
 				}
-				if (angleFromEncoderIsOk) {
-					float currentAngle = encoders[encoderIdx].getAngle();
-					stepper.setMeasuredAngle(currentAngle,now);		// set current angle and adapt speed
-				} else {
-					float currentAngle = stepper.getCurrentAngle();
-					stepper.setMeasuredAngle(currentAngle,now);		// set current angle and adapt speed
+				if (sampleIsFresh) {
+					if (angleFromEncoderIsOk) {
+						float currentAngle = encoders[encoderIdx].getAngle();
+						stepper.setMeasuredAngle(currentAngle,now);		// set current angle and adapt speed
+					} else {
+						float currentAngle = stepper.getCurrentAngle();
+						stepper.setMeasuredAngle(currentAngle,now);		// set current angle and adapt speed
+					}
 				}
-				stepperLoop(); 									// send impulses to steppers immediately in case a correction has to happen
 			}
 		}
 	}
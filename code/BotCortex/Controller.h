@@ -38,9 +38,6 @@ class Controller {
 
 		void loop(uint32_t now);
 
-		// give all steppers the chance to move a step
-		void stepperLoop();
-
 		// return actuator by given actuator number
 		Actuator* getActuator(uint8_t number);
 
@@ -0,0 +1,115 @@
+/*
+ * EncoderSampler.cpp
+ *
+ * Author: JochenAlt
+ */
+
+#include "EncoderSampler.h"
+#include "pins.h"
+
+EncoderSampler encoderSampler;
+
+EncoderSampler::EncoderSampler() {
+	numberOfEncoders = 0;
+	for (uint8_t i = 0;i<NUMBER_OF_I2C_BUSES;i++) {
+		buses[i].state = BUS_IDLE;
+		buses[i].numberOfEncoders = 0;
+		buses[i].current = 0;
+		buses[i].start = 0;
+	}
+}
+
+void EncoderSampler::setup() {
+	finish();
+	numberOfEncoders = 0;
+	for (uint8_t i = 0;i<NUMBER_OF_I2C_BUSES;i++)
+		buses[i].numberOfEncoders = 0;
+}
+
+uint8_t EncoderSampler::addEncoder(RotaryEncoder* encoder) {
+	uint8_t no = numberOfEncoders++;
+	encoders[no] = encoder;
+	samples[no].latest = 0;
+	samples[no].fresh = false;
+
+	Bus& bus = buses[encoder->i2CBusNo()];
+	bus.encoder[bus.numberOfEncoders++] = no;
+	return no;
+}
+
+void EncoderSampler::loop() {
+	for (uint8_t i = 0;i<NUMBER_OF_I2C_BUSES;i++)
+		advance(i, true);
+}
+
+void EncoderSampler::finish() {
+	for (uint8_t i = 0;i<NUMBER_OF_I2C_BUSES;i++) {
+		while (buses[i].state != BUS_IDLE) {
+			Wires[i]->finish(ENCODER_SAMPLE_TIMEOUT*1000);
+			advance(i, false);
+		}
+	}
+}
+
+bool EncoderSampler::getSample(uint8_t encoderNo, EncoderSample& sample) {
+	Samples& s = samples[encoderNo];
+	if (!s.fresh)
+		return false;
+	s.fresh = false;
+	sample = s.sample[s.latest];
+	return true;
+}
+
+void EncoderSampler::store(uint8_t encoderNo, bool ok, uint16_t value, uint32_t time) {
+	Samples& s = samples[encoderNo];
+	uint8_t back = 1 - s.latest;
+	s.sample[back].ok = ok;
+	s.sample[back].value = value;
+	s.sample[back].time = time;
+	s.latest = back;
+	s.fresh = true;
+}
+
+// one step of the bus' state machine: select the angle register, read it, go to the next encoder
+void EncoderSampler::advance(uint8_t busNo, bool startNext) {
+	Bus& bus = buses[busNo];
+	i2c_t3* wire = Wires[busNo];
+	if (bus.numberOfEncoders == 0)
+		return;
+
+	if (bus.state != BUS_IDLE) {
+		uint8_t encoderNo = bus.encoder[bus.current];
+		uint32_t now = millis();	// taken before done(), so being late here is not taken as timeout
+		if (!wire->done()) {
+			if (now - bus.start <= ENCODER_SAMPLE_TIMEOUT)
+				return;
+			store(encoderNo, false, 0, bus.start);
+			resetI2C(busNo);
+		} else if (wire->status() != I2C_WAITING) {
+			// the main loop resets the bus
+			store(encoderNo, false, 0, bus.start);
+			startNext = false;
+		} else if (bus.state == BUS_SELECTING) {
+			// the sensor takes the angle when the read starts
+			wire->sendRequest(encoders[encoderNo]->i2CAddress(), 2, I2C_STOP);
+			bus.state = BUS_READING;
+			bus.start = millis();
+			return;
+		} else {
+			// 14 bit angle, 8 bits in the first register, 6 bits in the second
+			uint16_t value = ((uint16_t)wire->readByte()) << 6;
+			value += wire->readByte() & 0x3F;
+			store(encoderNo, true, value, bus.start);
+		}
+		bus.state = BUS_IDLE;
+		bus.current = (bus.current + 1) % bus.numberOfEncoders;
+	}
+
+	if (startNext) {
+		wire->beginTransmission(encoders[bus.encoder[bus.current]]->i2CAddress());
+		wire->write(AS5048B_ANGLMSB_REG);
+		wire->sendTransmission(I2C_NOSTOP);
+		bus.state = BUS_SELECTING;
+		bus.start = millis();
+	}
+}
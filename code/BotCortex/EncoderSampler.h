@@ -0,0 +1,70 @@
+/*
+ * EncoderSampler.h
+ *
+ * Reads the angles of all rotary encoders without waiting for the I2C bus. Each bus has
+ * a state machine running the non-blocking transfers of i2c_t3, so both buses work in
+ * parallel while the main loop does something else. A completed reading goes into a
+ * double buffer together with the time it has been taken, the controller picks up the
+ * latest one when the stepper's sample is due.
+ * Everybody else using a bus with blocking calls has to call finish() before.
+ *
+ * Author: JochenAlt
+ */
+
+#ifndef ENCODERSAMPLER_H_
+#define ENCODERSAMPLER_H_
+
+#include "Arduino.h"
+#include "Config.h"
+#include "RotaryEncoder.h"
+
+#define NUMBER_OF_I2C_BUSES 2
+
+class EncoderSampler {
+public:
+	EncoderSampler();
+
+	// stop sampling and remove all encoders
+	void setup();
+
+	// sample the passed encoder from now on, returns its number
+	uint8_t addEncoder(RotaryEncoder* encoder);
+
+	// start and complete transfers, never waits
+	void loop();
+
+	// wait until no transfer is running, to be called before using a bus with blocking calls
+	void finish();
+
+	// latest reading of the encoder, false if there has been none since the last call
+	bool getSample(uint8_t encoderNo, EncoderSample& sample);
+private:
+	enum BusState { BUS_IDLE, BUS_SELECTING, BUS_READING };
+
+	struct Bus {
+		BusState state;
+		uint8_t encoder[MAX_ENCODERS];		// numbers of the encoders on this bus
+		uint8_t numberOfEncoders;
+		uint8_t current;					// index into encoder[] that is read currently
+		uint32_t start;						// [ms] when the current transfer started
+	};
+
+	// double buffer, one sample is written while the other one is the latest
+	struct Samples {
+		EncoderSample sample[2];
+		volatile uint8_t latest;
+		volatile bool fresh;
+	};
+
+	void advance(uint8_t busNo, bool startNext);
+	void store(uint8_t encoderNo, bool ok, uint16_t value, uint32_t time);
+
+	RotaryEncoder* encoders[MAX_ENCODERS];
+	Samples samples[MAX_ENCODERS];
+	uint8_t numberOfEncoders;
+	Bus buses[NUMBER_OF_I2C_BUSES];
+};
+
+extern EncoderSampler encoderSampler;
+
+#endif /* ENCODERSAMPLER_H_ */
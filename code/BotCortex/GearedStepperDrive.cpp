@@ -2,21 +2,7 @@
 #include "GearedStepperDrive.h"
 #include "BotMemory.h"
 #include "utilities.h"
-
-// function called by AccelStepper when a forward step impulse happens.
-// sends an impulse to the stepper driver board.
-void forwardstep(void* obj) {
-	GearedStepperDrive* driver = (GearedStepperDrive*)obj;
-	driver->direction(true);
-	driver->performStep();
-}
-
-// same but backwards
-void backwardstep(void* obj) {
-	GearedStepperDrive* driver = (GearedStepperDrive*)obj;
-	driver->direction(false);
-	driver->performStep();
-}
+#include "StepGenerator.h"
 
 void GearedStepperDrive::setup(	StepperConfig* pConfigData, ActuatorConfiguration* pActuatorConfig, StepperSetupData* pSetupData, RotaryEncoder* pEncoder) {
 	movement.setNull();
@@ -47,16 +33,16 @@ void GearedStepperDrive::setup(	StepperConfig* pConfigData, ActuatorConfiguratio
 	pinMode(getPinClock(), OUTPUT);
 	pinMode(getPinDirection(), OUTPUT);
 	pinMode(getPinEnable(), OUTPUT);
-	direction(!currentDirection); // force setting the PIN by setting the other direction than the current one
+
+	// impulses are generated by the timer interrupt
+	axis = stepGenerator.addAxis(getPinClock(), getPinDirection(), setupData->direction);
+	stepPosition = 0;
 
 	// no movement currently
 	movement.setNull();
 	anglePerMicroStep =  getAnglePerMicroStep();
 	frequency = sampleFrequency();
 	stepsPerDegree = 1.0/setupData->degreePerStep;
-	accel.setup(this, forwardstep, backwardstep);
-	accel.setMaxSpeed(getMaxStepsPerSecond());
-	accel.setAcceleration(getMaxStepAccPerSecond());
 
 	if (memory.persMem.logSetup) {
 		logger->print(F("   "));
@@ -78,6 +64,10 @@ void GearedStepperDrive::setup(	StepperConfig* pConfigData, ActuatorConfiguratio
 	logger->print(F(" maxSpeed="));
 	logger->print(getMaxStepsPerSecond());
 	logger->println();
+
+	// the step generator ramps in fixed point, check that it gets the configured acceleration
+	if (!StepGenerator::isAccelerationAccurate(getMaxStepAccPerSecond()))
+		logError(F("acceleration of step generator inaccurate"));
 }
 
 void GearedStepperDrive::changeAngle(float pAngleChange,uint32_t pAngleTargetDuration) {
@@ -101,35 +91,12 @@ void GearedStepperDrive::setAngle(float pAngle,uint32_t pAngleTargetDuration) {
 	}
 }
 
-void GearedStepperDrive::performStep() {
-	uint8_t clockPIN = getPinClock();
-	// This LOW to HIGH change is what creates the step
-	digitalWrite(clockPIN, HIGH);
-	delayMicroseconds(PIBOT_PULSE_WIDTH_US);
-	digitalWrite(clockPIN, LOW);
-
-	
-	// adapt last motor position according the step, if motor is enabled
-	if (enabled) { 
-		bool direction = currentDirection;	// currently selected direction
-		float diffAngle = anglePerMicroStep;
-		if (direction != setupData->direction)
-			diffAngle = -diffAngle;
-		currentAngle += diffAngle;
-	}
-}
-
-
-void GearedStepperDrive::direction(bool forward) {
-	bool toBeDirection = forward;
-
-	if ((toBeDirection != currentDirection))
-	{
-		if (!setupData->direction)
-			forward=!forward;
-
-		digitalWrite(getPinDirection(), forward?LOW:HIGH);
-		currentDirection = toBeDirection;
+void GearedStepperDrive::appendAngle(float pAngle,uint32_t pAngleTargetTime) {
+	// same as setAngle, requires a measured angle
+	if (currentAngleAvailable) {
+		pAngle = constrain(pAngle, configData->minAngle,configData->maxAngle);
+		uint32_t now = millis();
+		movement.append(movement.getCurrentAngle(now), pAngle, now, pAngleTargetTime);
 	}
 }
 
@@ -147,7 +114,8 @@ void GearedStepperDrive::disable() {
 }
 
 void GearedStepperDrive::enableDriver(bool ok) {
-	enabled = ok; // do this first to switch off the stepper loop, otherwise ticks happens
+	enabled = ok;
+	stepGenerator.enable(axis, ok); // do this first to switch off the step generator, otherwise ticks happens
 
 	// set the clock to low to avoid switch-on-tick due to low/high impulse
 	digitalWrite(getPinClock(), LOW);
@@ -155,33 +123,26 @@ void GearedStepperDrive::enableDriver(bool ok) {
 	digitalWrite(getPinEnable(), ok?HIGH:LOW);
 }
 
-// called very often to execute one stepper step. Dont do complex operations here.
-// Parameter is ignored, no need for time here
+// steps are generated by the timer interrupt, nothing to do here
 void GearedStepperDrive::loop(uint32_t) {
-	loop();
-}
-
-// called very often to execute one stepper step. Dont do complex operations here.
-void GearedStepperDrive::loop() {
-	if (accel.runSpeed())
-		accel.computeNewSpeed();
 }
 
-// returns angle that has been measured lately
+// returns angle that has been measured lately, moved by the steps done since then
 float GearedStepperDrive::getCurrentAngle() {
+	int32_t position = stepGenerator.getPosition(axis);
+	currentAngle += (position - stepPosition)*anglePerMicroStep;
+	stepPosition = position;
 	return currentAngle;
 }
 
 void GearedStepperDrive::setCurrentAngle(float angle) {
 	currentAngle = angle;
+	stepPosition = stepGenerator.getPosition(axis);
 }
 
 void GearedStepperDrive::setMeasuredAngle(float pMeasuredActuatorAngle, uint32_t now) { 
-	currentAngle = pMeasuredActuatorAngle;
-	if (!currentAngleAvailable) {
-		lastToBeAngle = pMeasuredActuatorAngle;
-		currentAngleAvailable = true;
-	}
+	setCurrentAngle(pMeasuredActuatorAngle);
+	currentAngleAvailable = true;
 
 	if (!movement.isNull()) {
 		// compute steps resulting from trajectorys speed and the
@@ -189,65 +150,31 @@ void GearedStepperDrive::setMeasuredAngle(float pMeasuredActuatorAngle, uint32_t
 		float dT = sampleTime();
 
 		float toBeAngle = 			movement.getCurrentAngle(now);
-		float nextToBeAngle = 		movement.getCurrentAngle(now+dT);
+		float nextToBeAngle = 		movement.getCurrentAngle(now+configData->sampleRate);
 
-		float anglePerSample = 		toBeAngle-lastToBeAngle;
 		float nextAnglePerSample = 	nextToBeAngle - toBeAngle;
 
-		float currStepsPerSample = getMicroStepsByAngle(anglePerSample);
 		float nextStepsPerSample = getMicroStepsByAngle(nextAnglePerSample);
 		float stepErrorPerSample = getMicroStepsByAngle(toBeAngle  - currentAngle);		// current error, i.e. to-be-angle compared with encoder's angle
 
 		// the step error is going through a PI-controller and added to the to-be speed (=stepsPerSample)
-		float maxAcc = getMaxStepAccPerSecond();
-
 		float Pout = configData->kP * stepErrorPerSample;
 		integral += stepErrorPerSample * dT;
 		float Iout = configData->kI * integral;
 		float PIDoutput = Pout + Iout;
 		float accelerationPerSample = PIDoutput;
 
-		float distanceToNextSample = accelerationPerSample + currStepsPerSample;
-
-		// compute the acceleration used in this sample
-		float sampleAcc = (currStepsPerSample-nextStepsPerSample + stepErrorPerSample)*frequency;
-
-		// arbitrary definition: deceleration is as double as high as acceleration
-		if (((distanceToNextSample > 0) && (sampleAcc > 0)) ||
-			((distanceToNextSample < 0) && (sampleAcc < 0))) {
-			sampleAcc = constrain(sampleAcc*2, -maxAcc, maxAcc);
-		} else {
-			sampleAcc = constrain(sampleAcc, -maxAcc, maxAcc);
-		}
-
-		accel.setAcceleration(fabs(sampleAcc));
-		accel.move(distanceToNextSample);
-
-		/*
-		if ((configData->id == 4) && memory.persMem.logStepper) {
-			logger->print("t=");
-			logger->print(millis());
-			logger->print(" a=");
-			logger->print(toBeAngle);
-			logger->print(" last=");
-			logger->print(lastToBeAngle);
-			logger->print(" curr=");
-			logger->print(currentAngle);
-			logger->print(" rpm=");
-			logger->print(getRPMByAnglePerSample(anglePerSample));
-			logger->print(" ms=");
-			logger->println(configData->microSteps);
-			logger->print(" serror=");
-			logger->print(stepErrorPerSample);
-			logger->print(" o=");
-			logger->print(PIDoutput);
-			logger->print(" acc=");
-			logger->print(sampleAcc);
-			logger->print(" av=");
-			logger->println(accel.speed());
-		}
-		*/
-		lastToBeAngle = toBeAngle;
+		// the trajectory's speed of the coming sample plus the correction, in full steps
+		// like AccelStepper did, so encoder noise does not make the stepper jitter
+		long distanceToNextSample = accelerationPerSample + nextStepsPerSample;
+
+		// the step generator runs that speed until the next sample, it gets there with max acceleration.
+		// Be slow enough to stop at the to-be position, like AccelStepper did
+		float maxAcc = getMaxStepAccPerSecond();
+		float brakingSpeed = sqrt(2.0*maxAcc*abs(distanceToNextSample));
+		float maxSpeed = min(getMaxStepsPerSecond(), brakingSpeed);
+		float stepsPerSecond = constrain(distanceToNextSample*frequency, -maxSpeed, maxSpeed);
+		stepGenerator.setSpeed(axis, stepsPerSecond, maxAcc);
 	}
 }
 
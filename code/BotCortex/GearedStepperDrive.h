@@ -12,7 +12,6 @@
 #include <MotorBase.h>
 #include "Config.h"
 #include "Space.h"
-#include "AccelStepper.h"
 #include "ActuatorProperty.h"
 #include "TimePassedBy.h"
 #include "RotaryEncoder.h"
@@ -21,7 +20,6 @@ class GearedStepperDrive : public MotorBase
 {
 public:
 	GearedStepperDrive(): MotorBase() {
-		currentDirection = true;
 		currentAngleAvailable = false;
 		configData = NULL;
 		setupData = NULL;
@@ -31,15 +29,13 @@ public:
 	void setup(StepperConfig* config, ActuatorConfiguration* pActuatorConfig, StepperSetupData* setupData, RotaryEncoder* encoder);
 	void setAngle(float pAngle,uint32_t pAngleTargetDuration);
 	void changeAngle(float pAngleChange,uint32_t pAngleTargetDuration);
+	void appendAngle(float pAngle,uint32_t pAngleTargetTime);
 	void setCurrentAngle(float angle);
 
 	void loop(uint32_t now);
-	void loop();
 	float getCurrentAngle();
 	void setMeasuredAngle(float pMeasuredAngle, uint32_t now);
 	StepperConfig& getConfig() { return *configData;}
-	void direction(bool forward);
-	void performStep();
 	void enable();
 	void disable();
 	bool isEnabled();
@@ -125,14 +121,13 @@ private:
 	ActuatorConfiguration* actuatorConfig = NULL;
 	StepperConfig* configData = NULL;
 	RotaryEncoder* encoder = NULL;
-	AccelStepper accel;
+	uint8_t axis = 0;					// axis of the step generator
+	int32_t stepPosition = 0;			// step generator's position when currentAngle has been set
 
 	bool currentAngleAvailable = 0;		// true, if the encoder read an angle already
-	bool currentDirection = false;		// set by setCurrentDirection
 	float currentAngle;					// current actuator angle (not the motor angle!)
 	bool enabled = false;				// set the setEnable
 	float integral; 					// for PID controller
-	float lastToBeAngle = 0;			// last to-be angle coming from to-be trajectory
 	float anglePerMicroStep = 0;
 	float frequency = 0;
 	float stepsPerDegree = 0;
@@ -149,6 +149,12 @@ void HerkulexServoDrive::setAngle(float pAngle,uint32_t pAngleTargetDuration) {
 	movement.set(movement.getCurrentAngle(now), pAngle, now, pAngleTargetDuration);
 }
 
+void HerkulexServoDrive::appendAngle(float pAngle,uint32_t pTime_ms) {
+	uint32_t now = millis();
+	pAngle = constrain(pAngle, configData->minAngle,configData->maxAngle);
+	movement.append(movement.getCurrentAngle(now), pAngle, now, pTime_ms);
+}
+
 void HerkulexServoDrive::setNullAngle(float pRawAngle /* uncalibrated */) {
 	if (configData)
 		configData->nullAngle = pRawAngle;
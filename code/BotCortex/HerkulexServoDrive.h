@@ -35,6 +35,7 @@ public:
 	}
 	void setAngle(float angle,uint32_t pDuration_ms);
 	void changeAngle(float pAngleChange,uint32_t pAngleTargetDuration);
+	void appendAngle(float angle,uint32_t pTime_ms);
 	
 	bool setup( ServoConfig* config, ServoSetupData* setupData);
 	void loop(uint32_t now);
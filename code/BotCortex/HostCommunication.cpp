@@ -15,6 +15,7 @@
 #include "core.h"
 #include "LightsController.h"
 #include "Printer.h"
+#include "EncoderSampler.h"
 
 HostCommunication hostComm;
 extern Controller controller;
@@ -23,7 +24,19 @@ extern BotMemory botMemory;
 extern void setCortexBoardLED(bool onOff);
 extern void setLEDPattern();
 
+// reply to a binary frame with a frame carrying the status and the next expected sequence number
+void replyFrame(uint8_t status) {
+	uint8_t frame[CommFrame::MaxFrameSize];
+	uint8_t reply[CommFrame::ReplyPayloadSize] = { status, hostComm.streamSeq };
+	int len = CommFrame::build(hostComm.sCmd.getFrameCommand(), reply, CommFrame::ReplyPayloadSize, frame);
+	cmdSerial->write(frame, len);
+}
+
 void replyOk() {
+	if (hostComm.sCmd.isFrame()) {
+		replyFrame(ABSOLUTELY_NO_ERROR);
+		return;
+	}
 	cmdSerial->println(F(">ok"));
 	cmdSerial->print(F(">"));
 }
@@ -35,6 +48,10 @@ void replyError(int errorCode) {
 			patchedErrorCode = hostComm.sCmd.getErrorCode();
 		}
 	}
+	if (hostComm.sCmd.isFrame()) {
+		replyFrame(patchedErrorCode);
+		return;
+	}
 	cmdSerial->print(F(">nok("));
 	cmdSerial->print(patchedErrorCode);
 	cmdSerial->println(")");
@@ -167,6 +184,8 @@ void cmdINFO() {
 		}
 
 
+		// the scan uses blocking calls
+		encoderSampler.finish();
 		cmdSerial->print(F(" i2c0=("));
 		bool first = true;
 		int count = 0;
@@ -219,10 +238,19 @@ void cmdCHECKSUM() {
 		bool valueOK = false;
 		if (strncasecmp(onoff, "on", 2) == 0) {
 			hostComm.sCmd.useChecksum(true);
+			hostComm.sCmd.useFrames(false);
 			valueOK = true;
 		}
 		if (strncasecmp(onoff, "off", 3) == 0) {
 			hostComm.sCmd.useChecksum(false);
+			hostComm.sCmd.useFrames(false);
+			valueOK = true;
+		}
+		// checksum for text commands, binary frames with crc for MOVETO
+		if (strncasecmp(onoff, "binary", 6) == 0) {
+			hostComm.sCmd.useChecksum(true);
+			hostComm.sCmd.useFrames(true);
+			hostComm.resetStream();
 			valueOK = true;
 		}
 		if (valueOK) {
@@ -235,6 +263,18 @@ void cmdCHECKSUM() {
 	}
 }
 
+// Cortex time in ms, used by the host to timestamp MOVETOs
+void cmdTIME() {
+	bool paramsOK = hostComm.sCmd.endOfParams();
+	if (paramsOK) {
+		cmdSerial->print(F(" t="));
+		cmdSerial->print(millis());
+		replyOk();
+	}
+	else
+		replyError(PARAM_NUMBER_WRONG);
+}
+
 void cmdECHO() {
 	bool paramsOK = true;	
 	char* param = 0;
@@ -310,10 +350,15 @@ void cmdPRINTLN() {
 void cmdSETUP() {
 	char* param = 0;
 	bool paramsOK = hostComm.sCmd.getParamString(param);
+	// force is optional, do not take the checksum for it
+	if (paramsOK && (strncasecmp(param, "chk=", 4) == 0)) {
+		hostComm.sCmd.unnext();
+		param = 0;
+	}
 	paramsOK = hostComm.sCmd.endOfParams();
 	if (paramsOK) {
 		bool ok = false;
-		if (strncasecmp(param, "force", 2) == 0)
+		if ((param != 0) && (strncasecmp(param, "force", 2) == 0))
 			ok = controller.setup(true);
 		else
 			ok = controller.setup();
@@ -650,34 +695,104 @@ void cmdGET() {
 }
 
 
+// decode the payload of a MOVETO frame, angles come in 1/100 degree
+bool decodeMoveTo(const uint8_t* payload, float angle[], int16_t &duration) {
+	for (int i = 0;i<7;i++)
+		angle[i] = CommFrame::getInt16(&payload[i*2])/100.0;
+	duration = CommFrame::getInt16(&payload[7*2]);
+	return (duration <= 9999) && (duration>=20);
+}
+
+// decode the payload of a timed MOVETO frame, angles come in 1/100 degree followed by the Cortex time
+bool decodeMoveAt(const uint8_t* payload, float angle[], uint32_t &time) {
+	for (int i = 0;i<7;i++)
+		angle[i] = CommFrame::getInt16(&payload[i*2])/100.0;
+	time = CommFrame::getUInt32(&payload[7*2]);
+	return true;
+}
+
+void moveTo(float angle[], int16_t duration) {
+	if (memory.persMem.logLoop) {
+		logger->print(F("moveTo "));
+	}
+	for (int i = 0;i<7;i++) {
+		lights.setPoseSample();
+		controller.getActuator(i)->setAngle(angle[i],duration);
+		if (memory.persMem.logLoop) {
+			if (i>0)
+				logger->print(",");
+			logger->print(angle[i]);
+		}
+	}
+	if (memory.persMem.logLoop) {
+		logger->print(",");
+		logger->print(duration);
+		logger->println();
+	}
+}
+
+// queue a movement that reaches the angles at the passed Cortex time
+void moveAt(float angle[], uint32_t time) {
+	if (memory.persMem.logLoop) {
+		logger->print(F("moveAt "));
+	}
+	for (int i = 0;i<7;i++) {
+		lights.setPoseSample();
+		controller.getActuator(i)->appendAngle(angle[i],time);
+		if (memory.persMem.logLoop) {
+			if (i>0)
+				logger->print(",");
+			logger->print(angle[i]);
+		}
+	}
+	if (memory.persMem.logLoop) {
+		logger->print(" @");
+		logger->print(time);
+		logger->println();
+	}
+}
+
 void cmdMOVETO() {
 	float angle[7] = {0,0,0,0,0,0,0};
 	bool paramsOK = true;
 	int16_t duration = 0;
-	for (int i = 0;i<7;i++) 
-		paramsOK = hostComm.sCmd.getParamFloat(angle[i]) && (abs(angle[i]) <= 360.0) && paramsOK;
-
-	paramsOK = hostComm.sCmd.getParamInt(duration) && (duration <= 9999) && (duration>=20) && paramsOK;
+	uint32_t time = 0;
+	bool timed = false;
+	if (hostComm.sCmd.isFrame()) {
+		uint8_t len;
+		const uint8_t* payload = hostComm.sCmd.getFramePayload(len);
+		if (hostComm.sCmd.endOfParams() && ((len == CommFrame::MoveToStreamPayloadSize) || (len == CommFrame::MoveAtStreamPayloadSize))) {
+			hostComm.streamMoveTo(payload, len-1);
+			return;
+		}
+		timed = (len == CommFrame::MoveAtPayloadSize);
+		if (timed)
+			paramsOK = decodeMoveAt(payload, angle, time);
+		else
+			paramsOK = (len == CommFrame::MoveToPayloadSize) && decodeMoveTo(payload, angle, duration);
+	} else {
+		for (int i = 0;i<7;i++)
+			paramsOK = hostComm.sCmd.getParamFloat(angle[i]) && (abs(angle[i]) <= 360.0) && paramsOK;
+
+		// either a duration or the Cortex time when the angles are reached
+		char* timeStr = NULL;
+		bool timeSet = hostComm.sCmd.getParamString(timeStr);
+		timed = timeSet && (strncasecmp(timeStr, "at=", 3) == 0);
+		if (timed)
+			time = strtoul(&timeStr[3], NULL, 10);
+		else {
+			if (timeSet)
+				hostComm.sCmd.unnext();
+			paramsOK = hostComm.sCmd.getParamInt(duration) && (duration <= 9999) && (duration>=20) && paramsOK;
+		}
+	}
 	paramsOK = hostComm.sCmd.endOfParams() && paramsOK;
 	
 	if (paramsOK) {
-		if (memory.persMem.logLoop) {
-			logger->print(F("moveTo "));
-		}
-		for (int i = 0;i<7;i++) {
-			lights.setPoseSample();
-			controller.getActuator(i)->setAngle(angle[i],duration);
-			if (memory.persMem.logLoop) {
-				if (i>0)
-					logger->print(",");
-				logger->print(angle[i]);
-			}
-		}
-		if (memory.persMem.logLoop) {
-			logger->print(",");
-			logger->print(duration);
-			logger->println();
-		}
+		if (timed)
+			moveAt(angle, time);
+		else
+			moveTo(angle, duration);
 		replyOk();
 	}
 	else
@@ -702,12 +817,13 @@ void cmdHELP() {
 		cmdSerial->println(F("\tPOWER <on|off>"));
 		cmdSerial->println(F("\tKNOB <ActuatorNo>"));
 		cmdSerial->println(F("\tSTEP <ActuatorNo> <incr>"));
-		cmdSerial->println(F("\tCHECKSUM <on|off>"));
+		cmdSerial->println(F("\tCHECKSUM <on|off|binary>"));
 		cmdSerial->println(F("\tMEM (<reset>|<list>)"));
 		cmdSerial->println(F("\tSET <ActuatorNo> [min=<min>] [max=<max>] [null=<nullvalue>] [speed=x][acc=x] [P=x][D=x] [res=speed]"));
 		cmdSerial->println(F("\tGET <ActuatorNo> : n=<name> ang=<angle> min=<min> max=<max> null=<null>"));
 		cmdSerial->println(F("\tGET all : (i=<no> n=<name> ang=<angle> min=<min> max=<max> null=<null>)"));
-		cmdSerial->println(F("\tMOVETO <angle1> <angle2> ... <angle7> <durationMS>"));
+		cmdSerial->println(F("\tMOVETO <angle1> <angle2> ... <angle7> (<durationMS>|at=<cortexTimeMS>)"));
+		cmdSerial->println(F("\tTIME : t=<cortexTimeMS>"));
 		cmdSerial->println(F("\tLOG <setup|servo|stepper|encoder|loop> <on|off>"));
 		cmdSerial->println(F("\tINFO"));
 
@@ -720,14 +836,67 @@ void cmdHELP() {
 // default constructor
 HostCommunication::HostCommunication()
 {
+	resetStream();
 } //HostCommunication
 
+void HostCommunication::resetStream() {
+	streamSeq = 0;
+	for (int i = 0;i<CommFrame::StreamWindowSize;i++)
+		streamPayloadLen[i] = 0;
+}
+
+// payload is sequence number followed by the MOVETO payload of len bytes (with duration or timed). Frames
+// are executed in sequence order, frames arriving ahead of a missing one are kept until the gap is closed.
+void HostCommunication::streamMoveTo(const uint8_t* payload, uint8_t len) {
+	uint8_t seq = payload[0];
+	uint8_t ahead = seq - streamSeq;
+	if (ahead >= 128) {
+		// duplicate of an executed frame, its ack got lost
+		replyOk();
+		return;
+	}
+	if (ahead >= CommFrame::StreamWindowSize) {
+		replyError(FRAME_SEQUENCE_WRONG);
+		return;
+	}
+
+	int slot = seq % CommFrame::StreamWindowSize;
+	memcpy(streamPayload[slot], &payload[1], len);
+	streamPayloadLen[slot] = len;
+
+	// execute all frames that are in sequence now
+	while (streamPayloadLen[streamSeq % CommFrame::StreamWindowSize] > 0) {
+		slot = streamSeq % CommFrame::StreamWindowSize;
+		float angle[7];
+		if (streamPayloadLen[slot] == CommFrame::MoveAtPayloadSize) {
+			uint32_t time;
+			if (decodeMoveAt(streamPayload[slot], angle, time))
+				moveAt(angle, time);
+		} else {
+			int16_t duration;
+			if (decodeMoveTo(streamPayload[slot], angle, duration))
+				moveTo(angle, duration);
+		}
+		streamPayloadLen[slot] = 0;
+		streamSeq++;
+	}
+
+	// frames still waiting for a missing one, NAK the missing one
+	bool gap = false;
+	for (int i = 0;i<CommFrame::StreamWindowSize;i++)
+		gap = gap || (streamPayloadLen[i] > 0);
+	if (gap)
+		replyError(FRAME_SEQUENCE_WRONG);
+	else
+		replyOk();
+}
+
 
 
 void HostCommunication::setup() {
 	// Setup callbacks for SerialCommand commands
 	for (int i = 0;i<CommDefType::NumberOfCommands;i++) {
-		sCmd.addCommand(commDef[i].name, commDef[i].cmdFunction);
+		sCmd.addCommand(commDef[i].name, commDef[i].cmdFunction, commDef[i].cmd);
 	}
 	sCmd.setDefaultHandler(cmdUnrecognized);   // Handler for command that isn't matched  (says "What?")
 
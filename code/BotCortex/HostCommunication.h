@@ -22,6 +22,13 @@ public:
 	void loop(uint32_t now);
 
 	SerialCommand sCmd;
+
+	// streamed MOVETO frames, see CommFrame
+	void resetStream();
+	void streamMoveTo(const uint8_t* payload, uint8_t len);
+	uint8_t streamSeq;												// next expected sequence number
+	uint8_t streamPayload[CommFrame::StreamWindowSize][CommFrame::MoveAtPayloadSize];	// frames received ahead of streamSeq
+	uint8_t streamPayloadLen[CommFrame::StreamWindowSize];			// size of the MOVETO payload, 0 if the slot is empty
 }; //HostCommunication
 
 #endif //__HOSTCOMMUNICATION_H__
@@ -5,6 +5,7 @@
 #include "TimePassedBy.h"
 #include "Controller.h"
 #include "I2CPortScanner.h"
+#include "EncoderSampler.h"
 
 
 LightsController lights;
@@ -62,8 +63,10 @@ void LightsController::setup() {
 
 void LightsController::set(uint8_t channel, int value) {
 	uint8_t pwmValue = constrain(value, 0,255);
-	if (setuped)
+	if (setuped) {
+		encoderSampler.finish(); // panel shares I2C1 with the hip encoder
 		sn3218.set(channel, pwmValue);
+	}
 }
 
 void LightsController::updateHeartbeat() {
@@ -173,6 +176,7 @@ void LightsController::updateActuator() {
 void LightsController::loop(uint32_t now) {
 	if (setuped) {
 		if (lightsTimer.isDue_ms(LED_UPDATE_RATE, now)) {
+			encoderSampler.finish();
 			if (startup) {
 				for (int i = 0;i<16;i++) {
 					sn3218.set(i,0);
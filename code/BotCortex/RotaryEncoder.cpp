@@ -2,6 +2,7 @@
 #include "RotaryEncoder.h"
 #include "BotMemory.h"
 #include "utilities.h"
+#include "EncoderSampler.h"
 
 void RotaryEncoder::setup(ActuatorConfiguration* pActuatorConfig, RotaryEncoderConfig* pConfigData, RotaryEncoderSetupData* pSetupData)
 {
@@ -28,6 +29,9 @@ void RotaryEncoder::setup(ActuatorConfiguration* pActuatorConfig, RotaryEncoderC
 		logger->print(F("   "));
 	}
 
+	// the sampler must not be in the middle of a transfer
+	encoderSampler.finish();
+
 	sensor.begin(i2CBus());
 	sensor.setI2CAddress(i2CAddress());
 	//set clock wise counting
@@ -84,14 +88,25 @@ float RotaryEncoder::getLastRawSensorAngle() {
 }
 
 bool RotaryEncoder::readNewAngleFromSensor() {
+	encoderSampler.finish();
 	float rawAngle = sensor.angleR(U_DEG, true); // returns angle between 0..360
+	return setRawAngle(rawAngle, sensor.endTransmissionStatus() == 0, millis());
+}
+
+bool RotaryEncoder::setSample(const EncoderSample& sample) {
+	// same as AMS_AS5048B::angleR
+	uint16_t value = isClockwise()?(0b11111111111111 - sample.value):sample.value;
+	return setRawAngle(value*(360.0/AS5048B_RESOLUTION), sample.ok, sample.time);
+}
+
+bool RotaryEncoder::setRawAngle(float rawAngle, bool ok, uint32_t time) {
 	float nulledRawAngle = rawAngle - getNullAngle();
 	if (nulledRawAngle> 180.0)
 		nulledRawAngle -= 360.0;
 	if (nulledRawAngle< -180.0)
 		nulledRawAngle += 360.0;
 
-	if (sensor.endTransmissionStatus() != 0) {
+	if (!ok) {
 		failedReadingCounter = max(failedReadingCounter, failedReadingCounter+1);
 		logActuator(setupData->id);
 		logger->print(failedReadingCounter);
@@ -104,9 +119,8 @@ bool RotaryEncoder::readNewAngleFromSensor() {
 	
 	// apply first order low pass to filter sensor noise
 	if (filterAngle) {
-		uint32_t now = millis();
-		float duration_s = float(now - lastSensorRead) * (1.0/1000.0);
-		lastSensorRead = now;
+		float duration_s = float(time - lastSensorRead) * (1.0/1000.0);
+		lastSensorRead = time;
 
 		const float reponseTime = float(ENCODER_FILTER_RESPONSE_TIME)/1000.0;	// signal changes shorter than 2 samples are filtered out
 		float complementaryFilter = reponseTime/(reponseTime + duration_s);
@@ -16,6 +16,13 @@
 #include "ActuatorProperty.h"
 #include "pins.h"
 
+// angle register of the sensor, read by the EncoderSampler
+struct EncoderSample {
+	bool ok;				// false if the transfer failed
+	uint16_t value;			// 14 bit angle as delivered by the sensor
+	uint32_t time;			// [ms] when the sensor has been read
+};
+
 class RotaryEncoder
 {
 public:
@@ -48,6 +55,9 @@ public:
 	// fetch new angle from sensor
 	bool readNewAngleFromSensor();
 
+	// take the angle the EncoderSampler has read in the background
+	bool setSample(const EncoderSample& sample);
+
 	// fetch a couple of samples and compute variance (used to check if sensor works ok)
 	bool fetchSample(float& avr, float& variance);
 
@@ -73,9 +83,11 @@ public:
 
 	uint8_t i2CAddress() {	return setupData->I2CAddress;}
 	i2c_t3* i2CBus() {	return Wires[setupData->I2CBusNo];}
+	uint8_t i2CBusNo() { return setupData->I2CBusNo;}
 
 private:
 	bool fetchSample(uint8_t no, float sample[], float& avr, float& variance);
+	bool setRawAngle(float rawAngle, bool ok, uint32_t time);
 	bool isClockwise() {return setupData->clockwise;}
 
 	AMS_AS5048B sensor;
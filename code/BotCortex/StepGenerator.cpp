@@ -0,0 +1,151 @@
+/*
+ * StepGenerator.cpp
+ *
+ * Author: JochenAlt
+ */
+
+#include "Arduino.h"
+#include "StepGenerator.h"
+
+// phase, speed and acceleration are fixed point numbers with this many bits of a step. All of them
+// fit into 32 bits: speed is half a step per tick at most, phase stays below two steps
+static const int FractionBits = 29;
+static const int32_t OneStep = 1L << FractionBits;
+
+static constexpr double Tick = STEP_TIMER_PERIOD_US/1000000.0;	// [s]
+static constexpr double AccelerationScale = Tick*Tick*(double)OneStep;
+
+// steppers ramp with 21000 steps/s^2 and more, isAccelerationAccurate needs 0.1% of that
+static_assert(1.0/AccelerationScale < 10.0, "one bit of acceleration has to be below 10 steps/s^2");
+
+static_assert(STEP_TIMER_PERIOD_US >= PIBOT_PULSE_WIDTH_US, "an impulse lasts one tick, PiBot driver would not recognize it");
+
+StepGenerator stepGenerator;
+
+void stepTimerISR() {
+	stepGenerator.tick();
+}
+
+StepGenerator::StepGenerator() {
+	numberOfAxes = 0;
+	running = false;
+}
+
+void StepGenerator::setup() {
+	// the interrupt stops looking at the axis first
+	numberOfAxes = 0;
+}
+
+bool StepGenerator::begin() {
+	if (!running) {
+		timer.priority(STEP_TIMER_PRIORITY);
+		running = timer.begin(stepTimerISR, STEP_TIMER_PERIOD_US);
+	}
+	return running;
+}
+
+uint8_t StepGenerator::addAxis(uint8_t clockPIN, uint8_t directionPIN, bool forwardIsLow) {
+	uint8_t no = numberOfAxes;
+	Axis& axis = axes[no];
+	axis.clockHigh = portSetRegister(clockPIN);
+	axis.clockLow = portClearRegister(clockPIN);
+	axis.directionHigh = portSetRegister(directionPIN);
+	axis.directionLow = portClearRegister(directionPIN);
+	axis.forwardIsLow = forwardIsLow;
+	axis.enabled = false;
+	axis.targetSpeed = 0;
+	axis.acceleration = 0;
+	axis.speed = 0;
+	axis.phase = 0;
+	axis.position = 0;
+	axis.impulse = false;
+
+	digitalWrite(clockPIN, LOW);
+	axis.forward = true;
+	digitalWrite(directionPIN, forwardIsLow?LOW:HIGH);
+
+	// the interrupt takes the axis from now on
+	numberOfAxes = no + 1;
+	return no;
+}
+
+void StepGenerator::enable(uint8_t axis, bool on) {
+	axes[axis].targetSpeed = 0;
+	axes[axis].enabled = on;
+}
+
+// [steps/tick << FractionBits] per tick
+static int32_t getAccelerationPerTick(float acceleration) {
+	// one step per tick per tick is way beyond any stepper, and speed plus acceleration cannot overflow
+	return constrain((float)(acceleration*AccelerationScale), 1.0f, (float)OneStep);
+}
+
+float StepGenerator::getAcceleration(float acceleration) {
+	return getAccelerationPerTick(acceleration)/AccelerationScale;
+}
+
+bool StepGenerator::isAccelerationAccurate(float acceleration) {
+	return abs(getAcceleration(acceleration) - acceleration) <= acceleration*0.001;
+}
+
+void StepGenerator::setSpeed(uint8_t axis, float stepsPerSecond, float acceleration) {
+	stepsPerSecond = constrain(stepsPerSecond, -getMaxStepsPerSecond(), getMaxStepsPerSecond());
+
+	// a 32-bit write is atomic, so the interrupt sees either the old or the new value
+	axes[axis].acceleration = getAccelerationPerTick(acceleration);
+	axes[axis].targetSpeed = stepsPerSecond*Tick*OneStep;
+}
+
+// runs in the interrupt, every STEP_TIMER_PERIOD_US. Pins are written via their port registers,
+// digitalWriteFast is fast with constant pin numbers only
+void StepGenerator::tick() {
+	uint8_t n = numberOfAxes;
+	for (uint8_t i = 0;i<n;i++) {
+		Axis& axis = axes[i];
+
+		// an impulse lasts one tick
+		bool impulseEnded = axis.impulse;
+		if (impulseEnded) {
+			*axis.clockLow = 1;
+			axis.impulse = false;
+		}
+
+		if (!axis.enabled) {
+			axis.speed = 0;
+			axis.phase = 0;
+			continue;
+		}
+
+		// ramp towards the speed of this sample
+		int32_t targetSpeed = axis.targetSpeed;
+		int32_t acceleration = axis.acceleration;
+		if (axis.speed < targetSpeed)
+			axis.speed = (targetSpeed - axis.speed > acceleration)?axis.speed + acceleration:targetSpeed;
+		else if (axis.speed > targetSpeed)
+			axis.speed = (axis.speed - targetSpeed > acceleration)?axis.speed - acceleration:targetSpeed;
+		axis.phase += axis.speed;
+
+		// clock has to be low for one tick at least
+		if (impulseEnded)
+			continue;
+
+		if ((axis.phase >= OneStep) || (axis.phase <= -OneStep)) {
+			bool forward = (axis.phase > 0);
+			if (forward != axis.forward) {
+				// driver needs the direction before the impulse, step in the next tick
+				*((forward == axis.forwardIsLow)?axis.directionLow:axis.directionHigh) = 1;
+				axis.forward = forward;
+			} else {
+				*axis.clockHigh = 1;
+				axis.impulse = true;
+				if (forward) {
+					axis.phase -= OneStep;
+					axis.position++;
+				} else {
+					axis.phase += OneStep;
+					axis.position--;
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,80 @@
+/*
+ * StepGenerator.h
+ *
+ * Generates the step impulses of all steppers in a timer interrupt. Every tick, each
+ * axis adds its speed to a phase (DDA), a step happens whenever the phase passes a full
+ * step. The closed loop sets the speed once per sample, the interrupt ramps towards it
+ * with the passed acceleration. An impulse is high for one tick and low for at least
+ * one tick, so nothing waits and the step timing does not depend on the main loop.
+ *
+ * Author: JochenAlt
+ */
+
+#ifndef STEPGENERATOR_H_
+#define STEPGENERATOR_H_
+
+#include "Arduino.h"
+#include "IntervalTimer.h"
+#include "Config.h"
+
+class StepGenerator {
+public:
+	StepGenerator();
+
+	// remove all axis, to be called before the steppers are set up
+	void setup();
+
+	// start the timer, to be called when all axis have been added
+	bool begin();
+
+	// add a stepper, returns the number of its axis
+	uint8_t addAxis(uint8_t clockPIN, uint8_t directionPIN, bool forwardIsLow);
+
+	// a disabled axis does not step and stands still when enabled again
+	void enable(uint8_t axis, bool on);
+
+	// run with the passed speed [steps/s], speed changes with passed acceleration [steps/s^2]
+	void setSpeed(uint8_t axis, float stepsPerSecond, float acceleration);
+
+	// number of steps done so far, backward steps count negative
+	int32_t getPosition(uint8_t axis) { return axes[axis].position; };
+
+	// every second tick may have an impulse
+	static float getMaxStepsPerSecond() { return 1000000.0/(2.0*STEP_TIMER_PERIOD_US); };
+
+	// acceleration [steps/s^2] the interrupt ramps with when the passed one is set, differs by rounding only
+	static float getAcceleration(float acceleration);
+
+	// true if getAcceleration is within 0.1% of the passed acceleration
+	static bool isAccelerationAccurate(float acceleration);
+
+	// called by the timer interrupt
+	void tick();
+private:
+	struct Axis {
+		// port registers of clock and direction pin. Teensy 3.x maps them bitwise,
+		// writing 1 sets or clears this pin only
+		volatile uint8_t* clockHigh;
+		volatile uint8_t* clockLow;
+		volatile uint8_t* directionHigh;
+		volatile uint8_t* directionLow;
+		bool forwardIsLow;				// level of direction pin when going forward
+		volatile bool enabled;
+		volatile int32_t targetSpeed;	// [steps/tick << FractionBits]
+		volatile int32_t acceleration;	// [steps/tick << FractionBits] per tick
+		int32_t speed;					// [steps/tick << FractionBits]
+		int32_t phase;					// [steps << FractionBits] fraction of the next step
+		volatile int32_t position;		// [steps]
+		bool forward;					// current level of the direction pin
+		bool impulse;					// clock pin is high
+	};
+
+	Axis axes[MAX_STEPPERS];
+	volatile uint8_t numberOfAxes;
+	IntervalTimer timer;
+	bool running;
+};
+
+extern StepGenerator stepGenerator;
+
+#endif /* STEPGENERATOR_H_ */
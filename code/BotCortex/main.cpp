@@ -5,7 +5,6 @@
 #include "ams_as5048b.h"
 #include "PatternBlinker.h"
 #include <I2CPortScanner.h>
-#include "AccelStepper.h"
 #include <pins.h>
 #include "hostCommunication.h"
 #include "Controller.h"
@@ -48,33 +47,37 @@ void setLEDPattern() {
 
 
 // emergency method, that resets the I2C bus in case something went wrong (i.e. arbitration lost)
-void resetI2CWhenNecessary(int ic2no) {
-	if (Wires[ic2no]->status() != I2C_WAITING) {
-		logger->println();
-
-		switch(Wires[ic2no]->status())
-		    {
-		    case I2C_WAITING:  logger->print("I2C waiting, no errors "); break;
-		    case I2C_ADDR_NAK: logger->print("Slave addr not acknowledged "); break;
-		    case I2C_DATA_NAK: logger->print("Slave data not acknowledged "); break;
-		    case I2C_ARB_LOST: logger->print("Bus Error: Arbitration Lost "); break;
-		    case I2C_TIMEOUT:  logger->print("Bus Error: Time out "); break;
-		    default:           logger->print("I2C busy "); break;
-		}
-		logger->print("I2C");
-		logger->print(ic2no);
-		logger->print(F("("));
-		logger->print(Wires[ic2no]->status());
-		logger->print(F(")"));
-
-		Wires[ic2no]->resetBus();
-		Wires[ic2no]->begin();
-		Wires[ic2no]->setDefaultTimeout(1000);
-		Wires[ic2no]->setRate(I2C_BUS_RATE);
-
-		logger->print(F(" stat="));
-		logger->println(Wires[ic2no]->status());
+void resetI2C(int ic2no) {
+	logger->println();
+
+	switch(Wires[ic2no]->status())
+	    {
+	    case I2C_WAITING:  logger->print("I2C waiting, no errors "); break;
+	    case I2C_ADDR_NAK: logger->print("Slave addr not acknowledged "); break;
+	    case I2C_DATA_NAK: logger->print("Slave data not acknowledged "); break;
+	    case I2C_ARB_LOST: logger->print("Bus Error: Arbitration Lost "); break;
+	    case I2C_TIMEOUT:  logger->print("Bus Error: Time out "); break;
+	    default:           logger->print("I2C busy "); break;
 	}
+	logger->print("I2C");
+	logger->print(ic2no);
+	logger->print(F("("));
+	logger->print(Wires[ic2no]->status());
+	logger->print(F(")"));
+
+	Wires[ic2no]->resetBus();
+	Wires[ic2no]->begin();
+	Wires[ic2no]->setDefaultTimeout(1000);
+	Wires[ic2no]->setRate(I2C_BUS_RATE);
+
+	logger->print(F(" stat="));
+	logger->println(Wires[ic2no]->status());
+}
+
+void resetI2CWhenNecessary(int ic2no) {
+	// a transfer of the encoder sampler might be in progress
+	if (Wires[ic2no]->done() && (Wires[ic2no]->status() != I2C_WAITING))
+		resetI2C(ic2no);
 }
 
 void logPinAssignment() {
@@ -13,6 +13,7 @@
 
 // global variables used sensor bus (all is implemented in main.cpp)
 extern i2c_t3* Wires[2];
+extern void resetI2C(int ic2no);
 
 // global variables used for interfacing and for logging
 extern HardwareSerial* cmdSerial;
@@ -42,9 +42,12 @@ SerialCommand::SerialCommand()
     defaultHandler(NULL),
     term('\r'),           // default terminator for commands, newline character
     last(NULL),
-	savelast(NULL)
+	savelast(NULL),
+	savedDelim(NULL)
 {
 	withChecksum = false;
+	withFrames = false;
+	inFrame = false;
 	strcpy(delim, " "); // strtok_r needs a null-terminated string
 	clearBuffer();
 }
@@ -53,12 +56,22 @@ void SerialCommand::useChecksum(bool really) {
 	withChecksum = really;
 }
 
+void SerialCommand::useFrames(bool really) {
+	withFrames = really;
+	frameReceiver.reset();
+}
+
+const uint8_t* SerialCommand::getFramePayload(uint8_t &len) {
+	len = frameReceiver.getFrame()[1] - 1;
+	return &frameReceiver.getFrame()[CommFrame::HeaderSize];
+}
+
 /**
  * Adds a "command" and a handler function to the list of available commands.
  * This is used for matching a found token in the buffer, and gives the pointer
  * to the handler function to deal with it.
  */
-void SerialCommand::addCommand(const char *command, void (*function)()) {
+void SerialCommand::addCommand(const char *command, void (*function)(), uint8_t id) {
   #ifdef SERIALCOMMAND_DEBUG
     cmdSerial->print("Adding command (");
     cmdSerial->print(commandCount);
@@ -69,6 +82,7 @@ void SerialCommand::addCommand(const char *command, void (*function)()) {
   commandList = (SerialCommandCallback *) realloc(commandList, (commandCount + 1) * sizeof(SerialCommandCallback));
   strncpy(commandList[commandCount].command, command, SERIALCOMMAND_MAXCOMMANDLENGTH);
   commandList[commandCount].function = function;
+  commandList[commandCount].id = id;
   commandCount++;
 }
 
@@ -89,7 +103,18 @@ void SerialCommand::setDefaultHandler(void (*function)(const char *)) {
 void SerialCommand::readSerial() {
   while (cmdSerial->available() > 0) {
     char inChar = cmdSerial->read();   // Read single available character, there may be more waiting
-	
+
+	// a start byte outside of a frame starts a binary frame, even within a text command
+	if (withFrames) {
+		CommFrameReceiver::Result result = frameReceiver.receive((uint8_t)inChar, millis());
+		if (result == CommFrameReceiver::FRAME_STARTED)
+			clearBuffer();	// a partial text command is garbage of a frame that lost its start byte
+		if (result == CommFrameReceiver::FRAME_COMPLETE)
+			processFrame();
+		if (result != CommFrameReceiver::TEXT)
+			continue;
+	}
+
     if (inChar == term) {     // Check for the terminator (default '\r') meaning end of command
       #ifdef SERIALCOMMAND_DEBUG
         cmdSerial->print("Received: ");
@@ -154,6 +179,28 @@ void SerialCommand::readSerial() {
   }
 }
 
+/**
+ * Calls the handler registered with the command id of the frame just received.
+ */
+void SerialCommand::processFrame() {
+	// a frame with wrong crc is passed to its handler anyway, endOfParams fails then and the handler replies with an error
+	errorCode = CommFrame::check(frameReceiver.getFrame(), frameReceiver.getFrameLen())?NO_ERROR:CHECKSUM_WRONG;
+	inFrame = true;
+	boolean matched = false;
+	for (int i = 0; i < commandCount; i++) {
+		if (commandList[i].id == getFrameCommand()) {
+			(*commandList[i].function)();
+			resetError();
+			matched = true;
+			break;
+		}
+	}
+	if (!matched && (defaultHandler != NULL)) {
+		(*defaultHandler)("");
+	}
+	inFrame = false;
+}
+
 /*
  * Clear the input buffer.
  */
@@ -167,16 +214,27 @@ void SerialCommand::clearBuffer() {
  * Returns NULL if no more tokens exist.
  */
 char *SerialCommand::next() {
+  if (inFrame)
+	return NULL;	// frames have no text parameters
   savelast = last;
+  savedChecksum = checksum;
   char* nextParam = strtok_r(NULL, delim, &last);
-  if (nextParam != NULL)
+  savedDelim = NULL;
+  if (nextParam != NULL) {
+	char* end = nextParam + strlen(nextParam);
+	if (last == end + 1)
+		savedDelim = end;
 	computeChecksum(nextParam,checksum);
+  }
 
   return nextParam;
 }
 
 void SerialCommand::unnext() {
 	last = savelast;
+	if (savedDelim != NULL)
+		*savedDelim = delim[0];
+	checksum = savedChecksum; // a pushed back token is counted when it is taken again
 }
 
 
@@ -278,6 +336,9 @@ bool SerialCommand::getNamedParamString(const char* paramName,  char* &param,
 }
 
 bool SerialCommand::endOfParams() {
+	if (inFrame)
+		return (errorCode == NO_ERROR); // crc has been checked already
+
 	if (withChecksum) {
 		// compute checksum of command and all params
 		errorCode = NO_ERROR;
@@ -34,6 +34,7 @@
 #include <string.h>
 
 #include "utilities.h"
+#include "CommDef.h"
 // Size of the input buffer in bytes (maximum length of one command plus arguments)
 #define SERIALCOMMAND_BUFFER 128
 // Maximum length of a command excluding the terminating null
@@ -46,7 +47,7 @@
 class SerialCommand {
   public:
     SerialCommand();      // Constructor
-    void addCommand(const char *command, void(*function)());  // Add a command to the processing dictionary.
+    void addCommand(const char *command, void(*function)(), uint8_t id = NoCommandId);  // Add a command to the processing dictionary, id is used for binary frames
     void setDefaultHandler(void (*function)(const char *));   // A handler to call when no valid command received.
 
     void readSerial();    // Main entry point.
@@ -67,14 +68,23 @@ class SerialCommand {
 	void useChecksum(bool really);
 	uint8_t getErrorCode() { return errorCode;};
 
+	// binary frames as defined in CommFrame, text commands are still accepted
+	void useFrames(bool really);
+	bool isFrame() { return inFrame; };	// true while the handler of a binary frame is running
+	uint8_t getFrameCommand() { return frameReceiver.getFrame()[2]; };
+	const uint8_t* getFramePayload(uint8_t &len);
+
 	enum errorCode { NO_ERROR = 0, CHECKSUM_EXPECTED = 1, CHECKSUM_WRONG = 2 };
+	static const uint8_t NoCommandId = 0xFF;
   private:
 	bool getNamedParam(const char* name,    char* &paramValue);
+	void processFrame();
 
     // Command/handler dictionary
     struct SerialCommandCallback {
       char command[SERIALCOMMAND_MAXCOMMANDLENGTH + 1];
       void (*function)();
+      uint8_t id;
     };                                    // Data structure to hold Command/Handler function key-value pairs
     SerialCommandCallback *commandList;   // Actual definition for command/handler array
     byte commandCount;
@@ -89,10 +99,16 @@ class SerialCommand {
     byte bufPos;                        // Current position in the buffer
     char *last;                         // State variable used by strtok_r during processing
     char *savelast;                         // State variable used by strtok_r during processing
+    char *savedDelim;                       // delimiter strtok_r replaced by the last call of next, restored by unnext
 	
 	bool withChecksum;
 	uint8_t checksum;
+	uint8_t savedChecksum;					// checksum before the last call of next
 	uint8_t errorCode;
+
+	bool withFrames;
+	bool inFrame;
+	CommFrameReceiver frameReceiver;
 };
 
 #endif //SerialCommand_h
@@ -21,7 +21,11 @@ class AngleMovement {
 			startTime = 0;
 			endTime = 0;
 			timeDiffRezi = 0;	
-
+			speedStart = 0;
+			speedEnd = 0;
+			coeff1 = 0;
+			coeff2 = 0;
+			coeff3 = 0;
 		}
 		
 
@@ -37,6 +41,12 @@ class AngleMovement {
 			angleEnd = p.angleEnd;
 			startTime = p.startTime;
 			endTime = p.endTime;
+			timeDiffRezi = p.timeDiffRezi;
+			speedStart = p.speedStart;
+			speedEnd = p.speedEnd;
+			coeff1 = p.coeff1;
+			coeff2 = p.coeff2;
+			coeff3 = p.coeff3;
 		}
 		
 		void print(uint8_t no) {
@@ -77,6 +87,31 @@ class AngleMovement {
 				endTime=startTime+1;
 
 			timeDiffRezi = 1.0/float(endTime-startTime);
+
+			// linear until speeds are set
+			float speed = (angleEnd-angleStart)*timeDiffRezi;
+			setSpeed(speed, speed);
+		}
+
+		// speed in degree/ms at start and end. The movement is a cubic Hermite spline then,
+		// with the same speed at both ends of a straight line it remains linear
+		void setSpeed(float pSpeedStart, float pSpeedEnd) {
+			speedStart = pSpeedStart;
+			speedEnd = pSpeedEnd;
+
+			// polynom in t=0..1, evaluated as angleStart + t*(coeff1 + t*(coeff2 + t*coeff3))
+			float duration = float(endTime-startTime);
+			float distance = angleEnd-angleStart;
+			float tangentStart = speedStart*duration;
+			float tangentEnd = speedEnd*duration;
+			coeff1 = tangentStart;
+			coeff2 = 3.0*distance - 2.0*tangentStart - tangentEnd;
+			coeff3 = -2.0*distance + tangentStart + tangentEnd;
+		}
+
+		// average speed in degree/ms
+		float getSpeed() {
+			return (angleEnd-angleStart)*timeDiffRezi;
 		}
 		
 		bool isNull() {
@@ -88,6 +123,11 @@ class AngleMovement {
 			angleEnd = 0;
 			endTime = 0;
 			timeDiffRezi = 0;
+			speedStart = 0;
+			speedEnd = 0;
+			coeff1 = 0;
+			coeff2 = 0;
+			coeff3 = 0;
 		}
 		
 		float getRatioDone (uint32_t now) {
@@ -102,7 +142,7 @@ class AngleMovement {
 				position = angleEnd;
 			else {
 				float t = float(now - startTime)*timeDiffRezi; // ratio in time, 0..1
-				position = angleStart + t*(angleEnd-angleStart); 				
+				position = angleStart + t*(coeff1 + t*(coeff2 + t*coeff3));
 			}
 		
 			return position;
@@ -121,90 +161,145 @@ class AngleMovement {
 		float angleStart;
 		float angleEnd;
 		float timeDiffRezi;
+		float speedStart;			// [degree/ms]
+		float speedEnd;
+		float coeff1;				// coefficients of the Hermite spline
+		float coeff2;
+		float coeff3;
 		uint32_t startTime;
 		uint32_t endTime;
 
 };
 
-/*
+// Ring of movements of one actuator, each one starting where and when the previous one ends.
+// set() replaces everything by one movement (MOVETO with duration), append() adds a movement ending
+// at an absolute time (MOVETO with Cortex timestamp). The host sends timed samples a few samples ahead,
+// so the joint keeps moving smoothly when a sample comes late.
+// Appended movements are cubic Hermite splines through the samples, the speed at a sample is derived
+// from its neighbours, so speed and acceleration do not jump at a sample anymore.
 class AngleMovementQueue {
 	public:
-		void print() {
-			cmdSerial->print(F("move{"));
-			if (!movement.isNull()) {
-				cmdSerial->print(F("1["));
-				cmdSerial->print(movement.angleStart);
-				cmdSerial->print("(");
-				cmdSerial->print(movement.startTime);
-				cmdSerial->print(F(")..."));
-				cmdSerial->print(movement.angleEnd);
-				cmdSerial->print("(");
-				cmdSerial->print(movement.endTime);
-				cmdSerial->print(")]");
+		static const uint8_t MaxMovements = 8;
+
+		AngleMovementQueue() {
+			setNull();
+		}
+
+		void print(uint8_t no) {
+			for (uint8_t i = 0;i<count;i++)
+				get(i).print(no);
+			if (count == 0)
+				logger->print(F("move=NULL"));
+		}
+
+		void set(float pStartAngle, float pEndAngle, uint32_t now, uint32_t pDurationMs) {
+			head = 0;
+			count = 1;
+			movement[0].set(pStartAngle, pEndAngle, now, pDurationMs);
+		}
+
+		// add a movement that reaches pEndAngle at pEndTime. It starts at the end of the last movement,
+		// or now at pCurrentAngle if nothing is queued.
+		void append(float pCurrentAngle, float pEndAngle, uint32_t now, uint32_t pEndTime) {
+			// movements that are over are not needed anymore, the last one holds the final angle
+			while ((count > 1) && (get(0).endTime <= now)) {
+				head = (head+1) % MaxMovements;
+				count--;
+			}
+
+			float startAngle = pCurrentAngle;
+			uint32_t startTime = now;
+			AngleMovement* previous = NULL;	// movement the new one continues, not running yet
+			float startSpeed = 0;			// the new movement starts from standstill unless it continues one
+			if (count > 0) {
+				AngleMovement& last = get(count-1);
+				startAngle = last.angleEnd;
+				if (last.endTime > now) {
+					startTime = last.endTime;
+					startSpeed = last.speedEnd;
+					if (last.startTime > now)
+						previous = &last;
+				}
 			}
-			if (!nextMovement.isNull()) {
-				cmdSerial->print("2[");
-				cmdSerial->print(nextMovement.angleStart);
-				cmdSerial->print("(");
-				cmdSerial->print(nextMovement.startTime);
-				cmdSerial->print(")...");
-				cmdSerial->print(nextMovement.angleEnd);
-				cmdSerial->print("(");
-				cmdSerial->print(nextMovement.endTime);
-				cmdSerial->print(")]");
+
+			// full, host is too far ahead. Stretch the last movement to the new end instead of losing it
+			if (count == MaxMovements) {
+				AngleMovement& last = get(count-1);
+				float speed = last.speedStart;
+				last.set(last.angleStart, pEndAngle, last.startTime, (pEndTime > last.startTime)?pEndTime-last.startTime:0);
+				last.setSpeed(speed, 0);
+				return;
 			}
-			cmdSerial->print("}");
-		}
-		void set(float currentAngle,  float endAngle, uint32_t now, uint32_t pDurationTime) {
-			if (movement.isNull()) {
-				movement.set(currentAngle, endAngle, now, pDurationTime);
-			} else {
-				// if new position is earlier than the current movement, overwrite
-				if (movement.endTime>= now+pDurationTime) {
-					movement.set(currentAngle, endAngle, now, pDurationTime);
-					nextMovement.setNull();
-				} else {
-					// end point is later, add next movement
-					nextMovement.set(movement.angleEnd, endAngle, movement.endTime, pDurationTime+now-movement.endTime);
-				}				
+
+			// a sample that arrives too late is approached as quickly as possible
+			count++;
+			AngleMovement& next = get(count-1);
+			next.set(startAngle, pEndAngle, startTime, (pEndTime > startTime)?pEndTime-startTime:0);
+
+			// speed at the sample between previous and next movement
+			if (previous != NULL) {
+				startSpeed = getSampleSpeed(previous->getSpeed(), previous->endTime - previous->startTime,
+											next.getSpeed(), next.endTime - next.startTime);
+				previous->setSpeed(previous->speedStart, startSpeed);
 			}
+
+			// the last movement ends in standstill, unless the next sample comes in
+			next.setSpeed(startSpeed, 0);
 		}
-		
+
 		bool isNull() {
-			return movement.isNull();
+			return count == 0;
+		};
+		void setNull() {
+			head = 0;
+			count = 0;
 		}
-		
-		bool timeInMovement(uint32_t now) {
-			if (movement.timeInMovement(now)) 
-				return true;
-			else 
-				return nextMovement.timeInMovement(now);
-		}
-
-		void setTime(uint32_t now) {
-			if (!movement.isNull()) {
-				if (movement.endTime< now) {
-					if (!nextMovement.isNull()) {
-						movement = nextMovement;
-						if (nextMovement.endTime < now)
-							nextMovement.setNull();
-					} else 
-						movement.setNull();
-				}
+
+		float getCurrentAngle(uint32_t now) {
+			if (count == 0)
+				return 0;
+
+			AngleMovement& first = get(0);
+			if (now < first.startTime)
+				return first.angleStart;
+
+			// movements are contiguous, take the one that is running at that time
+			for (uint8_t i = 0;i<count-1;i++) {
+				AngleMovement& m = get(i);
+				if (now < m.endTime)
+					return m.getCurrentAngle(now);
 			}
+			return get(count-1).getCurrentAngle(now);
 		}
-		
-		float getCurrentAngle(uint32_t now) {
-			float result = 0;
-			if (movement.timeInMovement(now))
-				result  = movement.getCurrentAngle(now);
-			if (nextMovement.timeInMovement(now))
-				result  = nextMovement.getCurrentAngle(now);
-	
-			return result;
-		}
-		AngleMovement movement;	
-		AngleMovement nextMovement;
+
+		bool timeInMovement(uint32_t now) {
+			if (count > 0)
+				return now <= get(count-1).endTime;
+			else
+				return false;
+		}
+
+		uint8_t size() {
+			return count;
+		}
+	private:
+		// speed at a sample is the slope of the line through both neighbours. At a turning point it is 0 and it
+		// is limited to 3 times the lower slope (Fritsch-Carlson), so the spline does not overshoot the samples
+		static float getSampleSpeed(float speedBefore, uint32_t durationBefore, float speedAfter, uint32_t durationAfter) {
+			if (speedBefore*speedAfter <= 0)
+				return 0;
+			float speed = (speedBefore*durationBefore + speedAfter*durationAfter)/float(durationBefore + durationAfter);
+			float maxSpeed = 3.0*min(fabs(speedBefore), fabs(speedAfter));
+			return constrain(speed, -maxSpeed, maxSpeed);
+		}
+
+		AngleMovement& get(uint8_t idx) {
+			return movement[(head + idx) % MaxMovements];
+		}
+
+		AngleMovement movement[MaxMovements];
+		uint8_t head;
+		uint8_t count;
 };
-*/
+
 #endif
@@ -0,0 +1,10 @@
+/*
+ * AMS_AS5048B.h
+ *
+ * The firmware includes the encoder library with two spellings, on Linux
+ * file names are case sensitive.
+ *
+ * Author: JochenAlt
+ */
+
+#include "ams_as5048b.h"
@@ -0,0 +1,117 @@
+/*
+ * Arduino.h
+ *
+ * Arduino core of the host build of the Cortex firmware. millis() and micros() come from
+ * a virtual microsecond clock, pins and analog inputs are hooked into the simulation,
+ * serial ports can be attached to a pseudo terminal.
+ *
+ * Author: JochenAlt
+ */
+
+#ifndef ARDUINO_H_
+#define ARDUINO_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+
+#define ARDUINO 100
+#define TEENSYDUINO 130
+#define F_CPU 180000000
+#define F_BUS 60000000
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define DEFAULT 0
+#define EXTERNAL 1
+#define INTERNAL 2
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#ifndef PI
+#define PI 3.1415926535897932384626433832795
+#endif
+#define HALF_PI 1.5707963267948966192313216916398
+#define TWO_PI 6.283185307179586476925286766559
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+#define RAD_TO_DEG 57.295779513082320876798154814105
+
+// templates like Teensyduino, so std::min and std::max still work. They return by value,
+// decltype of the conditional would be a reference to a parameter
+template<class A, class B> inline typename std::common_type<A, B>::type min(A a, B b) { return (a < b)?a:b; }
+template<class A, class B> inline typename std::common_type<A, B>::type max(A a, B b) { return (a > b)?a:b; }
+#define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+#define radians(deg) ((deg)*DEG_TO_RAD)
+#define degrees(rad) ((rad)*RAD_TO_DEG)
+#define sq(x) ((x)*(x))
+
+#define lowByte(w) ((uint8_t) ((w) & 0xff))
+#define highByte(w) ((uint8_t) ((w) >> 8))
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+
+#define _BV(bit) (1 << (bit))
+
+// there is no flash on the host, strings stay where they are
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+typedef bool boolean;
+typedef uint8_t byte;
+typedef uint16_t word;
+
+// time, based on the virtual clock of Board.h
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);				// calls yield() while waiting, like Teensyduino
+void delayMicroseconds(uint32_t us);	// busy wait without yield()
+void yield();							// does nothing unless the firmware implements it
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+inline void digitalWriteFast(uint8_t pin, uint8_t value) { digitalWrite(pin, value); };
+uint8_t digitalRead(uint8_t pin);
+
+// set and clear register of a pin like Teensy 3.x, writing 1 sets or clears the pin. The board
+// applies these writes when an interrupt returns, so only interrupts may use them
+volatile uint8_t* portSetRegister(uint8_t pin);
+volatile uint8_t* portClearRegister(uint8_t pin);
+int analogRead(uint8_t pin);
+void analogReference(uint8_t type);
+void analogWrite(uint8_t pin, int value);
+
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+// disabled interrupts are deferred until enabled again
+void interrupts();
+void noInterrupts();
+
+#include "Print.h"
+#include "HardwareSerial.h"
+
+#endif /* ARDUINO_H_ */
@@ -0,0 +1,283 @@
+/*
+ * Board.cpp
+ *
+ * Simulated board and the Arduino functions based on it.
+ *
+ * Author: JochenAlt
+ */
+
+#include <time.h>
+#include <errno.h>
+#include <chrono>
+
+#include "Arduino.h"
+#include "Board.h"
+#include "IntervalTimer.h"
+
+// the clock does not sleep for less than this, nanosleep is not precise enough
+static const int64_t MinSleepTime_us = 1000;
+
+Board& Board::getInstance() {
+	static Board instance;
+	return instance;
+}
+
+Board::Board() {
+	hostStart_us = hostNow_us();
+	hostBase_us = hostStart_us;
+	virtualBase_us = 0;
+	cpuFactor = 1.0;
+	realTime = true;
+	for (int i = 0;i<NumberOfPins;i++) {
+		pinState[i] = LOW;
+		analogValue[i] = 512;
+		pinListener[i] = NULL;
+	}
+	for (int i = 0;i<=NumberOfPins;i++) {
+		setRegister[i] = 0;
+		clearRegister[i] = 0;
+	}
+	for (int i = 0;i<MaxTimers;i++)
+		timers[i] = NULL;
+	interruptsEnabled = true;
+	inInterrupt = false;
+	interruptNow_us = 0;
+	interruptCalls = 0;
+	interruptTime_us = 0;
+}
+
+int64_t Board::hostNow_us() {
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t Board::now_us() {
+	if (inInterrupt)
+		return interruptNow_us;
+	uint64_t now = virtualBase_us + (uint64_t)((hostNow_us() - hostBase_us) * cpuFactor);
+	if (interruptsEnabled)
+		runInterrupts(now);
+	return now;
+}
+
+void Board::runInterrupts(uint64_t now) {
+	int64_t start = 0;
+	inInterrupt = true;
+	for (int i = 0;i<MaxTimers;i++) {
+		if (timers[i] == NULL)
+			continue;
+		while (timers[i]->getDueTime() <= now) {
+			if (start == 0)
+				start = hostNow_us();
+			interruptNow_us = timers[i]->getDueTime();
+			timers[i]->fire();
+			applyPortRegisters();
+			interruptCalls++;
+		}
+	}
+	inInterrupt = false;
+	if (start != 0)
+		interruptTime_us += (uint64_t)((hostNow_us() - start) * cpuFactor);
+}
+
+// a pin written to both registers within one interrupt is cleared first
+void Board::applyPortRegisters() {
+	for (int pin = 0;pin<NumberOfPins;pin++) {
+		if (clearRegister[pin]) {
+			clearRegister[pin] = 0;
+			writePin(pin, LOW);
+		}
+		if (setRegister[pin]) {
+			setRegister[pin] = 0;
+			writePin(pin, HIGH);
+		}
+	}
+}
+
+void Board::attachTimer(IntervalTimer* timer) {
+	for (int i = 0;i<MaxTimers;i++)
+		if (timers[i] == NULL) {
+			timers[i] = timer;
+			return;
+		}
+}
+
+void Board::detachTimer(IntervalTimer* timer) {
+	for (int i = 0;i<MaxTimers;i++)
+		if (timers[i] == timer)
+			timers[i] = NULL;
+}
+
+void Board::spend(uint32_t us) {
+	int64_t host = hostNow_us();
+	virtualBase_us += (uint64_t)((host - hostBase_us) * cpuFactor) + us;
+	hostBase_us = host;
+	if (realTime && ((int64_t)virtualBase_us - (host - hostStart_us) > MinSleepTime_us))
+		sync();
+}
+
+void Board::sync() {
+	if (!realTime)
+		return;
+	uint64_t virtualNow = now_us();
+	int64_t ahead_us = (int64_t)virtualNow - (hostNow_us() - hostStart_us);
+	if (ahead_us > 0) {
+		struct timespec ts;
+		ts.tv_sec = ahead_us / 1000000;
+		ts.tv_nsec = (ahead_us % 1000000) * 1000;
+		while (nanosleep(&ts, &ts) == EINTR);
+	}
+	// sleeping is not computing time of the firmware
+	virtualBase_us = virtualNow;
+	hostBase_us = hostNow_us();
+}
+
+void Board::setCpuFactor(float factor) {
+	spend(0);
+	cpuFactor = factor;
+}
+
+void Board::attachPin(uint8_t pin, PinListener* listener) {
+	if (pin < NumberOfPins)
+		pinListener[pin] = listener;
+}
+
+void Board::writePin(uint8_t pin, uint8_t value) {
+	if (pin >= NumberOfPins)
+		return;
+	pinState[pin] = value;
+	if (pinListener[pin] != NULL)
+		pinListener[pin]->pinWritten(pin, value);
+}
+
+uint8_t Board::readPin(uint8_t pin) {
+	return (pin < NumberOfPins)?pinState[pin]:LOW;
+}
+
+void Board::setAnalogValue(uint8_t pin, int value) {
+	if (pin < NumberOfPins)
+		analogValue[pin] = value;
+}
+
+int Board::getAnalogValue(uint8_t pin) {
+	return (pin < NumberOfPins)?analogValue[pin]:0;
+}
+
+volatile uint8_t* Board::getSetRegister(uint8_t pin) {
+	return &setRegister[(pin < NumberOfPins)?pin:NumberOfPins];
+}
+
+volatile uint8_t* Board::getClearRegister(uint8_t pin) {
+	return &clearRegister[(pin < NumberOfPins)?pin:NumberOfPins];
+}
+
+uint32_t millis() {
+	return Board::getInstance().now_us() / 1000;
+}
+
+uint32_t micros() {
+	return Board::getInstance().now_us();
+}
+
+// Teensyduino's yield, the firmware may override it
+__attribute__((weak)) void yield() {
+}
+
+void interrupts() {
+	Board::getInstance().setInterrupts(true);
+}
+
+void noInterrupts() {
+	Board::getInstance().setInterrupts(false);
+}
+
+IntervalTimer::IntervalTimer() {
+	function = NULL;
+	period_us = 0;
+	due_us = 0;
+}
+
+IntervalTimer::~IntervalTimer() {
+	end();
+}
+
+bool IntervalTimer::begin(void (*pFunction)(), unsigned int microseconds) {
+	if ((pFunction == NULL) || (microseconds == 0))
+		return false;
+	end();
+	function = pFunction;
+	period_us = microseconds;
+	due_us = Board::getInstance().now_us() + period_us;
+	Board::getInstance().attachTimer(this);
+	return true;
+}
+
+void IntervalTimer::end() {
+	if (function != NULL)
+		Board::getInstance().detachTimer(this);
+	function = NULL;
+}
+
+void IntervalTimer::fire() {
+	due_us += period_us;
+	function();
+}
+
+void delay(uint32_t ms) {
+	// same as Teensyduino, yield() runs while waiting
+	uint32_t start = micros();
+	while ((uint32_t)(micros() - start) < ms*1000) {
+		yield();
+		Board::getInstance().spend(1);
+	}
+}
+
+void delayMicroseconds(uint32_t us) {
+	Board::getInstance().spend(us);
+}
+
+void pinMode(uint8_t, uint8_t) {
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+	Board::getInstance().writePin(pin, value);
+}
+
+volatile uint8_t* portSetRegister(uint8_t pin) {
+	return Board::getInstance().getSetRegister(pin);
+}
+
+volatile uint8_t* portClearRegister(uint8_t pin) {
+	return Board::getInstance().getClearRegister(pin);
+}
+
+uint8_t digitalRead(uint8_t pin) {
+	return Board::getInstance().readPin(pin);
+}
+
+int analogRead(uint8_t pin) {
+	Board::getInstance().spend(10);	// conversion time of the ADC
+	return Board::getInstance().getAnalogValue(pin);
+}
+
+void analogReference(uint8_t) {
+}
+
+void analogWrite(uint8_t pin, int value) {
+	Board::getInstance().setAnalogValue(pin, value);
+}
+
+long random(long howbig) {
+	if (howbig <= 0)
+		return 0;
+	return rand() % howbig;
+}
+
+long random(long howsmall, long howbig) {
+	if (howsmall >= howbig)
+		return howsmall;
+	return random(howbig - howsmall) + howsmall;
+}
+
+void randomSeed(unsigned long seed) {
+	srand(seed);
+}
@@ -0,0 +1,96 @@
+/*
+ * Board.h
+ *
+ * The simulated Teensy board behind the Arduino shim: a virtual microsecond clock
+ * and the digital and analog pins.
+ *
+ * The clock runs with the host's time the firmware spends computing, scaled by the
+ * cpu factor (Teensy is slower than the host), plus the time the firmware spends
+ * waiting for the hardware (delays, i2c and uart transfers). In real time mode the
+ * clock does not run ahead of the wall clock, so a host on the other side of a pseudo
+ * terminal sees the timing of the real board.
+ *
+ * Timer interrupts run whenever somebody looks at the clock and their time has come,
+ * unless interrupts are disabled.
+ *
+ * Author: JochenAlt
+ */
+
+#ifndef BOARD_H_
+#define BOARD_H_
+
+#include <stdint.h>
+
+class IntervalTimer;
+
+// gets notified when the firmware writes a pin
+class PinListener {
+public:
+	virtual ~PinListener() {};
+	virtual void pinWritten(uint8_t pin, uint8_t value) = 0;
+};
+
+class Board {
+public:
+	static const int NumberOfPins = 64;
+
+	static Board& getInstance();
+
+	// virtual time in [us] since start
+	uint64_t now_us();
+
+	// the firmware waits for the passed time, e.g. a busy wait or a transfer on a bus
+	void spend(uint32_t us);
+
+	// in real time mode, sleep until the wall clock caught up with the virtual clock
+	void sync();
+
+	// host time is multiplied by the cpu factor to get the firmware's time
+	void setCpuFactor(float factor);
+	void setRealTime(bool on) { realTime = on; };
+	bool isRealTime() { return realTime; };
+
+	// pins
+	void attachPin(uint8_t pin, PinListener* listener);
+	void writePin(uint8_t pin, uint8_t value);
+	uint8_t readPin(uint8_t pin);
+	void setAnalogValue(uint8_t pin, int value);
+	int getAnalogValue(uint8_t pin);
+	volatile uint8_t* getSetRegister(uint8_t pin);
+	volatile uint8_t* getClearRegister(uint8_t pin);
+
+	// timer interrupts
+	void attachTimer(IntervalTimer* timer);
+	void detachTimer(IntervalTimer* timer);
+	void setInterrupts(bool on) { interruptsEnabled = on; };
+	long getInterruptCalls() { return interruptCalls; };
+	uint64_t getInterruptTime_us() { return interruptTime_us; };	// computing time spent in interrupts
+private:
+	static const int MaxTimers = 4;
+
+	Board();
+	int64_t hostNow_us();
+	void runInterrupts(uint64_t now_us);
+	void applyPortRegisters();
+
+	uint64_t virtualBase_us;	// virtual time at hostBase_us
+	int64_t hostBase_us;
+	int64_t hostStart_us;
+	float cpuFactor;
+	bool realTime;
+
+	uint8_t pinState[NumberOfPins];
+	int analogValue[NumberOfPins];
+	PinListener* pinListener[NumberOfPins];
+	volatile uint8_t setRegister[NumberOfPins + 1];		// the last one takes writes to unknown pins
+	volatile uint8_t clearRegister[NumberOfPins + 1];
+
+	IntervalTimer* timers[MaxTimers];
+	bool interruptsEnabled;
+	bool inInterrupt;
+	uint64_t interruptNow_us;	// clock while an interrupt runs
+	long interruptCalls;
+	uint64_t interruptTime_us;
+};
+
+#endif /* BOARD_H_ */
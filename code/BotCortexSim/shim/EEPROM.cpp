@@ -0,0 +1,89 @@
+/*
+ * EEPROM.cpp
+ *
+ * Author: JochenAlt
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "EEPROM.h"
+#include "Board.h"
+
+// writing a byte blocks the firmware, reading is free
+static const uint32_t WriteTimePerByte_us = 100;
+
+static uint8_t eeprom[E2END + 1];
+static bool initialized = false;
+
+EEPROMClass EEPROM;
+
+static size_t toIndex(const void* addr, size_t len) {
+	if (!initialized) {
+		memset(eeprom, 0xFF, sizeof(eeprom));	// erased
+		initialized = true;
+	}
+	size_t idx = (size_t)addr;
+	if ((idx > E2END) || (idx + len > E2END + 1))
+		return E2END + 1;
+	return idx;
+}
+
+uint8_t eeprom_read_byte(const uint8_t* addr) {
+	uint8_t value = 0xFF;
+	eeprom_read_block(&value, addr, 1);
+	return value;
+}
+
+uint16_t eeprom_read_word(const uint16_t* addr) {
+	uint16_t value = 0xFFFF;
+	eeprom_read_block(&value, addr, sizeof(value));
+	return value;
+}
+
+void eeprom_read_block(void* buf, const void* addr, size_t len) {
+	size_t idx = toIndex(addr, len);
+	if (idx <= E2END)
+		memcpy(buf, &eeprom[idx], len);
+}
+
+void eeprom_write_byte(uint8_t* addr, uint8_t value) {
+	eeprom_write_block(&value, addr, 1);
+}
+
+void eeprom_write_word(uint16_t* addr, uint16_t value) {
+	eeprom_write_block(&value, addr, sizeof(value));
+}
+
+void eeprom_write_block(const void* buf, void* addr, size_t len) {
+	size_t idx = toIndex(addr, len);
+	if (idx > E2END)
+		return;
+	// only changed bytes are written
+	const uint8_t* src = (const uint8_t*)buf;
+	for (size_t i = 0;i<len;i++) {
+		if (eeprom[idx+i] != src[i]) {
+			eeprom[idx+i] = src[i];
+			Board::getInstance().spend(WriteTimePerByte_us);
+		}
+	}
+}
+
+bool EEPROMClass::load(const char* filename) {
+	FILE* f = fopen(filename, "rb");
+	if (f == NULL)
+		return false;
+	size_t n = fread(eeprom, 1, sizeof(eeprom), f);
+	fclose(f);
+	initialized = (n == sizeof(eeprom));
+	return (n == sizeof(eeprom));
+}
+
+bool EEPROMClass::save(const char* filename) {
+	FILE* f = fopen(filename, "wb");
+	if (f == NULL)
+		return false;
+	size_t n = fwrite(eeprom, 1, sizeof(eeprom), f);
+	fclose(f);
+	return (n == sizeof(eeprom));
+}
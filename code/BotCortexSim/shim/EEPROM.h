@@ -0,0 +1,27 @@
+/*
+ * EEPROM.h
+ *
+ * Simulated EEPROM, erased (0xFF) at start unless loaded from a file.
+ *
+ * Author: JochenAlt
+ */
+
+#ifndef EEPROM_H_
+#define EEPROM_H_
+
+#include "avr/eeprom.h"
+
+class EEPROMClass {
+public:
+	uint8_t read(int idx) { return eeprom_read_byte((const uint8_t*)(intptr_t)idx); };
+	void write(int idx, uint8_t val) { eeprom_write_byte((uint8_t*)(intptr_t)idx, val); };
+	uint16_t length() { return E2END + 1; };
+
+	// keep the content between runs of the simulation
+	bool load(const char* filename);
+	bool save(const char* filename);
+};
+
+extern EEPROMClass EEPROM;
+
+#endif /* EEPROM_H_ */
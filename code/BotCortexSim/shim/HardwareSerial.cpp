@@ -0,0 +1,121 @@
+/*
+ * HardwareSerial.cpp
+ *
+ * Author: JochenAlt
+ */
+
+#include <unistd.h>
+#include <poll.h>
+
+#include "Arduino.h"
+#include "Board.h"
+#include "HardwareSerial.h"
+
+// a pseudo terminal is not polled more often than this, a syscall per available() is expensive
+static const uint64_t FetchInterval_us = 100;
+
+HardwareSerial Serial("USB");
+HardwareSerial Serial1("Serial1");
+HardwareSerial Serial2("Serial2");
+HardwareSerial Serial3("Serial3");
+HardwareSerial Serial4("Serial4");
+HardwareSerial Serial5("Serial5");
+HardwareSerial Serial6("Serial6");
+
+HardwareSerial::HardwareSerial(const char* pName) {
+	name = pName;
+	rxFd = -1;
+	txFd = -1;
+	baudRate = 115200;
+	txDone_us = 0;
+	lastFetch_us = 0;
+	rxHead = 0;
+	rxTail = 0;
+}
+
+void HardwareSerial::begin(uint32_t baud) {
+	baudRate = baud;
+}
+
+void HardwareSerial::fetch() {
+	if (rxFd < 0)
+		return;
+	uint64_t now = Board::getInstance().now_us();
+	if (now - lastFetch_us < FetchInterval_us)
+		return;
+	lastFetch_us = now;
+
+	struct pollfd pfd = { rxFd, POLLIN, 0 };
+	if ((poll(&pfd, 1, 0) <= 0) || !(pfd.revents & POLLIN))
+		return;
+
+	uint8_t buffer[RxBufferSize];
+	int space = (rxTail - rxHead - 1 + RxBufferSize) % RxBufferSize;
+	int n = ::read(rxFd, buffer, space);
+	for (int i = 0;i<n;i++) {
+		rxBuffer[rxHead] = buffer[i];
+		rxHead = (rxHead + 1) % RxBufferSize;
+	}
+}
+
+int HardwareSerial::available() {
+	fetch();
+	return (rxHead - rxTail + RxBufferSize) % RxBufferSize;
+}
+
+int HardwareSerial::read() {
+	if (available() == 0)
+		return -1;
+	uint8_t b = rxBuffer[rxTail];
+	rxTail = (rxTail + 1) % RxBufferSize;
+	return b;
+}
+
+int HardwareSerial::peek() {
+	if (available() == 0)
+		return -1;
+	return rxBuffer[rxTail];
+}
+
+void HardwareSerial::flush() {
+	// wait until the transmit buffer is empty
+	Board& board = Board::getInstance();
+	while (board.now_us() < txDone_us) {
+		yield();
+		board.spend(1);
+	}
+}
+
+void HardwareSerial::transmit(size_t bytes) {
+	Board& board = Board::getInstance();
+	uint64_t byteTime_us = 10*1000000/baudRate; // start bit, 8 data bits, stop bit
+
+	// wait while the transmit buffer is full
+	while (txDone_us > board.now_us() + TxBufferSize*byteTime_us) {
+		yield();
+		board.spend(1);
+	}
+	uint64_t now = board.now_us();
+	if (txDone_us < now)
+		txDone_us = now;
+	txDone_us += bytes*byteTime_us;
+}
+
+size_t HardwareSerial::write(uint8_t b) {
+	return write(&b, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+	for (size_t i = 0;i<size;i++)
+		transmit(1);
+	if (txFd >= 0) {
+		size_t written = 0;
+		while (written < size) {
+			int n = ::write(txFd, buffer + written, size - written);
+			if (n <= 0)
+				break;
+			written += n;
+		}
+	}
+	return size;
+}
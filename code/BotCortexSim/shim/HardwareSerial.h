@@ -0,0 +1,65 @@
+/*
+ * HardwareSerial.h
+ *
+ * UART of the Teensy. A port attached to a file descriptor (a pseudo terminal) sends and receives through it,
+ * otherwise output is dropped. Sending takes the time the bytes need at the configured baud rate:
+ * when the transmit buffer is full, write() waits and calls yield() like Teensyduino does.
+ *
+ * Author: JochenAlt
+ */
+
+#ifndef HARDWARESERIAL_H_
+#define HARDWARESERIAL_H_
+
+#include <stdint.h>
+#include "Print.h"
+
+class HardwareSerial : public Stream {
+public:
+	static const int TxBufferSize = 64;
+	static const int RxBufferSize = 256;
+
+	HardwareSerial(const char* name);
+
+	void begin(uint32_t baud);
+	void end() {};
+
+	// fd is used for reading and writing, -1 detaches the port
+	void attach(int fd) { attach(fd, fd); };
+	void attach(int pRxFd, int pTxFd) { rxFd = pRxFd; txFd = pTxFd; };
+	const char* getName() { return name; };
+
+	int available();
+	int read();
+	int peek();
+	void flush();
+
+	using Print::write;
+	size_t write(uint8_t b);
+	size_t write(const uint8_t* buffer, size_t size);
+
+	operator bool() { return true; };
+private:
+	void fetch();
+	void transmit(size_t bytes);
+
+	const char* name;
+	int rxFd;
+	int txFd;
+	uint32_t baudRate;
+	uint64_t txDone_us;				// time when the last byte in the transmit buffer has been sent
+	uint64_t lastFetch_us;
+	uint8_t rxBuffer[RxBufferSize];
+	int rxHead;
+	int rxTail;
+};
+
+extern HardwareSerial Serial;		// USB
+extern HardwareSerial Serial1;
+extern HardwareSerial Serial2;
+extern HardwareSerial Serial3;
+extern HardwareSerial Serial4;
+extern HardwareSerial Serial5;
+extern HardwareSerial Serial6;
+
+#endif /* HARDWARESERIAL_H_ */
@@ -0,0 +1,144 @@
+/*
+ * HerkuleX.cpp
+ *
+ * Author: JochenAlt
+ */
+
+#include "HerkuleX.h"
+
+// time the original library spends in delay() for a command without and with an answer
+static const uint32_t WriteCommandTime_ms = 1;
+static const uint32_t ReadCommandTime_ms = 3;
+
+// a position unit of the servo is 0.325 degrees, 512 is the middle position
+static const float DegreePerUnit = 0.325;
+
+HerkulexClass Herkulex;
+
+float SimulatedServo::getAngle(uint32_t now) {
+	if ((playTime_ms <= 0) || (now - startTime_ms >= (uint32_t)playTime_ms))
+		return targetAngle;
+	float t = float(now - startTime_ms)/float(playTime_ms);
+	return startAngle + (targetAngle - startAngle)*t;
+}
+
+HerkulexClass::HerkulexClass() {
+	numberOfServos = 0;
+	powered = true;
+}
+
+void HerkulexClass::addServo(int servoID, float angle) {
+	if (numberOfServos >= MaxServos)
+		return;
+	SimulatedServo& servo = servos[numberOfServos++];
+	servo.id = servoID;
+	servo.torqueOn = false;
+	servo.status = H_STATUS_OK;
+	servo.startAngle = angle;
+	servo.targetAngle = angle;
+	servo.startTime_ms = 0;
+	servo.playTime_ms = 0;
+}
+
+// returns NULL if the servo does not answer
+SimulatedServo* HerkulexClass::getServo(int servoID) {
+	if (!powered)
+		return NULL;
+	for (int i = 0;i<numberOfServos;i++)
+		if (servos[i].id == servoID)
+			return &servos[i];
+	return NULL;
+}
+
+void HerkulexClass::beginSerial(HardwareSerial* serial, long baud) {
+	serial->begin(baud);
+}
+
+void HerkulexClass::initialize() {
+	delay(100);
+	clearError(BROADCAST_ID);
+	delay(10);
+	ACK(1);
+	delay(10);
+	torqueON(BROADCAST_ID);
+	delay(10);
+}
+
+byte HerkulexClass::stat(int servoID) {
+	delay(ReadCommandTime_ms);
+	SimulatedServo* servo = getServo(servoID);
+	if (servo == NULL)
+		return H_ERROR_INPUT_VOLTAGE;
+	return servo->status;
+}
+
+void HerkulexClass::clearError(int servoID) {
+	delay(WriteCommandTime_ms);
+	for (int i = 0;i<numberOfServos;i++)
+		if ((servoID == BROADCAST_ID) || (servos[i].id == servoID))
+			servos[i].status = H_STATUS_OK;
+}
+
+void HerkulexClass::torqueON(int servoID) {
+	delay(WriteCommandTime_ms);
+	for (int i = 0;i<numberOfServos;i++)
+		if ((servoID == BROADCAST_ID) || (servos[i].id == servoID))
+			servos[i].torqueOn = powered;
+}
+
+void HerkulexClass::torqueOFF(int servoID) {
+	delay(WriteCommandTime_ms);
+	for (int i = 0;i<numberOfServos;i++)
+		if ((servoID == BROADCAST_ID) || (servos[i].id == servoID))
+			servos[i].torqueOn = false;
+}
+
+void HerkulexClass::moveOne(int servoID, int goal, int pTime, int iLed) {
+	moveOneAngle(servoID, (goal - 512)*DegreePerUnit, pTime, iLed);
+}
+
+void HerkulexClass::moveOneAngle(int servoID, float angle, int pTime, int) {
+	delay(WriteCommandTime_ms);
+	SimulatedServo* servo = getServo(servoID);
+	if ((servo == NULL) || !servo->torqueOn)
+		return;
+	uint32_t now = millis();
+	servo->startAngle = servo->getAngle(now);
+	servo->targetAngle = constrain(angle, -512*DegreePerUnit, 511*DegreePerUnit);
+	servo->startTime_ms = now;
+	servo->playTime_ms = pTime;
+}
+
+int HerkulexClass::getPosition(int servoID) {
+	return getAngle(servoID)/DegreePerUnit + 512;
+}
+
+float HerkulexClass::getAngle(int servoID) {
+	delay(ReadCommandTime_ms);
+	SimulatedServo* servo = getServo(servoID);
+	if (servo == NULL)
+		return 0;
+	// the position is read in units of the servo
+	int position = servo->getAngle(millis())/DegreePerUnit + 512;
+	return (position - 512)*DegreePerUnit;
+}
+
+int HerkulexClass::getPWM(int servoID) {
+	delay(ReadCommandTime_ms);
+	SimulatedServo* servo = getServo(servoID);
+	if ((servo == NULL) || !servo->torqueOn)
+		return 0;
+	// holding needs a bit, moving more
+	uint32_t now = millis();
+	float distance = fabs(servo->targetAngle - servo->getAngle(now));
+	return min(30 + (int)(distance*5.0), 1023);
+}
+
+void HerkulexClass::reboot(int servoID) {
+	delay(WriteCommandTime_ms);
+	for (int i = 0;i<numberOfServos;i++)
+		if ((servoID == BROADCAST_ID) || (servos[i].id == servoID)) {
+			servos[i].torqueOn = false;
+			servos[i].status = H_STATUS_OK;
+		}
+}
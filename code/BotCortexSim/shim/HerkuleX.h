@@ -0,0 +1,90 @@
+/*
+ * HerkuleX.h
+ *
+ * HerkuleX library with simulated servos instead of the serial protocol. A servo moves linearly
+ * to the position of the last move command within its play time. Commands take the time the
+ * original library spends with delay(), so yield() runs in the meantime as on the Teensy.
+ *
+ * Author: JochenAlt
+ */
+
+#ifndef Herkulex_h
+#define Herkulex_h
+
+#include "Arduino.h"
+
+// HERKULEX LED
+#define LED_GREEN 	 0x01
+#define LED_BLUE     0x02
+#define LED_CYAN     0x03
+#define LED_RED    	 0x04
+#define LED_GREEN2 	 0x05
+#define LED_PINK     0x06
+#define LED_WHITE    0x07
+
+// HERKULEX STATUS ERROR
+#define H_STATUS_OK					 0x00
+#define H_ERROR_INPUT_VOLTAGE 		 0x01
+#define H_ERROR_POS_LIMIT			 0x02
+#define H_ERROR_TEMPERATURE_LIMIT	 0x04
+#define H_ERROR_INVALID_PKT			 0x08
+#define H_ERROR_OVERLOAD			 0x10
+#define H_ERROR_DRIVER_FAULT  		 0x20
+#define H_ERROR_EEPREG_DISTORT		 0x40
+
+// HERKULEX Broadcast Servo ID
+const byte BROADCAST_ID = 0xFE;
+
+struct SimulatedServo {
+	int id;
+	bool torqueOn;
+	uint8_t status;
+	float startAngle;
+	float targetAngle;
+	uint32_t startTime_ms;
+	int playTime_ms;
+
+	float getAngle(uint32_t now);
+};
+
+class HerkulexClass {
+public:
+	static const int MaxServos = 8;
+
+	HerkulexClass();
+
+	// simulation
+	void addServo(int servoID, float angle);
+	void setPowered(bool on) { powered = on; };
+
+	void  beginSerial(HardwareSerial* serial,long baud);
+	void  end() {};
+
+	void  initialize();
+	byte  stat(int servoID);
+	void  ACK(int) { delay(1); };
+	void  clearError(int servoID);
+
+	void  torqueON(int servoID);
+	void  torqueOFF(int servoID);
+
+	void  moveOne(int servoID, int Goal, int pTime, int iLed);
+	void  moveOneAngle(int servoID, float angle, int pTime, int iLed);
+
+	int   getPosition(int servoID);
+	float getAngle(int servoID);
+	int   getPWM(int servoID);
+
+	void  reboot(int servoID);
+	void  setLed(int, int) { delay(1); };
+private:
+	SimulatedServo* getServo(int servoID);
+
+	SimulatedServo servos[MaxServos];
+	int numberOfServos;
+	bool powered;
+};
+
+extern HerkulexClass Herkulex;
+
+#endif    // Herkulex_h
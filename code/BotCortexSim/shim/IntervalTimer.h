@@ -0,0 +1,34 @@
+/*
+ * IntervalTimer.h
+ *
+ * Periodic timer interrupt of the Teensy. The board calls the function whenever its
+ * virtual clock passed the timer's due time, while the function runs the clock stands
+ * still at that time.
+ *
+ * Author: JochenAlt
+ */
+
+#ifndef INTERVALTIMER_H_
+#define INTERVALTIMER_H_
+
+#include <stdint.h>
+
+class IntervalTimer {
+public:
+	IntervalTimer();
+	~IntervalTimer();
+
+	bool begin(void (*function)(), unsigned int microseconds);
+	void end();
+	void priority(uint8_t) {};
+
+	// used by the board
+	uint64_t getDueTime() { return due_us; };
+	void fire();
+private:
+	void (*function)();
+	uint32_t period_us;
+	uint64_t due_us;
+};
+
+#endif /* INTERVALTIMER_H_ */
@@ -0,0 +1,79 @@
+/*
+ * Print.cpp
+ *
+ * Author: JochenAlt
+ */
+
+#include <string.h>
+#include <math.h>
+#include "Print.h"
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+	size_t n = 0;
+	while (size--)
+		n += write(*buffer++);
+	return n;
+}
+
+size_t Print::write(const char* str) {
+	if (str == NULL)
+		return 0;
+	return write((const uint8_t*)str, strlen(str));
+}
+
+size_t Print::printSigned(long n, int base) {
+	if ((base == 10) && (n < 0)) {
+		size_t t = print('-');
+		return t + printNumber(-(unsigned long)n, 10);
+	}
+	return printNumber((unsigned long)n, base);
+}
+
+size_t Print::printNumber(unsigned long n, int base) {
+	char buf[8 * sizeof(long) + 1];
+	char* str = &buf[sizeof(buf) - 1];
+	*str = '\0';
+	if (base < 2)
+		base = 10;
+	do {
+		char c = n % base;
+		n /= base;
+		*--str = c < 10 ? c + '0' : c + 'A' - 10;
+	} while (n);
+	return write(str);
+}
+
+size_t Print::printFloat(double number, int digits) {
+	if (isnan(number))
+		return print("nan");
+	if (isinf(number))
+		return print("inf");
+	if ((number > 4294967040.0) || (number < -4294967040.0))
+		return print("ovf");
+
+	size_t n = 0;
+	if (number < 0.0) {
+		n += print('-');
+		number = -number;
+	}
+
+	// round correctly so that print(1.999, 2) prints as "2.00"
+	double rounding = 0.5;
+	for (int i = 0;i<digits;i++)
+		rounding /= 10.0;
+	number += rounding;
+
+	unsigned long intPart = (unsigned long)number;
+	double remainder = number - (double)intPart;
+	n += printNumber(intPart, 10);
+
+	if (digits > 0)
+		n += print('.');
+	while (digits-- > 0) {
+		remainder *= 10.0;
+		unsigned int toPrint = (unsigned int)remainder;
+		n += printNumber(toPrint, 10);
+		remainder -= toPrint;
+	}
+	return n;
+}
@@ -0,0 +1,54 @@
+/*
+ * Print.h
+ *
+ * Print and Stream as used by the firmware, formatting follows the Arduino core.
+ *
+ * Author: JochenAlt
+ */
+
+#ifndef PRINT_H_
+#define PRINT_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+class __FlashStringHelper;
+
+class Print {
+public:
+	virtual ~Print() {};
+
+	virtual size_t write(uint8_t b) = 0;
+	virtual size_t write(const uint8_t* buffer, size_t size);
+	size_t write(const char* str);
+	size_t write(const char* buffer, size_t size) { return write((const uint8_t*)buffer, size); };
+
+	size_t print(const __FlashStringHelper* s) { return write((const char*)s); };
+	size_t print(const char* s) { return write(s); };
+	size_t print(char c) { return write((uint8_t)c); };
+	size_t print(unsigned char n, int base = 10) { return printNumber(n, base); };
+	size_t print(int n, int base = 10) { return printSigned(n, base); };
+	size_t print(unsigned int n, int base = 10) { return printNumber(n, base); };
+	size_t print(long n, int base = 10) { return printSigned(n, base); };
+	size_t print(unsigned long n, int base = 10) { return printNumber(n, base); };
+	size_t print(double n, int digits = 2) { return printFloat(n, digits); };
+
+	template<typename T> size_t println(T value) { size_t n = print(value); return n + println(); };
+	template<typename T> size_t println(T value, int format) { size_t n = print(value, format); return n + println(); };
+	size_t println() { return write("\r\n"); };
+
+	virtual void flush() {};
+private:
+	size_t printSigned(long n, int base);
+	size_t printNumber(unsigned long n, int base);
+	size_t printFloat(double n, int digits);
+};
+
+class Stream : public Print {
+public:
+	virtual int available() = 0;
+	virtual int read() = 0;
+	virtual int peek() = 0;
+};
+
+#endif /* PRINT_H_ */
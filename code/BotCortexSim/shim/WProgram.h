@@ -0,0 +1,12 @@
+/*
+ * WProgram.h
+ *
+ * Pre-1.0 Arduino header, forwards to Arduino.h.
+ *
+ * Author: JochenAlt
+ */
+
+#ifndef WPROGRAM_H_
+#define WPROGRAM_H_
+#include "Arduino.h"
+#endif /* WPROGRAM_H_ */
@@ -0,0 +1,12 @@
+/*
+ * Wiring.h
+ *
+ * Pre-1.0 Arduino header, forwards to Arduino.h.
+ *
+ * Author: JochenAlt
+ */
+
+#ifndef WIRING_H_
+#define WIRING_H_
+#include "Arduino.h"
+#endif /* WIRING_H_ */
@@ -0,0 +1,24 @@
+/*
+ * eeprom.h
+ *
+ * avr-libc EEPROM access on the simulated EEPROM, addresses are passed as pointers.
+ *
+ * Author: JochenAlt
+ */
+
+#ifndef AVR_EEPROM_H_
+#define AVR_EEPROM_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define E2END 0xFFF		// 4096 bytes like the Teensy 3.6
+
+uint8_t eeprom_read_byte(const uint8_t* addr);
+uint16_t eeprom_read_word(const uint16_t* addr);
+void eeprom_read_block(void* buf, const void* addr, size_t len);
+void eeprom_write_byte(uint8_t* addr, uint8_t value);
+void eeprom_write_word(uint16_t* addr, uint16_t value);
+void eeprom_write_block(const void* buf, void* addr, size_t len);
+
+#endif /* AVR_EEPROM_H_ */
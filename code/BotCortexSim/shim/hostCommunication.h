@@ -0,0 +1,10 @@
+/*
+ * hostCommunication.h
+ *
+ * main.cpp includes HostCommunication.h in lower case, on Linux
+ * file names are case sensitive.
+ *
+ * Author: JochenAlt
+ */
+
+#include "HostCommunication.h"
@@ -0,0 +1,156 @@
+/*
+ * i2c_t3.cpp
+ *
+ * Author: JochenAlt
+ */
+
+#include "i2c_t3.h"
+#include "Board.h"
+
+i2c_t3 Wire(0);
+i2c_t3 Wire1(1);
+
+i2c_t3::i2c_t3(uint8_t pBus) {
+	bus = pBus;
+	for (int i = 0;i<MaxDevices;i++)
+		devices[i] = NULL;
+	busRate = I2C_RATE_100;
+	defaultTimeout = 0;
+	currentStatus = I2C_WAITING;
+	resultStatus = I2C_WAITING;
+	busyUntil_us = 0;
+	txAddress = 0;
+	txLen = 0;
+	rxLen = 0;
+	rxPos = 0;
+}
+
+void i2c_t3::attach(uint8_t address, I2CDevice* device) {
+	if (address < MaxDevices)
+		devices[address] = device;
+}
+
+void i2c_t3::resetBus() {
+	// toggling SCL nine times, a running transfer is aborted
+	Board::getInstance().spend(9*1000000/busRate);
+	currentStatus = I2C_WAITING;
+	resultStatus = I2C_WAITING;
+}
+
+uint32_t i2c_t3::duration_us(size_t bytes) {
+	// start, address and data bytes with 9 clocks each, stop
+	return (1 + (1 + bytes)*9 + 1)*1000000/busRate;
+}
+
+uint8_t i2c_t3::done() {
+	update();
+	return (currentStatus != I2C_SENDING) && (currentStatus != I2C_RECEIVING);
+}
+
+uint8_t i2c_t3::finish(uint32_t timeout_us) {
+	if (!done()) {
+		uint64_t remaining_us = busyUntil_us - Board::getInstance().now_us();
+		if ((timeout_us > 0) && (remaining_us > timeout_us))
+			remaining_us = timeout_us;
+		Board::getInstance().spend(remaining_us);
+	}
+	return done() && (currentStatus == I2C_WAITING);
+}
+
+void i2c_t3::update() {
+	if (((currentStatus == I2C_SENDING) || (currentStatus == I2C_RECEIVING)) &&
+		(Board::getInstance().now_us() >= busyUntil_us))
+		currentStatus = resultStatus;
+}
+
+// the bus is busy for the time the bytes need, the result shows up afterwards
+void i2c_t3::start(i2c_status busy, i2c_status result, size_t bytes) {
+	busyUntil_us = Board::getInstance().now_us() + duration_us(bytes);
+	resultStatus = result;
+	currentStatus = busy;
+}
+
+void i2c_t3::beginTransmission(uint8_t address) {
+	finish();
+	txAddress = address;
+	txLen = 0;
+	currentStatus = I2C_WAITING;
+}
+
+size_t i2c_t3::write(uint8_t data) {
+	if (txLen >= I2C_TX_BUFFER_LENGTH) {
+		currentStatus = I2C_BUF_OVF;
+		return 0;
+	}
+	txBuffer[txLen++] = data;
+	return 1;
+}
+
+size_t i2c_t3::write(const uint8_t* data, size_t len) {
+	size_t n = 0;
+	while ((n < len) && (write(data[n]) == 1))
+		n++;
+	return n;
+}
+
+// hand the transmit buffer to the device, bytes is what went over the bus
+i2c_status i2c_t3::transmit(size_t& bytes) {
+	I2CDevice* device = (txAddress < MaxDevices)?devices[txAddress]:NULL;
+	if (device == NULL) {
+		bytes = 0;
+		return I2C_ADDR_NAK;
+	}
+	bytes = txLen;
+	if (!device->received(txBuffer, txLen))
+		return I2C_DATA_NAK;
+	return I2C_WAITING;
+}
+
+// fill the receive buffer from the device, len is what has been received
+i2c_status i2c_t3::request(uint8_t address, size_t& len) {
+	rxLen = 0;
+	rxPos = 0;
+	I2CDevice* device = (address < MaxDevices)?devices[address]:NULL;
+	if (device == NULL) {
+		len = 0;
+		return I2C_ADDR_NAK;
+	}
+	if (len > I2C_RX_BUFFER_LENGTH)
+		len = I2C_RX_BUFFER_LENGTH;
+	device->requested(rxBuffer, len);
+	rxLen = len;
+	return I2C_WAITING;
+}
+
+// returns 0 if ok, 2 if the address and 3 if data is not acknowledged, like the Wire library
+uint8_t i2c_t3::endTransmission(uint8_t, uint32_t) {
+	finish();
+	size_t bytes;
+	currentStatus = transmit(bytes);
+	Board::getInstance().spend(duration_us(bytes));
+	switch (currentStatus) {
+		case I2C_ADDR_NAK: return 2;
+		case I2C_DATA_NAK: return 3;
+		default: return 0;
+	}
+}
+
+size_t i2c_t3::requestFrom(uint8_t address, size_t len, uint8_t, uint32_t) {
+	finish();
+	currentStatus = request(address, len);
+	Board::getInstance().spend(duration_us(len));
+	return len;
+}
+
+void i2c_t3::sendTransmission(uint8_t) {
+	finish();
+	size_t bytes;
+	i2c_status result = transmit(bytes);
+	start(I2C_SENDING, result, bytes);
+}
+
+void i2c_t3::sendRequest(uint8_t address, size_t len, uint8_t) {
+	finish();
+	i2c_status result = request(address, len);
+	start(I2C_RECEIVING, result, len);
+}
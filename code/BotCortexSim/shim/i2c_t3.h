@@ -0,0 +1,131 @@
+/*
+ * i2c_t3.h
+ *
+ * I2C master of the Teensy with the interface of the i2c_t3 library. Slaves are simulated
+ * devices attached to an address, a transfer takes the time its bytes need at the bus rate.
+ * Blocking calls spend that time, the non-blocking ones (sendTransmission, sendRequest) talk
+ * to the device right away and keep the bus busy until the time has passed on the board's clock.
+ *
+ * Author: JochenAlt
+ */
+
+#ifndef I2C_T3_H_
+#define I2C_T3_H_
+
+#include "Arduino.h"
+
+enum i2c_op_mode  {I2C_OP_MODE_IMM, I2C_OP_MODE_ISR, I2C_OP_MODE_DMA};
+enum i2c_mode     {I2C_MASTER, I2C_SLAVE};
+enum i2c_pullup   {I2C_PULLUP_EXT, I2C_PULLUP_INT};
+enum i2c_rate     {I2C_RATE_100  = 100000,
+                   I2C_RATE_200  = 200000,
+                   I2C_RATE_300  = 300000,
+                   I2C_RATE_400  = 400000,
+                   I2C_RATE_600  = 600000,
+                   I2C_RATE_800  = 800000,
+                   I2C_RATE_1000 = 1000000,
+                   I2C_RATE_1200 = 1200000,
+                   I2C_RATE_1500 = 1500000,
+                   I2C_RATE_1800 = 1800000,
+                   I2C_RATE_2000 = 2000000,
+                   I2C_RATE_2400 = 2400000,
+                   I2C_RATE_2800 = 2800000,
+                   I2C_RATE_3000 = 3000000};
+enum i2c_stop     {I2C_NOSTOP, I2C_STOP};
+enum i2c_status   {I2C_WAITING,
+                   I2C_SENDING,
+                   I2C_SEND_ADDR,
+                   I2C_RECEIVING,
+                   I2C_TIMEOUT,
+                   I2C_ADDR_NAK,
+                   I2C_DATA_NAK,
+                   I2C_ARB_LOST,
+                   I2C_BUF_OVF,
+                   I2C_SLAVE_TX,
+                   I2C_SLAVE_RX};
+
+#define I2C_TX_BUFFER_LENGTH 259
+#define I2C_RX_BUFFER_LENGTH 259
+
+// simulated slave on the bus
+class I2CDevice {
+public:
+	virtual ~I2CDevice() {};
+
+	// master has written data, return false if the device does not acknowledge
+	virtual bool received(const uint8_t* data, size_t len) = 0;
+
+	// master reads len bytes
+	virtual void requested(uint8_t* data, size_t len) = 0;
+};
+
+class i2c_t3 : public Stream {
+public:
+	static const int MaxDevices = 128;
+
+	i2c_t3(uint8_t bus);
+
+	// simulated device answering to the address
+	void attach(uint8_t address, I2CDevice* device);
+
+	void begin() { currentStatus = I2C_WAITING; };
+	void begin(i2c_mode, uint8_t, uint8_t, uint8_t, i2c_pullup, uint32_t rate, i2c_op_mode = I2C_OP_MODE_ISR) {
+		begin();
+		setRate(rate);
+	};
+	void setDefaultTimeout(uint32_t timeout_us) { defaultTimeout = timeout_us; };
+	uint8_t setRate(uint32_t rate) { busRate = rate; return 1; };
+	uint8_t setRate(uint32_t, uint32_t rate) { return setRate(rate); };
+	void setClock(uint32_t rate) { setRate(rate); };
+	void resetBus();
+
+	void beginTransmission(uint8_t address);
+	uint8_t endTransmission(uint8_t sendStop = I2C_STOP, uint32_t timeout = 0);
+	size_t requestFrom(uint8_t address, size_t len, uint8_t sendStop = I2C_STOP, uint32_t timeout = 0);
+	void sendTransmission(uint8_t sendStop = I2C_STOP);
+	void sendRequest(uint8_t address, size_t len, uint8_t sendStop = I2C_STOP);
+	i2c_status status() { update(); return currentStatus; };
+
+	// true if no transfer is running, also if the last one failed
+	uint8_t done();
+
+	// wait until the running transfer is done, timeout_us=0 waits forever. Returns true if it succeeded
+	uint8_t finish(uint32_t timeout_us = 0);
+
+	using Print::write;
+	size_t write(uint8_t data);
+	size_t write(const uint8_t* data, size_t len);
+	int available() { return rxLen - rxPos; };
+	int read() { return (rxPos < rxLen)?rxBuffer[rxPos++]:-1; };
+	int peek() { return (rxPos < rxLen)?rxBuffer[rxPos]:-1; };
+	uint8_t readByte() { return (rxPos < rxLen)?rxBuffer[rxPos++]:0; };
+	void flush() {};
+
+	uint8_t getBus() { return bus; };
+private:
+	uint32_t duration_us(size_t bytes);
+	i2c_status transmit(size_t& bytes);
+	i2c_status request(uint8_t address, size_t& len);
+	void start(i2c_status busy, i2c_status result, size_t bytes);
+	void update();
+
+	uint8_t bus;
+	I2CDevice* devices[MaxDevices];
+	uint32_t busRate;
+	uint32_t defaultTimeout;
+	i2c_status currentStatus;
+	i2c_status resultStatus;		// status when the running transfer is done
+	uint64_t busyUntil_us;
+
+	uint8_t txAddress;
+	uint8_t txBuffer[I2C_TX_BUFFER_LENGTH];
+	size_t txLen;
+	uint8_t rxBuffer[I2C_RX_BUFFER_LENGTH];
+	size_t rxLen;
+	size_t rxPos;
+};
+
+extern i2c_t3 Wire;
+extern i2c_t3 Wire1;
+
+#endif /* I2C_T3_H_ */
@@ -0,0 +1,194 @@
+/*
+ * ArmSimulation.cpp
+ *
+ * Author: JochenAlt
+ */
+
+#include "ArmSimulation.h"
+#include "pins.h"
+#include "BotMemory.h"
+#include "ActuatorProperty.h"
+#include "HerkuleX.h"
+
+// integration step of the joint dynamics
+static const uint64_t MaxIntegrationStep_us = 100;
+
+// a joint closer than this to its motor is considered to be at rest
+static const float RestAngle = 0.0001;
+static const float RestVelocity = 0.001;
+
+// magnitude of the magnet and automatic gain of an encoder that is mounted properly
+static const uint16_t EncoderMagnitude = 0x1000;
+static const uint8_t EncoderGain = 0x80;
+static const uint8_t EncoderDiagOCF = 0x01;		// offset compensation finished
+
+void SimulatedJoint::setup(const SimulationConfig& config, StepperSetupData* pSetupData, float pAnglePerMicroStep, float pAngle) {
+	setupData = pSetupData;
+	anglePerMicroStep = pAnglePerMicroStep;
+	omega = 2.0*M_PI*config.jointFrequency;
+	damping = config.jointDamping;
+
+	powered = false;
+	enabled = false;
+	directionPin = LOW;
+	clockPin = LOW;
+	steps = 0;
+
+	motorAngle = pAngle;
+	angle = pAngle;
+	velocity = 0;
+	lastUpdate_us = 0;
+}
+
+void SimulatedJoint::pinWritten(uint8_t pin, uint8_t value) {
+	if (pin == setupData->enablePIN)
+		enabled = (value == HIGH);
+	else if (pin == setupData->directionPIN)
+		directionPin = value;
+	else if (pin == setupData->clockPIN) {
+		// the driver steps on the rising edge
+		if ((clockPin == LOW) && (value == HIGH) && enabled && powered) {
+			update(Board::getInstance().now_us());
+			// the motor is wired according to the setup's direction, so forward steps of AccelStepper increase the angle
+			bool forward = ((directionPin == LOW) == setupData->direction);
+			motorAngle += forward?anglePerMicroStep:-anglePerMicroStep;
+			steps++;
+		}
+		clockPin = value;
+	}
+}
+
+void SimulatedJoint::update(uint64_t now_us) {
+	if ((fabs(motorAngle - angle) < RestAngle) && (fabs(velocity) < RestVelocity)) {
+		angle = motorAngle;
+		velocity = 0;
+		lastUpdate_us = now_us;
+		return;
+	}
+
+	// damped spring between motor and joint, semi-implicit euler
+	while (lastUpdate_us < now_us) {
+		uint64_t dT_us = std::min(now_us - lastUpdate_us, MaxIntegrationStep_us);
+		float dT = float(dT_us) / 1000000.0;
+		float acc = omega*omega*(motorAngle - angle) - 2.0*damping*omega*velocity;
+		velocity += acc*dT;
+		angle += velocity*dT;
+		lastUpdate_us += dT_us;
+	}
+}
+
+float SimulatedJoint::getAngle(uint64_t now_us) {
+	update(now_us);
+	return angle;
+}
+
+void SimulatedEncoder::setup(const SimulationConfig& config, RotaryEncoderSetupData* pSetupData, SimulatedJoint* pJoint, float pAngleOffset) {
+	setupData = pSetupData;
+	joint = pJoint;
+	angleOffset = pAngleOffset;
+	noise = std::normal_distribution<float>(0.0, config.encoderNoise);
+
+	memset(registers, 0, sizeof(registers));
+	registers[AS5048B_ADDR_REG] = setupData->I2CAddress;
+	registers[AS5048B_GAIN_REG] = EncoderGain;
+	registers[AS5048B_DIAG_REG] = EncoderDiagOCF;
+	registers[AS5048B_MAGNMSB_REG] = EncoderMagnitude >> 6;
+	registers[AS5048B_MAGNLSB_REG] = EncoderMagnitude & 0x3F;
+	registerPointer = 0;
+}
+
+void SimulatedEncoder::measure() {
+	float sensorAngle = angleOffset + noise(ArmSimulation::getInstance().randomGenerator);
+	if (joint != NULL)
+		sensorAngle += joint->getAngle(Board::getInstance().now_us());
+
+	int value = ((int)lround(sensorAngle * AS5048B_RESOLUTION / 360.0)) & 0x3FFF;
+
+	// AMS_AS5048B turns a clockwise sensor around
+	if (setupData->clockwise)
+		value = 0x3FFF - value;
+
+	// the sensor reports relative to its programmed zero position
+	int zero = (registers[AS5048B_ZEROMSB_REG] << 6) + (registers[AS5048B_ZEROLSB_REG] & 0x3F);
+	value = (value - zero) & 0x3FFF;
+
+	registers[AS5048B_ANGLMSB_REG] = value >> 6;
+	registers[AS5048B_ANGLLSB_REG] = value & 0x3F;
+}
+
+bool SimulatedEncoder::received(const uint8_t* data, size_t len) {
+	if (len == 0)
+		return true;
+	registerPointer = data[0];
+	for (size_t i = 1;i<len;i++)
+		registers[registerPointer++] = data[i];
+	return true;
+}
+
+void SimulatedEncoder::requested(uint8_t* data, size_t len) {
+	if ((registerPointer == AS5048B_ANGLMSB_REG) || (registerPointer == AS5048B_ANGLLSB_REG))
+		measure();
+	for (size_t i = 0;i<len;i++)
+		data[i] = registers[registerPointer++];
+}
+
+ArmSimulation& ArmSimulation::getInstance() {
+	static ArmSimulation instance;
+	return instance;
+}
+
+void ArmSimulation::setup(const SimulationConfig& config) {
+	Board& board = Board::getInstance();
+	board.attachPin(POWER_SUPPLY_STEPPER_PIN, this);
+	board.attachPin(POWER_SUPPLY_SERVO_PIN, this);
+
+	// the arm is built like the firmware's default configuration
+	for (int i = 0;i<MAX_STEPPERS;i++) {
+		StepperSetupData* setupData = &stepperSetup[i];
+		StepperConfig& stepperConfig = memory.persMem.armConfig[setupData->id].config.stepperArm.stepper;
+		float anglePerMicroStep = setupData->degreePerStep / stepperConfig.microSteps / actuatorConfigType[setupData->id].gearRatio;
+		joints[i].setup(config, setupData, anglePerMicroStep, 0.0);
+
+		board.attachPin(setupData->enablePIN, &joints[i]);
+		board.attachPin(setupData->directionPIN, &joints[i]);
+		board.attachPin(setupData->clockPIN, &joints[i]);
+	}
+
+	for (int i = 0;i<MAX_ENCODERS;i++) {
+		RotaryEncoderSetupData* setupData = &encoderSetup[i];
+		SimulatedJoint* joint = NULL;
+		for (int j = 0;j<MAX_STEPPERS;j++)
+			if (joints[j].getSetupData()->id == setupData->id)
+				joint = &joints[j];
+
+		// RotaryEncoder subtracts the null angle from the sensor's angle and the angle offset from the result
+		float angleOffset = actuatorConfigType[setupData->id].angleOffset +
+							memory.persMem.armConfig[setupData->id].config.stepperArm.encoder.nullAngle;
+		encoders[i].setup(config, setupData, joint, angleOffset);
+		Wires[setupData->I2CBusNo]->attach(setupData->I2CAddress, &encoders[i]);
+	}
+
+	// lights panel
+	Wires[1]->attach(SN3218_ADDR, &panel);
+
+	// servos start in their null position
+	for (int i = 0;i<MAX_SERVOS;i++)
+		Herkulex.addServo(servoSetup[i].herkulexMotorId, memory.persMem.armConfig[servoSetup[i].id].config.servoArm.servo.nullAngle);
+	Herkulex.setPowered(false);
+}
+
+void ArmSimulation::pinWritten(uint8_t pin, uint8_t value) {
+	if (pin == POWER_SUPPLY_STEPPER_PIN) {
+		for (int i = 0;i<MAX_STEPPERS;i++)
+			joints[i].setPowered(value == HIGH);
+	}
+	if (pin == POWER_SUPPLY_SERVO_PIN)
+		Herkulex.setPowered(value == HIGH);
+}
+
+long ArmSimulation::getSteps() {
+	long steps = 0;
+	for (int i = 0;i<MAX_STEPPERS;i++)
+		steps += joints[i].getSteps();
+	return steps;
+}
@@ -0,0 +1,110 @@
+/*
+ * ArmSimulation.h
+ *
+ * Walter's arm as seen by the Cortex firmware: steppers with their driver pins,
+ * joints with inertia, AS5048B rotary encoders with noise on the I2C buses,
+ * HerkuleX servos and the LED panel. All setup data is taken from the firmware's
+ * tables and default configuration, so firmware and arm always fit together.
+ *
+ * Author: JochenAlt
+ */
+
+#ifndef ARMSIMULATION_H_
+#define ARMSIMULATION_H_
+
+#include <random>
+
+#include "Arduino.h"
+#include "Board.h"
+#include "i2c_t3.h"
+#include "Config.h"
+
+struct SimulationConfig {
+	float jointFrequency;		// [Hz] natural frequency of a joint following its motor
+	float jointDamping;			// damping ratio of a joint, 1.0 is critically damped
+	float encoderNoise;			// [deg] standard deviation of an encoder reading
+};
+
+// joint driven by a geared stepper. The motor follows the steps immediately,
+// the joint follows the motor like a damped spring
+class SimulatedJoint : public PinListener {
+public:
+	void setup(const SimulationConfig& config, StepperSetupData* setupData, float anglePerMicroStep, float angle);
+
+	void pinWritten(uint8_t pin, uint8_t value);
+	void setPowered(bool on) { powered = on; };
+
+	// [deg] angle of the joint at the passed time
+	float getAngle(uint64_t now_us);
+	float getMotorAngle() { return motorAngle; };
+	long getSteps() { return steps; };
+	StepperSetupData* getSetupData() { return setupData; };
+private:
+	void update(uint64_t now_us);
+
+	StepperSetupData* setupData;
+	float anglePerMicroStep;
+	float omega;				// [rad/s] natural frequency
+	float damping;
+
+	bool powered;
+	bool enabled;
+	uint8_t directionPin;
+	uint8_t clockPin;
+	long steps;
+
+	float motorAngle;
+	float angle;
+	float velocity;
+	uint64_t lastUpdate_us;
+};
+
+// AS5048B on the I2C bus, measures the angle of a joint
+class SimulatedEncoder : public I2CDevice {
+public:
+	void setup(const SimulationConfig& config, RotaryEncoderSetupData* setupData, SimulatedJoint* joint, float angleOffset);
+
+	bool received(const uint8_t* data, size_t len);
+	void requested(uint8_t* data, size_t len);
+private:
+	void measure();
+
+	RotaryEncoderSetupData* setupData;
+	SimulatedJoint* joint;
+	float angleOffset;			// [deg] sensor angle when the joint is at 0
+	std::normal_distribution<float> noise;
+	uint8_t registers[256];
+	uint8_t registerPointer;
+};
+
+// SN3218 of the lights panel, accepts everything
+class SimulatedPanel : public I2CDevice {
+public:
+	bool received(const uint8_t*, size_t) { return true; };
+	void requested(uint8_t* data, size_t len) { memset(data, 0, len); };
+};
+
+class ArmSimulation : public PinListener {
+public:
+	static ArmSimulation& getInstance();
+
+	// attach the arm to the pins and buses of the board, has to be called before the firmware's setup()
+	void setup(const SimulationConfig& config);
+
+	// power supply relays
+	void pinWritten(uint8_t pin, uint8_t value);
+
+	int getNumberOfJoints() { return MAX_STEPPERS; };
+	SimulatedJoint& getJoint(int idx) { return joints[idx]; };
+	long getSteps();
+
+	std::mt19937 randomGenerator;
+private:
+	ArmSimulation() {};
+
+	SimulatedJoint joints[MAX_STEPPERS];
+	SimulatedEncoder encoders[MAX_ENCODERS];
+	SimulatedPanel panel;
+};
+
+#endif /* ARMSIMULATION_H_ */
@@ -0,0 +1,60 @@
+/*
+ * CallProfile.h
+ *
+ * Number of calls per duration range, used to see what loop() costs
+ * on the virtual clock of the board.
+ *
+ * Author: JochenAlt
+ */
+
+#ifndef CALLPROFILE_H_
+#define CALLPROFILE_H_
+
+#include <stdint.h>
+#include <string>
+#include <sstream>
+
+struct CallProfile {
+	static const int NumberOfBuckets = 9;
+
+	// upper limit of each bucket, the last bucket takes everything above
+	static uint64_t bucketLimit(int bucket) {
+		static const uint64_t limits[NumberOfBuckets-1] = { 5, 10, 25, 50, 100, 250, 1000, 10000 };
+		return limits[bucket];
+	}
+
+	long calls[NumberOfBuckets];
+	long count;
+	uint64_t total_us;
+	uint64_t max_us;
+
+	void reset() {
+		for (int i = 0;i<NumberOfBuckets;i++)
+			calls[i] = 0;
+		count = 0;
+		total_us = 0;
+		max_us = 0;
+	}
+
+	void add(uint64_t duration_us) {
+		int bucket = 0;
+		while ((bucket < NumberOfBuckets-1) && (duration_us >= bucketLimit(bucket)))
+			bucket++;
+		calls[bucket]++;
+		count++;
+		total_us += duration_us;
+		if (duration_us > max_us)
+			max_us = duration_us;
+	}
+
+	std::string toString() {
+		std::ostringstream s;
+		s << "calls=" << count << " avg=" << ((count > 0)?(double)total_us/count:0.0) << "us max=" << max_us << "us ";
+		for (int i = 0;i<NumberOfBuckets-1;i++)
+			s << "<" << bucketLimit(i) << "us:" << calls[i] << " ";
+		s << ">=" << bucketLimit(NumberOfBuckets-2) << "us:" << calls[NumberOfBuckets-1];
+		return s.str();
+	}
+};
+
+#endif /* CALLPROFILE_H_ */
@@ -0,0 +1,212 @@
+//============================================================================
+// Name        : main.cpp
+// Author      : Jochen Alt
+// Description : runs the Cortex firmware on the host against a simulated arm
+//============================================================================
+
+#include <iostream>
+#include <algorithm>
+#include <string>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "Arduino.h"
+#include "Board.h"
+#include "EEPROM.h"
+#include "ArmSimulation.h"
+#include "CallProfile.h"
+
+using namespace std;
+
+// implemented in the firmware's main.cpp
+extern void setup();
+extern void loop();
+
+string cmdLink = "/tmp/cortex-cmd";
+string logLink = "/tmp/cortex-log";
+
+volatile sig_atomic_t stopRequested = 0;
+
+void signalHandler(int s){
+	stopRequested = 1;
+}
+
+char* getCmdOption(char ** begin, char ** end, const std::string & option)
+{
+    char ** itr = std::find(begin, end, option);
+    if (itr != end && ++itr != end)
+    {
+        return *itr;
+    }
+    return 0;
+}
+
+bool cmdOptionExists(char** begin, char** end, const std::string& option)
+{
+    return std::find(begin, end, option) != end;
+}
+
+void printUsage(string prg) {
+	cout << "usage: " << prg << " [-h] [-cmd <link>] [-log <link>|-console] [-eeprom <file>] [-cpu <factor>] [-fast] [-stats <s>] [-noise <deg>] [-inertia <Hz>]" << endl
+		 << "   [-h]                 help" << endl
+		 << "   [-cmd <link>]        symlink to command port (default " << cmdLink << ")" << endl
+		 << "   [-log <link>]        symlink to log port (default " << logLink << ")" << endl
+		 << "   [-console]           print the log port to stdout instead" << endl
+		 << "   [-eeprom <file>]     keep the EEPROM in this file" << endl
+		 << "   [-cpu <factor>]      the Teensy is this much slower than the host (default 1.0)" << endl
+		 << "   [-fast]              do not wait for the wall clock" << endl
+		 << "   [-stats <s>]         print the cost of loop and interrupts every <s> seconds" << endl
+		 << "   [-noise <deg>]       standard deviation of encoder readings (default 0.05)" << endl
+		 << "   [-inertia <Hz>]      natural frequency of the joints (default 20)" << endl
+		 << "start the webserver with -cmd <link> -log <link>" << endl;
+}
+
+// pseudo terminal, the slave side is symlinked to link. Returns the master's fd or -1
+int openPty(string link) {
+	int masterFd = posix_openpt(O_RDWR | O_NOCTTY);
+	if ((masterFd < 0) || (grantpt(masterFd) < 0) || (unlockpt(masterFd) < 0)) {
+		cerr << "opening pseudo terminal failed (" << strerror(errno) << ")" << endl;
+		return -1;
+	}
+	string slaveName = ptsname(masterFd);
+
+	// keep the slave open, otherwise the master fails as long as nobody connected
+	int slaveFd = open(slaveName.c_str(), O_RDWR | O_NOCTTY);
+	if (slaveFd < 0) {
+		cerr << "opening " << slaveName << " failed (" << strerror(errno) << ")" << endl;
+		return -1;
+	}
+	struct termios config;
+	tcgetattr(slaveFd, &config);
+	cfmakeraw(&config);
+	tcsetattr(slaveFd, TCSANOW, &config);
+
+	// output gets lost if nobody reads, like on a UART
+	fcntl(masterFd, F_SETFL, fcntl(masterFd, F_GETFL) | O_NONBLOCK);
+
+	unlink(link.c_str());
+	if (symlink(slaveName.c_str(), link.c_str()) < 0) {
+		cerr << "linking " << link << " to " << slaveName << " failed (" << strerror(errno) << ")" << endl;
+		return -1;
+	}
+	cout << link << " -> " << slaveName << endl;
+	return masterFd;
+}
+
+void printStatistics(CallProfile& loopProfile, long interruptCalls, uint64_t interruptTime_us, uint64_t duration_us) {
+	long steps = ArmSimulation::getInstance().getSteps();
+	cout << "time=" << Board::getInstance().now_us()/1000 << "ms interval=" << duration_us/1000 << "ms steps=" << steps << endl
+		 << "   loop        " << loopProfile.toString() << endl
+		 << "   interrupts  calls=" << interruptCalls << " avg=" << ((interruptCalls > 0)?(double)interruptTime_us/interruptCalls:0.0) << "us"
+		 << " load=" << ((duration_us > 0)?100.0*interruptTime_us/duration_us:0.0) << "%" << endl;
+	for (int i = 0;i<ArmSimulation::getInstance().getNumberOfJoints();i++) {
+		SimulatedJoint& joint = ArmSimulation::getInstance().getJoint(i);
+		cout << "   joint " << i << " angle=" << joint.getAngle(Board::getInstance().now_us()) << " motor=" << joint.getMotorAngle() << " steps=" << joint.getSteps() << endl;
+	}
+}
+
+int main(int argc, char *argv[]) {
+	if(cmdOptionExists(argv, argv+argc, "-h")) {
+		printUsage(argv[0]);
+		exit(0);
+    }
+
+	SimulationConfig config;
+	config.jointFrequency = 20.0;
+	config.jointDamping = 0.7;
+	config.encoderNoise = 0.05;
+	float cpuFactor = 1.0;
+	int statsInterval_s = 0;
+	string eepromFile;
+
+	char* option = getCmdOption(argv, argv + argc, "-cmd");
+	if (option)
+		cmdLink = option;
+	option = getCmdOption(argv, argv + argc, "-log");
+	if (option)
+		logLink = option;
+	option = getCmdOption(argv, argv + argc, "-eeprom");
+	if (option)
+		eepromFile = option;
+	option = getCmdOption(argv, argv + argc, "-cpu");
+	if (option)
+		cpuFactor = atof(option);
+	option = getCmdOption(argv, argv + argc, "-stats");
+	if (option)
+		statsInterval_s = atoi(option);
+	option = getCmdOption(argv, argv + argc, "-noise");
+	if (option)
+		config.encoderNoise = atof(option);
+	option = getCmdOption(argv, argv + argc, "-inertia");
+	if (option)
+		config.jointFrequency = atof(option);
+	bool console = cmdOptionExists(argv, argv+argc, "-console");
+
+	signal(SIGINT, signalHandler);
+	signal(SIGTERM, signalHandler);
+
+	// command port is Serial5, log port is Serial4 (see firmware's main.cpp)
+	cout << "command port ";
+	int cmdFd = openPty(cmdLink);
+	if (cmdFd < 0)
+		exit(1);
+	Serial5.attach(cmdFd);
+	if (console)
+		Serial4.attach(-1, STDOUT_FILENO);
+	else {
+		cout << "log port ";
+		int logFd = openPty(logLink);
+		if (logFd < 0)
+			exit(1);
+		Serial4.attach(logFd);
+	}
+
+	if (!eepromFile.empty() && !EEPROM.load(eepromFile.c_str()))
+		cout << "EEPROM file " << eepromFile << " not found, starting with an erased EEPROM" << endl;
+
+	Board& board = Board::getInstance();
+	board.setCpuFactor(cpuFactor);
+	board.setRealTime(!cmdOptionExists(argv, argv+argc, "-fast"));
+	ArmSimulation::getInstance().setup(config);
+
+	cout << "Cortex firmware cpu factor=" << cpuFactor << (board.isRealTime()?" real time":" fast") << endl;
+	setup();
+
+	CallProfile loopProfile;
+	loopProfile.reset();
+	uint64_t statsStart_us = board.now_us();
+	long statsInterruptCalls = board.getInterruptCalls();
+	uint64_t statsInterruptTime_us = board.getInterruptTime_us();
+	while (!stopRequested) {
+		uint64_t start_us = board.now_us();
+		loop();
+		yield(); // Teensyduino's main calls yield after each loop
+		uint64_t end_us = board.now_us();
+
+		loopProfile.add(end_us - start_us);
+
+		// account the computing time, wait for the wall clock if ahead
+		board.spend(0);
+
+		if ((statsInterval_s > 0) && (end_us - statsStart_us >= (uint64_t)statsInterval_s*1000000)) {
+			printStatistics(loopProfile, board.getInterruptCalls() - statsInterruptCalls, board.getInterruptTime_us() - statsInterruptTime_us, end_us - statsStart_us);
+			loopProfile.reset();
+			statsStart_us = end_us;
+			statsInterruptCalls = board.getInterruptCalls();
+			statsInterruptTime_us = board.getInterruptTime_us();
+		}
+	}
+
+	printStatistics(loopProfile, board.getInterruptCalls() - statsInterruptCalls, board.getInterruptTime_us() - statsInterruptTime_us, board.now_us() - statsStart_us);
+	if (!eepromFile.empty())
+		EEPROM.save(eepromFile.c_str());
+	unlink(cmdLink.c_str());
+	if (!console)
+		unlink(logLink.c_str());
+	return 0;
+}
@@ -0,0 +1,811 @@
+/*
+ * CortexEmulator.cpp
+ *
+ * Author: JochenAlt
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <termios.h>
+#include <iostream>
+#include <chrono>
+#include <thread>
+
+#include "CortexEmulator.h"
+
+CortexEmulator emulator;
+
+static string floatToString(float x) {
+	char buffer[32];
+	snprintf(buffer, sizeof(buffer), "%.2f", x);
+	return buffer;
+}
+
+float EmulatedActuator::getCurrentAngle(uint32_t now) {
+	advance(now);
+	int t = (int)(now - startTime);
+	if ((duration_ms <= 0) || (t >= duration_ms))
+		return targetAngle;
+	return startAngle + (targetAngle - startAngle)*t/duration_ms;
+}
+
+void EmulatedActuator::setAngle(float angle, int pDuration_ms, uint32_t now) {
+	startAngle = getCurrentAngle(now);
+	targetAngle = constrainAngle(angle);
+	startTime = now;
+	duration_ms = pDuration_ms;
+	queue.clear();
+}
+
+// start the next queued movement when the current one is over
+void EmulatedActuator::advance(uint32_t now) {
+	while (!queue.empty() && ((int)(now - startTime) >= duration_ms)) {
+		startAngle = targetAngle;
+		startTime += duration_ms;
+		targetAngle = queue.front().targetAngle;
+		duration_ms = max(0, (int)(queue.front().endTime - startTime));
+		queue.pop_front();
+	}
+}
+
+void EmulatedActuator::appendAngle(float angle, uint32_t time, uint32_t now) {
+	angle = constrainAngle(angle);
+	advance(now);
+	uint32_t endTime = startTime + duration_ms;
+	if (queue.empty() && ((int)(now - endTime) >= 0)) {
+		// nothing is moving anymore, start right now
+		startAngle = targetAngle;
+		targetAngle = angle;
+		startTime = now;
+		duration_ms = max(0, (int)(time - now));
+		return;
+	}
+	// full, stretch the last movement to the new end
+	if ((int)queue.size() >= MaxMovements - 1)
+		queue.pop_back();
+	QueuedMovement m = { angle, time };
+	queue.push_back(m);
+}
+
+float EmulatedActuator::constrainAngle(float angle) {
+	if (angle < minAngle)
+		return minAngle;
+	if (angle > maxAngle)
+		return maxAngle;
+	return angle;
+}
+
+CortexEmulator::CortexEmulator() {
+	setuped = false;
+	powered = false;
+	enabled = false;
+	withChecksum = false;
+	withFrames = false;
+	logLoop = false;
+	outage = false;
+	cmdMaster = cmdSlave = logMaster = logSlave = -1;
+	tokenIdx = savedTokenIdx = 0;
+	checksum = savedChecksum = 0;
+	errorCode = ABSOLUTELY_NO_ERROR;
+	inFrame = false;
+	startTime = 0;
+	startTime = now();
+	for (int i = 0;i<NumberOfActuators;i++) {
+		actuator[i].startAngle = 0;
+		actuator[i].targetAngle = 0;
+		actuator[i].startTime = 0;
+		actuator[i].duration_ms = 0;
+		actuator[i].minAngle = -180;
+		actuator[i].maxAngle = 180;
+		actuator[i].nullAngle = 0;
+	}
+	resetStream();
+}
+
+uint32_t CortexEmulator::now() {
+	return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count() - startTime;
+}
+
+// open a pseudo terminal. The slave is kept open, otherwise the master gets a hangup whenever
+// the webserver disconnects. The slave is raw, so nothing is echoed before the webserver configured it
+bool CortexEmulator::openPty(int& masterFd, int& slaveFd, string link) {
+	masterFd = posix_openpt(O_RDWR | O_NOCTTY);
+	if ((masterFd < 0) || (grantpt(masterFd) < 0) || (unlockpt(masterFd) < 0)) {
+		cerr << "opening pseudo terminal failed (" << strerror(errno) << ")" << endl;
+		return false;
+	}
+	string slaveName = ptsname(masterFd);
+	slaveFd = open(slaveName.c_str(), O_RDWR | O_NOCTTY);
+	if (slaveFd < 0) {
+		cerr << "opening " << slaveName << " failed (" << strerror(errno) << ")" << endl;
+		return false;
+	}
+	struct termios config;
+	tcgetattr(slaveFd, &config);
+	cfmakeraw(&config);
+	tcsetattr(slaveFd, TCSANOW, &config);
+
+	if (!link.empty()) {
+		unlink(link.c_str());
+		if (symlink(slaveName.c_str(), link.c_str()) < 0) {
+			cerr << "linking " << link << " to " << slaveName << " failed (" << strerror(errno) << ")" << endl;
+			return false;
+		}
+		cout << link << " -> " << slaveName << endl;
+	} else
+		cout << slaveName << endl;
+	return true;
+}
+
+bool CortexEmulator::setup(const EmulatorConfig& pConfig, string cmdLink, string logLink) {
+	config = pConfig;
+	cout << "command port ";
+	if (!openPty(cmdMaster, cmdSlave, cmdLink))
+		return false;
+	cout << "log port ";
+	if (!openPty(logMaster, logSlave, logLink))
+		return false;
+	return true;
+}
+
+void CortexEmulator::loop() {
+	struct pollfd fds[2] = { { cmdMaster, POLLIN, 0 }, { logMaster, POLLIN, 0 } };
+	uint8_t buffer[256];
+	while (true) {
+		int n = poll(fds, 2, -1);
+		if ((n < 0) && (errno != EINTR)) {
+			cerr << "poll failed (" << strerror(errno) << ")" << endl;
+			return;
+		}
+		if (n <= 0)
+			continue;
+		if (fds[0].revents & POLLIN) {
+			int len = read(cmdMaster, buffer, sizeof(buffer));
+			for (int i = 0;i<len;i++) {
+				uint8_t b = buffer[i];
+				if (disturb(b))
+					received(b);
+			}
+		}
+		// nobody is supposed to write to the log port, throw it away
+		if (fds[1].revents & POLLIN)
+			read(logMaster, buffer, sizeof(buffer));
+	}
+}
+
+// returns false if the byte gets lost, might flip a bit
+bool CortexEmulator::disturb(uint8_t& b) {
+	if (outage)
+		return false;
+	if ((config.dropRate > 0) && (rand() < config.dropRate*RAND_MAX))
+		return false;
+	if ((config.corruptRate > 0) && (rand() < config.corruptRate*RAND_MAX))
+		b ^= (1 << (rand() % 8));
+	return true;
+}
+
+void CortexEmulator::received(uint8_t b) {
+	// a start byte outside of a frame starts a binary frame, even within a text command
+	if (withFrames) {
+		CommFrameReceiver::Result result = frameReceiver.receive(b, now());
+		if (result == CommFrameReceiver::FRAME_STARTED)
+			line.clear();	// garbage of a frame that lost its start byte
+		if (result == CommFrameReceiver::FRAME_COMPLETE)
+			processFrame();
+		if (result != CommFrameReceiver::TEXT)
+			return;
+	}
+	if (b == '\r') {
+		processLine();
+		line.clear();
+	}
+	else if (isprint(b))
+		line += (char)b;
+}
+
+string CortexEmulator::nextToken() {
+	if (inFrame || (tokenIdx >= (int)tokens.size()))
+		return "";
+	savedTokenIdx = tokenIdx;
+	savedChecksum = checksum;
+	string token = tokens[tokenIdx++];
+	for (unsigned i = 0;i<token.length();i++)
+		checksum = ((checksum << 5) + checksum) + token[i]; /* hash * 33 + c */
+	return token;
+}
+
+void CortexEmulator::processLine() {
+	tokens.clear();
+	tokenIdx = savedTokenIdx = 0;
+	size_t start = line.find_first_not_of(' ');
+	while (start != string::npos) {
+		size_t end = line.find(' ', start);
+		tokens.push_back(line.substr(start, end-start));
+		start = line.find_first_not_of(' ', end);
+	}
+	if (tokens.empty())
+		return;
+
+	if (config.verbose)
+		cout << "> " << line << endl;
+
+	checksum = 0;
+	string command = nextToken();
+	errorCode = ABSOLUTELY_NO_ERROR;
+	reply.clear();
+	CommDefType* comm = CommDefType::find(command.c_str(), command.length());
+	if (comm != 0)
+		comm->cmdFunction();
+	else {
+		print(command);
+		replyError(UNRECOGNIZED_CMD);
+	}
+	resetError();
+	sendReply();
+}
+
+void CortexEmulator::processFrame() {
+	// a frame with wrong crc is passed to its handler anyway, endOfParams fails then
+	errorCode = CommFrame::check(frameReceiver.getFrame(), frameReceiver.getFrameLen())?ABSOLUTELY_NO_ERROR:CHECKSUM_WRONG;
+	inFrame = true;
+	reply.clear();
+	if (config.verbose)
+		cout << "> frame cmd=" << (int)getFrameCommand() << ((errorCode != ABSOLUTELY_NO_ERROR)?" crc wrong":"") << endl;
+
+	bool matched = false;
+	for (int i = 0;i<CommDefType::NumberOfCommands;i++) {
+		if (commDef[i].cmd == getFrameCommand()) {
+			commDef[i].cmdFunction();
+			matched = true;
+			break;
+		}
+	}
+	if (!matched)
+		replyError(UNRECOGNIZED_CMD);
+	resetError();
+	inFrame = false;
+	sendReply();
+}
+
+void CortexEmulator::sendReply() {
+	int delay_ms = config.latency_ms;
+	if (config.jitter_ms > 0)
+		delay_ms += rand() % (config.jitter_ms+1);
+	if (delay_ms > 0)
+		std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms));
+
+	if (config.verbose && !inFrame)
+		cout << "< " << reply << endl;
+	string disturbed;
+	for (unsigned i = 0;i<reply.length();i++) {
+		uint8_t b = reply[i];
+		if (disturb(b))
+			disturbed += (char)b;
+	}
+	if (write(cmdMaster, disturbed.c_str(), disturbed.length()) < 0)
+		cerr << "writing reply failed (" << strerror(errno) << ")" << endl;
+	reply.clear();
+}
+
+void CortexEmulator::log(const string& line) {
+	string str = line + "\r\n";
+	if (write(logMaster, str.c_str(), str.length()) < 0)
+		cerr << "writing log failed (" << strerror(errno) << ")" << endl;
+}
+
+bool CortexEmulator::getParamString(string& param) {
+	param = nextToken();
+	return !param.empty();
+}
+
+bool CortexEmulator::getParamInt(int& param) {
+	string arg = nextToken();
+	param = atoi(arg.c_str());
+	return !arg.empty();
+}
+
+bool CortexEmulator::getParamFloat(float& param) {
+	string arg = nextToken();
+	param = atof(arg.c_str());
+	return !arg.empty();
+}
+
+bool CortexEmulator::getNamedParamFloat(const char* name, float& param, bool& paramSet) {
+	paramSet = false;
+	string arg = nextToken();
+	size_t equalsIdx = arg.find('=');
+	if ((equalsIdx != string::npos) && (equalsIdx+1 < arg.length()) && (strcasecmp(arg.substr(0, equalsIdx).c_str(), name) == 0)) {
+		param = atof(arg.substr(equalsIdx+1).c_str());
+		paramSet = true;
+	} else if (!arg.empty())
+		unnext(); // not this parameter, push it back
+	return true;
+}
+
+bool CortexEmulator::endOfParams() {
+	if (inFrame)
+		return (errorCode == ABSOLUTELY_NO_ERROR); // crc has been checked already
+
+	if (withChecksum) {
+		uint8_t expectedChecksum = checksum;
+		string arg = nextToken();
+		if ((arg.compare(0, 4, "chk=") == 0) && (arg.length() > 4)) {
+			if (atoi(arg.substr(4).c_str()) == expectedChecksum)
+				return true;
+			print("chk!=" + std::to_string(expectedChecksum) + ")");
+			errorCode = CHECKSUM_WRONG;
+			return false;
+		}
+		print("chksum expected");
+		errorCode = CHECKSUM_EXPECTED;
+		return false;
+	}
+	return true;
+}
+
+const uint8_t* CortexEmulator::getFramePayload(uint8_t &len) {
+	len = frameReceiver.getFrame()[1] - 1;
+	return &frameReceiver.getFrame()[CommFrame::HeaderSize];
+}
+
+void CortexEmulator::replyOk() {
+	if (inFrame) {
+		uint8_t frame[CommFrame::MaxFrameSize];
+		uint8_t payload[CommFrame::ReplyPayloadSize] = { ABSOLUTELY_NO_ERROR, streamSeq };
+		int len = CommFrame::build(getFrameCommand(), payload, CommFrame::ReplyPayloadSize, frame);
+		reply.append((char*)frame, len);
+		return;
+	}
+	print(">ok\r\n>");
+}
+
+void CortexEmulator::replyError(int code) {
+	if ((code == PARAM_NUMBER_WRONG) && (errorCode != ABSOLUTELY_NO_ERROR))
+		code = errorCode;
+	if (inFrame) {
+		uint8_t frame[CommFrame::MaxFrameSize];
+		uint8_t payload[CommFrame::ReplyPayloadSize] = { (uint8_t)code, streamSeq };
+		int len = CommFrame::build(getFrameCommand(), payload, CommFrame::ReplyPayloadSize, frame);
+		reply.append((char*)frame, len);
+		return;
+	}
+	print(">nok(" + std::to_string(code) + ")\r\n>");
+}
+
+void CortexEmulator::resetStream() {
+	streamSeq = 0;
+	for (int i = 0;i<CommFrame::StreamWindowSize;i++)
+		streamPayloadLen[i] = 0;
+}
+
+// decode the payload of a MOVETO frame, angles come in 1/100 degree
+static bool decodeMoveTo(const uint8_t* payload, float angle[], int &duration) {
+	for (int i = 0;i<7;i++)
+		angle[i] = CommFrame::getInt16(&payload[i*2])/100.0;
+	duration = CommFrame::getInt16(&payload[7*2]);
+	return (duration <= 9999) && (duration>=20);
+}
+
+// decode the payload of a timed MOVETO frame
+static bool decodeMoveAt(const uint8_t* payload, float angle[], uint32_t &time) {
+	for (int i = 0;i<7;i++)
+		angle[i] = CommFrame::getInt16(&payload[i*2])/100.0;
+	time = CommFrame::getUInt32(&payload[7*2]);
+	return true;
+}
+
+void CortexEmulator::moveTo(float angle[], int duration_ms) {
+	string logLine = "moveTo ";
+	for (int i = 0;i<NumberOfActuators;i++) {
+		actuator[i].setAngle(angle[i], duration_ms, now());
+		if (i > 0)
+			logLine += ",";
+		logLine += floatToString(angle[i]);
+	}
+	if (logLoop)
+		log(logLine + "," + std::to_string(duration_ms));
+}
+
+void CortexEmulator::moveAt(float angle[], uint32_t time) {
+	string logLine = "moveAt ";
+	for (int i = 0;i<NumberOfActuators;i++) {
+		actuator[i].appendAngle(angle[i], time, now());
+		if (i > 0)
+			logLine += ",";
+		logLine += floatToString(angle[i]);
+	}
+	if (logLoop)
+		log(logLine + " @" + std::to_string(time));
+}
+
+// same as HostCommunication::streamMoveTo on the Cortex
+void CortexEmulator::streamMoveTo(const uint8_t* payload, uint8_t len) {
+	uint8_t seq = payload[0];
+	uint8_t ahead = seq - streamSeq;
+	if (ahead >= 128) {
+		// duplicate of an executed frame, its ack got lost
+		replyOk();
+		return;
+	}
+	if (ahead >= CommFrame::StreamWindowSize) {
+		replyError(FRAME_SEQUENCE_WRONG);
+		return;
+	}
+
+	int slot = seq % CommFrame::StreamWindowSize;
+	memcpy(streamPayload[slot], &payload[1], len);
+	streamPayloadLen[slot] = len;
+
+	while (streamPayloadLen[streamSeq % CommFrame::StreamWindowSize] > 0) {
+		slot = streamSeq % CommFrame::StreamWindowSize;
+		float angle[7];
+		if (streamPayloadLen[slot] == CommFrame::MoveAtPayloadSize) {
+			uint32_t time;
+			if (decodeMoveAt(streamPayload[slot], angle, time))
+				moveAt(angle, time);
+		} else {
+			int duration;
+			if (decodeMoveTo(streamPayload[slot], angle, duration))
+				moveTo(angle, duration);
+		}
+		streamPayloadLen[slot] = 0;
+		streamSeq++;
+	}
+
+	bool gap = false;
+	for (int i = 0;i<CommFrame::StreamWindowSize;i++)
+		gap = gap || (streamPayloadLen[i] > 0);
+	if (gap)
+		replyError(FRAME_SEQUENCE_WRONG);
+	else
+		replyOk();
+}
+
+// command handlers referenced by commDef, same replies as on the Cortex
+
+void cmdLED() {
+	string param;
+	bool paramsOK = emulator.getParamString(param);
+	paramsOK = emulator.endOfParams() && paramsOK;
+	if (paramsOK) {
+		if ((strncasecmp(param.c_str(), "on", 2) == 0) || (strncasecmp(param.c_str(), "off", 3) == 0) || (strncasecmp(param.c_str(), "blink", 5) == 0))
+			emulator.replyOk();
+		else
+			emulator.replyError(PARAM_WRONG);
+	} else
+		emulator.replyError(PARAM_NUMBER_WRONG);
+}
+
+void cmdHELP() {
+	if (emulator.endOfParams()) {
+		emulator.print("usage: see Cortex, this is the emulator\r\n");
+		emulator.replyOk();
+	} else
+		emulator.replyError(PARAM_NUMBER_WRONG);
+}
+
+void cmdECHO() {
+	string param;
+	bool paramsOK = emulator.getParamString(param);
+	paramsOK = emulator.endOfParams() && paramsOK;
+	if (paramsOK) {
+		emulator.print(param);
+		emulator.replyOk();
+	} else
+		emulator.replyError(PARAM_NUMBER_WRONG);
+}
+
+void cmdENABLE() {
+	if (emulator.endOfParams()) {
+		if (emulator.powered) {
+			emulator.enabled = true;
+			emulator.replyOk();
+		} else
+			emulator.replyError(getLastError());
+	} else
+		emulator.replyError(PARAM_NUMBER_WRONG);
+}
+
+void cmdDISABLE() {
+	if (emulator.endOfParams()) {
+		emulator.enabled = false;
+		emulator.replyOk();
+	} else
+		emulator.replyError(PARAM_NUMBER_WRONG);
+}
+
+void cmdSETUP() {
+	string param;
+	// force is optional, do not take the checksum for it
+	if (emulator.getParamString(param) && (param.compare(0, 4, "chk=") == 0))
+		emulator.unnext();
+	if (emulator.endOfParams()) {
+		emulator.setuped = true;
+		emulator.log("setup done");
+		emulator.replyOk();
+	} else
+		emulator.replyError(PARAM_NUMBER_WRONG);
+}
+
+void cmdPOWER() {
+	string param;
+	bool paramsOK = emulator.getParamString(param);
+	paramsOK = emulator.endOfParams() && paramsOK;
+	if (paramsOK) {
+		bool valueOK = false;
+		if (emulator.setuped) {
+			if (strncasecmp(param.c_str(), "on", 2) == 0) {
+				emulator.powered = true;
+				valueOK = true;
+			}
+		}
+		if (strncasecmp(param.c_str(), "off", 3) == 0) {
+			emulator.enabled = false;
+			emulator.powered = false;
+			valueOK = true;
+		}
+		if (valueOK)
+			emulator.replyOk();
+		else
+			emulator.replyError(PARAM_WRONG);
+	} else
+		emulator.replyError(PARAM_NUMBER_WRONG);
+}
+
+void cmdKNOB() {
+	int actuatorNo = 0;
+	bool paramsOK = emulator.getParamInt(actuatorNo);
+	paramsOK = emulator.endOfParams() && paramsOK;
+	if (paramsOK) {
+		if ((actuatorNo >= -1) && (actuatorNo <= 7))
+			emulator.replyOk();
+		else
+			emulator.replyError(PARAM_WRONG);
+	} else
+		emulator.replyError(PARAM_NUMBER_WRONG);
+}
+
+void cmdSTEP() {
+	int actuatorNo = 0;
+	float incr = 0;
+	bool paramsOK = emulator.getParamInt(actuatorNo);
+	paramsOK = paramsOK && emulator.getParamFloat(incr);
+	paramsOK = emulator.endOfParams() && paramsOK;
+	if (paramsOK) {
+		if ((actuatorNo >= 0) && (actuatorNo < CortexEmulator::NumberOfActuators) && (fabs(incr) < 10)) {
+			EmulatedActuator& a = emulator.actuator[actuatorNo];
+			a.setAngle(a.getCurrentAngle(emulator.now()) + incr, fabs(incr)*50, emulator.now());
+			emulator.replyOk();
+		} else
+			emulator.replyError(PARAM_WRONG);
+	} else
+		emulator.replyError(PARAM_NUMBER_WRONG);
+}
+
+void cmdCHECKSUM() {
+	string param;
+	bool paramsOK = emulator.getParamString(param);
+	if (paramsOK) {
+		bool valueOK = false;
+		if (strncasecmp(param.c_str(), "on", 2) == 0) {
+			emulator.withChecksum = true;
+			emulator.withFrames = false;
+			valueOK = true;
+		}
+		if (strncasecmp(param.c_str(), "off", 3) == 0) {
+			emulator.withChecksum = false;
+			emulator.withFrames = false;
+			valueOK = true;
+		}
+		if (strncasecmp(param.c_str(), "binary", 6) == 0) {
+			emulator.withChecksum = true;
+			emulator.withFrames = true;
+			emulator.resetStream();
+			valueOK = true;
+		}
+		if (valueOK)
+			emulator.replyOk();
+		else
+			emulator.replyError(PARAM_WRONG);
+	} else
+		emulator.replyError(PARAM_NUMBER_WRONG);
+}
+
+void cmdMEM() {
+	string param;
+	bool paramsOK = emulator.getParamString(param);
+	paramsOK = emulator.endOfParams() && paramsOK;
+	if (paramsOK) {
+		if ((strncasecmp(param.c_str(), "reset", 5) == 0) || (strncasecmp(param.c_str(), "list", 4) == 0))
+			emulator.replyOk();
+		else
+			emulator.replyError(PARAM_WRONG);
+	} else
+		emulator.replyError(PARAM_NUMBER_WRONG);
+}
+
+void cmdSET() {
+	int actuatorNo = 0;
+	float value = 0;
+	bool set = false;
+	bool valueOK = false;
+	bool paramsOK = emulator.getParamInt(actuatorNo);
+	bool validNo = (actuatorNo >= 0) && (actuatorNo < CortexEmulator::NumberOfActuators);
+	EmulatedActuator dummy;
+	EmulatedActuator& a = validNo?emulator.actuator[actuatorNo]:dummy;
+
+	// same order as on the Cortex, values that are not emulated are accepted only
+	emulator.getNamedParamFloat("min", value, set);
+	if (set && (fabs(value) < 180)) { a.minAngle = value; valueOK = true; }
+	emulator.getNamedParamFloat("max", value, set);
+	if (set && (fabs(value) < 180)) { a.maxAngle = value; valueOK = true; }
+	emulator.getNamedParamFloat("null", value, set);
+	if (set && (fabs(value) < 360)) { a.nullAngle = value; valueOK = true; }
+	const char* others[] = { "speed", "acc", "P", "I", "D" };
+	for (int i = 0;i<5;i++) {
+		emulator.getNamedParamFloat(others[i], value, set);
+		valueOK = valueOK || set;
+	}
+	paramsOK = emulator.endOfParams() && paramsOK;
+	if (paramsOK) {
+		if (validNo && valueOK)
+			emulator.replyOk();
+		else
+			emulator.replyError(PARAM_WRONG);
+	} else
+		emulator.replyError(PARAM_NUMBER_WRONG);
+}
+
+static void printActuator(int i) {
+	EmulatedActuator& a = emulator.actuator[i];
+	emulator.print(" n=" + std::to_string(i) +
+			" ang=" + floatToString(a.getCurrentAngle(emulator.now())) +
+			" min=" + floatToString(a.minAngle) +
+			" max=" + floatToString(a.maxAngle) +
+			" null=" + floatToString(a.nullAngle));
+}
+
+void cmdGET() {
+	string param;
+	bool paramsOK = emulator.getParamString(param);
+	paramsOK = emulator.endOfParams() && paramsOK;
+	if (paramsOK) {
+		bool isAll = (strncasecmp(param.c_str(), "all", 3) == 0);
+		int actuatorNo = -1;
+		if (!isAll && (param[0] >= '0') && (param[0] <= '6'))
+			actuatorNo = atoi(param.c_str());
+		if (!isAll && (actuatorNo < 0))
+			emulator.replyError(PARAM_WRONG);
+		else if (!emulator.setuped)
+			emulator.replyError(CORTEX_SETUP_MISSING);
+		else {
+			if (isAll)
+				for (int i = 0;i<CortexEmulator::NumberOfActuators;i++)
+					printActuator(i);
+			else
+				printActuator(actuatorNo);
+			emulator.replyOk();
+		}
+	} else
+		emulator.replyError(PARAM_NUMBER_WRONG);
+}
+
+void cmdMOVETO() {
+	float angle[7] = {0,0,0,0,0,0,0};
+	bool paramsOK = true;
+	int duration = 0;
+	uint32_t time = 0;
+	bool timed = false;
+	if (emulator.isFrame()) {
+		uint8_t len;
+		const uint8_t* payload = emulator.getFramePayload(len);
+		if (emulator.endOfParams() && ((len == CommFrame::MoveToStreamPayloadSize) || (len == CommFrame::MoveAtStreamPayloadSize))) {
+			emulator.streamMoveTo(payload, len-1);
+			return;
+		}
+		timed = (len == CommFrame::MoveAtPayloadSize);
+		if (timed)
+			paramsOK = decodeMoveAt(payload, angle, time);
+		else
+			paramsOK = (len == CommFrame::MoveToPayloadSize) && decodeMoveTo(payload, angle, duration);
+	} else {
+		for (int i = 0;i<7;i++)
+			paramsOK = emulator.getParamFloat(angle[i]) && (fabs(angle[i]) <= 360.0) && paramsOK;
+		string param;
+		bool paramSet = emulator.getParamString(param);
+		timed = paramSet && (strncasecmp(param.c_str(), "at=", 3) == 0);
+		if (timed)
+			time = strtoul(param.c_str()+3, NULL, 10);
+		else {
+			if (paramSet)
+				emulator.unnext();
+			paramsOK = emulator.getParamInt(duration) && (duration <= 9999) && (duration>=20) && paramsOK;
+		}
+	}
+	paramsOK = emulator.endOfParams() && paramsOK;
+	if (paramsOK) {
+		if (timed)
+			emulator.moveAt(angle, time);
+		else
+			emulator.moveTo(angle, duration);
+		emulator.replyOk();
+	} else
+		emulator.replyError(PARAM_NUMBER_WRONG);
+}
+
+void cmdLOG() {
+	string logClass, onOff;
+	bool paramsOK = emulator.getParamString(logClass);
+	paramsOK = emulator.getParamString(onOff) && paramsOK;
+	paramsOK = emulator.endOfParams() && paramsOK;
+	if (paramsOK) {
+		emulator.log("log " + logClass + " " + onOff);
+		bool onOffSet = (strncasecmp(onOff.c_str(), "on", 2) == 0) || (strncasecmp(onOff.c_str(), "off", 3) == 0);
+		const char* classes[] = { "setup", "servo", "stepper", "encoder", "test", "loop" };
+		bool valueOK = false;
+		for (int i = 0;i<6;i++)
+			valueOK = valueOK || (onOffSet && (strncasecmp(logClass.c_str(), classes[i], 5) == 0));
+		if (valueOK && (strncasecmp(logClass.c_str(), "loop", 4) == 0))
+			emulator.logLoop = (strncasecmp(onOff.c_str(), "on", 2) == 0);
+		if (valueOK)
+			emulator.replyOk();
+		else
+			emulator.replyError(PARAM_WRONG);
+	} else
+		emulator.replyError(PARAM_NUMBER_WRONG);
+}
+
+void cmdINFO() {
+	if (emulator.endOfParams()) {
+		if (emulator.powered)
+			emulator.print(" powered");
+		if (emulator.setuped)
+			emulator.print(" setuped");
+		if (emulator.enabled)
+			emulator.print(" enabled");
+		emulator.print(" i2c0=() i2c1=()");
+		emulator.replyOk();
+	} else
+		emulator.replyError(PARAM_NUMBER_WRONG);
+}
+
+// the printer is not emulated, print to log port instead
+static void print(bool newLine) {
+	string text, param;
+	while (emulator.getParamString(param)) {
+		if (param.compare(0, 4, "chk=") == 0) {
+			emulator.unnext();
+			break;
+		}
+		text += (text.empty()?"":" ") + param;
+	}
+	if (emulator.endOfParams()) {
+		emulator.log("print " + text + (newLine?"\\n":""));
+		emulator.replyOk();
+	} else
+		emulator.replyError(PARAM_NUMBER_WRONG);
+}
+
+void cmdPRINT() {
+	print(false);
+}
+
+void cmdPRINTLN() {
+	print(true);
+}
+
+void cmdTIME() {
+	if (emulator.endOfParams()) {
+		emulator.print(" t=" + std::to_string(emulator.now()));
+		emulator.replyOk();
+	} else
+		emulator.replyError(PARAM_NUMBER_WRONG);
+}
@@ -0,0 +1,142 @@
+/*
+ * CortexEmulator.h
+ *
+ * Emulates Walter's Cortex on a pair of pseudo terminals (command and log port),
+ * so the webserver can run without the Teensy. Implements the command set of CommDef
+ * with the same checksum and frame rules as the Cortex, moves the joints linearly
+ * and can disturb the communication by latency, jitter, dropped and corrupted bytes.
+ *
+ * Author: JochenAlt
+ */
+
+#ifndef CORTEXEMULATOR_H_
+#define CORTEXEMULATOR_H_
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <stdint.h>
+
+#include "CommDef.h"
+#include "core.h"
+
+using namespace std;
+
+// disturbances of the serial communication
+struct EmulatorConfig {
+	int latency_ms;				// delay before a reply is sent
+	int jitter_ms;				// additional random delay between 0 and jitter_ms
+	double dropRate;			// probability that a byte gets lost, both directions
+	double corruptRate;			// probability that a bit of a byte flips, both directions
+	bool verbose;				// print all commands and replies to stdout
+};
+
+// one joint moving linearly from startAngle to targetAngle, angles in degrees. Timed MOVETOs
+// are queued behind, like AngleMovementQueue on the Cortex
+struct EmulatedActuator {
+	static const int MaxMovements = 8;
+	struct QueuedMovement {
+		float targetAngle;
+		uint32_t endTime;
+	};
+
+	float startAngle;
+	float targetAngle;
+	uint32_t startTime;
+	int duration_ms;
+	std::deque<QueuedMovement> queue;
+	float minAngle;
+	float maxAngle;
+	float nullAngle;
+
+	float getCurrentAngle(uint32_t now);
+	void setAngle(float angle, int duration_ms, uint32_t now);
+	void appendAngle(float angle, uint32_t time, uint32_t now);
+	float constrainAngle(float angle);
+private:
+	void advance(uint32_t now);
+};
+
+class CortexEmulator {
+public:
+	static const int NumberOfActuators = 7;
+
+	CortexEmulator();
+
+	// open pseudo terminals, their slave devices are symlinked to the passed paths
+	bool setup(const EmulatorConfig& config, string cmdLink, string logLink);
+
+	// serve commands until killed
+	void loop();
+
+	// parameter parsing for the command handlers, same semantics as SerialCommand on the Cortex
+	bool getParamString(string& param);
+	bool getParamInt(int& param);
+	bool getParamFloat(float& param);
+	bool getNamedParamFloat(const char* name, float& param, bool& paramSet);
+	bool endOfParams();
+	void unnext() { tokenIdx = savedTokenIdx; checksum = savedChecksum; };
+	bool isFrame() { return inFrame; };
+	const uint8_t* getFramePayload(uint8_t& len);
+	uint8_t getFrameCommand() { return frameReceiver.getFrame()[2]; };
+	int getErrorCode() { return errorCode; };
+
+	// output of command handlers, sent together with the reply
+	void print(const string& s) { reply += s; };
+	void replyOk();
+	void replyError(int errorCode);
+
+	// write a line to the log port
+	void log(const string& line);
+
+	// state of the emulated bot
+	EmulatedActuator actuator[NumberOfActuators];
+	bool setuped;
+	bool powered;
+	bool enabled;
+	bool withChecksum;
+	bool withFrames;
+	bool logLoop;
+	volatile bool outage;			// line is down, all bytes get lost. Switched by SIGUSR1
+
+	// streamed MOVETO frames, same as HostCommunication on the Cortex
+	void resetStream();
+	void streamMoveTo(const uint8_t* payload, uint8_t len);
+	void moveTo(float angle[], int duration_ms);
+	void moveAt(float angle[], uint32_t time);
+	uint8_t streamSeq;
+	uint8_t streamPayload[CommFrame::StreamWindowSize][CommFrame::MoveAtPayloadSize];
+	uint8_t streamPayloadLen[CommFrame::StreamWindowSize];
+
+	uint32_t now();
+private:
+	bool openPty(int& masterFd, int& slaveFd, string link);
+	void received(uint8_t b);
+	void processLine();
+	void processFrame();
+	void sendReply();
+	bool disturb(uint8_t& b);
+	string nextToken();
+
+	EmulatorConfig config;
+	int cmdMaster, cmdSlave;
+	int logMaster, logSlave;
+
+	string line;						// text command currently received
+	vector<string> tokens;				// tokens of the current command
+	int tokenIdx;
+	int savedTokenIdx;
+	uint8_t checksum;
+	uint8_t savedChecksum;
+	int errorCode;
+
+	CommFrameReceiver frameReceiver;
+	bool inFrame;
+
+	string reply;						// reply of the current command, sent when the command is done
+	uint32_t startTime;
+};
+
+extern CortexEmulator emulator;
+
+#endif /* CORTEXEMULATOR_H_ */
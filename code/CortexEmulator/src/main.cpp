@@ -0,0 +1,104 @@
+//============================================================================
+// Name        : main.cpp
+// Author      : Jochen Alt
+//============================================================================
+
+#include <iostream>
+#include <algorithm>
+#include <signal.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "CortexEmulator.h"
+
+using namespace std;
+
+string cmdLink = "/tmp/cortex-cmd";
+string logLink = "/tmp/cortex-log";
+
+void signalHandler(int s){
+	cout << "Signal " << s << ". Exiting" << endl;
+	unlink(cmdLink.c_str());
+	unlink(logLink.c_str());
+	exit(1);
+}
+
+// switches a line outage on and off, used to test the recovery of the webserver
+void outageHandler(int s){
+	emulator.outage = !emulator.outage;
+}
+
+char* getCmdOption(char ** begin, char ** end, const std::string & option)
+{
+    char ** itr = std::find(begin, end, option);
+    if (itr != end && ++itr != end)
+    {
+        return *itr;
+    }
+    return 0;
+}
+
+bool cmdOptionExists(char** begin, char** end, const std::string& option)
+{
+    return std::find(begin, end, option) != end;
+}
+
+void printUsage(string prg) {
+	cout << "usage: " << prg << " [-h] [-cmd <link>] [-log <link>] [-latency <ms>] [-jitter <ms>] [-drop <rate>] [-corrupt <rate>] [-v]" << endl
+		 << "   [-h]                 help" << endl
+		 << "   [-cmd <link>]        symlink to command port (default " << cmdLink << ")" << endl
+		 << "   [-log <link>]        symlink to log port (default " << logLink << ")" << endl
+		 << "   [-latency <ms>]      delay of each reply" << endl
+		 << "   [-jitter <ms>]       additional random delay of each reply" << endl
+		 << "   [-drop <rate>]       probability of a lost byte, e.g. 0.001" << endl
+		 << "   [-corrupt <rate>]    probability of a corrupted byte" << endl
+		 << "   [-v]                 print commands and replies" << endl
+		 << "SIGUSR1 switches a line outage on and off, all bytes get lost in between" << endl
+		 << "start the webserver with -cmd <link> -log <link>" << endl;
+}
+
+int main(int argc, char *argv[]) {
+	if(cmdOptionExists(argv, argv+argc, "-h")) {
+		printUsage(argv[0]);
+		exit(0);
+    }
+
+	EmulatorConfig config;
+	config.latency_ms = 0;
+	config.jitter_ms = 0;
+	config.dropRate = 0;
+	config.corruptRate = 0;
+	config.verbose = cmdOptionExists(argv, argv+argc, "-v");
+
+	char* option = getCmdOption(argv, argv + argc, "-cmd");
+	if (option)
+		cmdLink = option;
+	option = getCmdOption(argv, argv + argc, "-log");
+	if (option)
+		logLink = option;
+	option = getCmdOption(argv, argv + argc, "-latency");
+	if (option)
+		config.latency_ms = atoi(option);
+	option = getCmdOption(argv, argv + argc, "-jitter");
+	if (option)
+		config.jitter_ms = atoi(option);
+	option = getCmdOption(argv, argv + argc, "-drop");
+	if (option)
+		config.dropRate = atof(option);
+	option = getCmdOption(argv, argv + argc, "-corrupt");
+	if (option)
+		config.corruptRate = atof(option);
+
+	signal(SIGINT, signalHandler);
+	signal(SIGTERM, signalHandler);
+	signal(SIGUSR1, outageHandler);
+	srand(time(NULL));
+
+	if (!emulator.setup(config, cmdLink, logLink))
+		exit(1);
+
+	cout << "Cortex emulator latency=" << config.latency_ms << "ms jitter=" << config.jitter_ms << "ms drop=" << config.dropRate << " corrupt=" << config.corruptRate << endl;
+	emulator.loop();
+	return 0;
+}
@@ -1,4 +1,7 @@
 #include "CommDef.h"
+#include <ctype.h>
+#include <string.h>
+#include <strings.h>
 
 // functions pointers implementing a command. Used on Cortex' side only. On the webserver, these commands are implemented with empty functions
 extern void cmdLED();
@@ -20,6 +23,7 @@ extern void cmdINFO();
 extern void cmdCONFIG();
 extern void cmdPRINT();
 extern void cmdPRINTLN();
+extern void cmdTIME();
 
 CommDefType commDef[CommDefType::NumberOfCommands] {
 	//cmd ID						Name, 		timeout,	function pointer
@@ -40,7 +44,8 @@ CommDefType commDef[CommDefType::NumberOfCommands] {
 	{ CommDefType::LOG_CMD,	        "Log", 		200, 		cmdLOG },
 	{ CommDefType::INFO_CMD,	    "INFO", 	200, 		cmdINFO },
 	{ CommDefType::PRINT_CMD,	    "PRINT", 	1000, 		cmdPRINT},
-	{ CommDefType::PRINTLN_CMD,	    "PRINTLN", 	1000, 		cmdPRINTLN}
+	{ CommDefType::PRINTLN_CMD,	    "PRINTLN", 	1000, 		cmdPRINTLN},
+	{ CommDefType::TIME_CMD,	    "TIME", 	100, 		cmdTIME}
 
 };
 
@@ -52,3 +57,133 @@ CommDefType* CommDefType::get(CommDefType::CommandType cmd) {
 	}
 	return 0;
 }
+
+// Perfect hash of the command names, first and last character plus length tell them apart.
+// The static_assert below checks that each command gets its own slot, a new command needs to be added there
+static const int NameHashSize = 32;
+static const int8_t NameHashEmpty = -1;
+static int8_t nameHashIndex[NameHashSize];
+
+// constexpr versions of toupper and strlen, the hash is checked at compile time
+static constexpr char upperCase(char c) {
+	return ((c >= 'a') && (c <= 'z'))?(c - 'a' + 'A'):c;
+}
+
+static constexpr int nameLength(const char* name) {
+	return (*name == 0)?0:1 + nameLength(name+1);
+}
+
+static constexpr uint8_t nameHash(const char* name, int len) {
+	return (upperCase(name[0])*13 + upperCase(name[len-1])*23 + len*4) % NameHashSize;
+}
+
+// true if none of the names has the passed hash
+static constexpr bool hashDiffers(uint8_t) {
+	return true;
+}
+
+template<typename... Names> static constexpr bool hashDiffers(uint8_t hash, const char* name, Names... rest) {
+	return (nameHash(name, nameLength(name)) != hash) && hashDiffers(hash, rest...);
+}
+
+// true if all names have different hashes
+static constexpr bool hashesDistinct() {
+	return true;
+}
+
+template<typename... Names> static constexpr bool hashesDistinct(const char* name, Names... rest) {
+	return hashDiffers(nameHash(name, nameLength(name)), rest...) && hashesDistinct(rest...);
+}
+
+template<typename... Names> static constexpr int numberOfNames(Names...) {
+	return sizeof...(Names);
+}
+
+// names of commDef
+#define COMMAND_NAMES "LED", "HELP", "ECHO", "ENABLE", "DISABLE", "SETUP", "POWER", "KNOB", "STEP", "CHECKSUM", \
+					  "MEM", "SET", "GET", "MOVETO", "Log", "INFO", "PRINT", "PRINTLN", "TIME"
+static_assert(numberOfNames(COMMAND_NAMES) == CommDefType::NumberOfCommands, "COMMAND_NAMES does not match commDef");
+static_assert(hashesDistinct(COMMAND_NAMES), "command names collide in nameHash");
+
+static bool initNameHash() {
+	for (int i = 0;i<NameHashSize;i++)
+		nameHashIndex[i] = NameHashEmpty;
+	for (int i = 0;i<CommDefType::NumberOfCommands;i++)
+		nameHashIndex[nameHash(commDef[i].name, strlen(commDef[i].name))] = i;
+	return true;
+}
+
+// commDef is defined above, so it is initialized already
+static bool nameHashInitialized = initNameHash();
+
+CommDefType* CommDefType::find(const char* name, int len) {
+	if (len <= 0)
+		return 0;
+	int8_t idx = nameHashIndex[nameHash(name, len)];
+	if ((idx != NameHashEmpty) && ((int)strlen(commDef[idx].name) == len) && (strncasecmp(commDef[idx].name, name, len) == 0))
+		return &commDef[idx];
+	return 0;
+}
+
+uint16_t CommFrame::crc16(const uint8_t* data, int len, uint16_t crc) {
+	for (int i = 0;i<len;i++) {
+		crc ^= ((uint16_t)data[i]) << 8;
+		for (int bit = 0;bit<8;bit++)
+			crc = (crc & 0x8000)?((crc << 1) ^ 0x1021):(crc << 1);
+	}
+	return crc;
+}
+
+int CommFrame::build(uint8_t cmd, const uint8_t* payload, int payloadLen, uint8_t* frame) {
+	frame[0] = StartByte;
+	frame[1] = (uint8_t)(payloadLen + 1);
+	frame[2] = cmd;
+	for (int i = 0;i<payloadLen;i++)
+		frame[HeaderSize+i] = payload[i];
+	uint16_t crc = crc16(&frame[1], payloadLen+2);
+	frame[HeaderSize+payloadLen] = (uint8_t)(crc & 0xFF);
+	frame[HeaderSize+payloadLen+1] = (uint8_t)(crc >> 8);
+	return HeaderSize + payloadLen + CRCSize;
+}
+
+bool CommFrame::check(const uint8_t* frame, int frameLen) {
+	if ((frameLen < HeaderSize + CRCSize) || (frame[0] != StartByte))
+		return false;
+	int len = frame[1];
+	if ((len < 1) || (len > MaxPayloadSize+1) || (frameLen != len + 2 + CRCSize))
+		return false;
+	uint16_t crc = crc16(&frame[1], len+1);
+	return (frame[len+2] == (uint8_t)(crc & 0xFF)) && (frame[len+3] == (uint8_t)(crc >> 8));
+}
+
+CommFrameReceiver::Result CommFrameReceiver::receive(uint8_t b, uint32_t now) {
+	// a frame is sent in one go, a gap means that bytes got lost
+	if ((pos > 0) && (now - lastByteTime > ByteTimeout))
+		pos = 0;
+	lastByteTime = now;
+
+	if (pos == 0) {
+		if (b != CommFrame::StartByte)
+			return TEXT;
+		buffer[pos++] = b;
+		return FRAME_STARTED;
+	}
+
+	// cannot happen with a valid length byte, but never write outside the buffer
+	if ((pos < 0) || (pos >= CommFrame::MaxFrameSize)) {
+		pos = 0;
+		return FRAME_DROPPED;
+	}
+	buffer[pos++] = b;
+	int payloadLen = buffer[1]; // command id and payload
+	if ((payloadLen < 1) || (payloadLen > CommFrame::MaxPayloadSize + 1)) {
+		pos = 0;
+		return FRAME_DROPPED;
+	}
+	if (pos == payloadLen + 2 + CommFrame::CRCSize) {
+		len = pos;
+		pos = 0;
+		return FRAME_COMPLETE;
+	}
+	return FRAME_INCOMPLETE;
+}
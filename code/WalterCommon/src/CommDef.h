@@ -10,8 +10,10 @@
 #ifndef COMM_DEF_H_
 #define COMM_DEF_H_
 
+#include <stdint.h>
+
 struct CommDefType {
-	static const int NumberOfCommands = 18;
+	static const int NumberOfCommands = 19;
 
 	// all possible commands the uC provides
 	enum CommandType { 	LED_CMD = 0,
@@ -31,7 +33,8 @@ struct CommDefType {
 						INFO_CMD = 14,
 						SETUP_CMD = 15,
 						PRINT_CMD = 16,
-						PRINTLN_CMD = 17
+						PRINTLN_CMD = 17,
+						TIME_CMD = 18
 
 	};
 	CommandType cmd;
@@ -41,8 +44,95 @@ struct CommDefType {
 	// Pointer to the default handler function
     void (*cmdFunction)();
 	static CommDefType* get(CommandType cmd);
+
+	// case-insensitive lookup of a command by its name of len characters, returns 0 if unknown
+	static CommDefType* find(const char* name, int len);
 };
 
 extern CommDefType commDef[];
 
+// Binary framing of commands, an alternative to the text protocol. It is switched on with "CHECKSUM binary"
+// and used for the frequent commands only (MOVETO), everything else remains text.
+// A frame looks like
+//		StartByte | length | command id | payload | crc16 (low byte first)
+// length counts command id and payload, the crc covers length, command id and payload.
+// Cortex replies with a frame of the same command id, a status byte (0 = ok, otherwise error code) and
+// the next expected sequence number of streamed MOVETOs.
+//
+// Streamed MOVETO frames carry a sequence number in front of the MOVETO payload. The host keeps up to
+// StreamWindowSize frames in flight. Cortex executes them in sequence order and acknowledges cumulatively
+// by replying the next expected sequence number. A status != 0 is a NAK of exactly that frame, frames
+// that arrived ahead of it are kept by the Cortex, so only the missing one is resent.
+struct CommFrame {
+	static const uint8_t StartByte = 0x02;			// STX, never part of a printable text command
+	static const int HeaderSize = 3;				// start byte, length, command id
+	static const int CRCSize = 2;
+	static const int MaxPayloadSize = 32;
+	static const int MaxFrameSize = HeaderSize + MaxPayloadSize + CRCSize;
+
+	// MOVETO payload: 7 angles in 1/100 degree, duration in ms, each as int16
+	static const int MoveToPayloadSize = 7*2 + 2;
+	static const int MoveToStreamPayloadSize = 1 + MoveToPayloadSize;	// sequence number + MOVETO payload
+	// timed MOVETO payload: 7 angles in 1/100 degree as int16, Cortex time in ms the angles are reached as uint32.
+	// Cortex queues it behind the movements it has already (see TIME command to get Cortex' time)
+	static const int MoveAtPayloadSize = 7*2 + 4;
+	static const int MoveAtStreamPayloadSize = 1 + MoveAtPayloadSize;
+	static const int ReplyPayloadSize = 2;								// status, next expected sequence number
+	static const int StreamWindowSize = 4;								// frames buffered on Cortex's side
+
+	// CRC-16/CCITT (polynom 0x1021, start 0xFFFF), bitwise to save flash on the Cortex
+	static uint16_t crc16(const uint8_t* data, int len, uint16_t crc = 0xFFFF);
+
+	// put payload into a frame, returns the size of the frame
+	static int build(uint8_t cmd, const uint8_t* payload, int payloadLen, uint8_t* frame);
+
+	// checks length and crc of a completely received frame
+	static bool check(const uint8_t* frame, int frameLen);
+
+	static void putInt16(uint8_t* buffer, int16_t value) {
+		buffer[0] = (uint8_t)(value & 0xFF);
+		buffer[1] = (uint8_t)(((uint16_t)value) >> 8);
+	}
+	static int16_t getInt16(const uint8_t* buffer) {
+		return (int16_t)(buffer[0] | (buffer[1] << 8));
+	}
+	static void putUInt32(uint8_t* buffer, uint32_t value) {
+		for (int i = 0;i<4;i++)
+			buffer[i] = (uint8_t)(value >> (i*8));
+	}
+	static uint32_t getUInt32(const uint8_t* buffer) {
+		return (uint32_t)buffer[0] | ((uint32_t)buffer[1] << 8) | ((uint32_t)buffer[2] << 16) | ((uint32_t)buffer[3] << 24);
+	}
+};
+
+// Collects frames byte by byte from a stream that carries text commands as well. Outside of a frame, a start
+// byte always starts a new frame and the receiver drops its partial text command, since text never contains
+// a start byte. A frame whose bytes stop arriving or whose length is implausible is dropped, so a lost byte
+// does not block the frames after it.
+class CommFrameReceiver {
+public:
+	static const uint32_t ByteTimeout = 10;		// [ms] max time between two bytes of a frame
+
+	enum Result { TEXT,					// byte is not part of a frame
+				  FRAME_STARTED,		// start byte of a new frame
+				  FRAME_INCOMPLETE,		// byte has been added to the frame
+				  FRAME_COMPLETE,		// frame is complete, see getFrame (crc is not checked)
+				  FRAME_DROPPED };		// byte has been dropped together with the frame
+
+	CommFrameReceiver() { reset(); };
+	void reset() { pos = 0; len = 0; lastByteTime = 0; };
+
+	// pass each received byte, now is the current time in [ms]
+	Result receive(uint8_t b, uint32_t now);
+
+	// last completed frame
+	const uint8_t* getFrame() const { return buffer; };
+	int getFrameLen() const { return len; };
+private:
+	uint8_t buffer[CommFrame::MaxFrameSize];
+	int pos;							// number of bytes received of the current frame, 0 if none
+	int len;							// length of the last completed frame
+	uint32_t lastByteTime;
+};
+
 #endif
@@ -2,7 +2,12 @@
 #include <sstream>
 #include <string>
 
+// the webserver runs several threads, each one has its own error
+#ifdef ARDUINO
 ErrorCodeType glbError = ErrorCodeType::ABSOLUTELY_NO_ERROR;
+#else
+thread_local ErrorCodeType glbError = ErrorCodeType::ABSOLUTELY_NO_ERROR;
+#endif
 
 void resetError() {
 	glbError = ErrorCodeType::ABSOLUTELY_NO_ERROR;
@@ -34,6 +39,7 @@ std::string getErrorMessage(ErrorCodeType err) {
 	case PARAM_WRONG: 					msg << "parameter wrong";break;
 	case PARAM_NUMBER_WRONG: 			msg << "number of parameter wrong";break;
 	case UNRECOGNIZED_CMD: 				msg << "unknown command";break;
+	case FRAME_SEQUENCE_WRONG: 			msg << "frame out of sequence";break;
 
 	// encoder
 	case ENCODER_CONNECTION_FAILED: 	msg << "Encoder connection failed";break;
@@ -62,6 +68,7 @@ std::string getErrorMessage(ErrorCodeType err) {
 
 	// Webserver
 	case WEBSERVER_TIMEOUT: 			msg << "no response from webserver (timeout)";break;
+	case WEBSERVER_CONNECTION_FAILED: 	msg << "connection to webserver failed";break;
 
 	case UNKNOWN_ERROR: 				msg << "mysterious error";break;
 
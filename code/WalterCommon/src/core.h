@@ -12,7 +12,7 @@
 enum ErrorCodeType { ABSOLUTELY_NO_ERROR = 0,
 	// cortex communication errors
 	CHECKSUM_EXPECTED = 1 , CHECKSUM_WRONG = 2,	PARAM_WRONG = 3, PARAM_NUMBER_WRONG = 4, UNRECOGNIZED_CMD = 5,
-	CORTEX_POWER_ON_WITHOUT_SETUP= 6,	CORTEX_SETUP_MISSING = 7,
+	CORTEX_POWER_ON_WITHOUT_SETUP= 6,	CORTEX_SETUP_MISSING = 7, FRAME_SEQUENCE_WRONG = 8,
 
 	// encoder errors
 	ENCODER_CONNECTION_FAILED = 10 ,ENCODER_CALL_FAILED = 11,ENCODER_CHECK_FAILED = 12,
@@ -30,7 +30,7 @@ enum ErrorCodeType { ABSOLUTELY_NO_ERROR = 0,
 	CORTEX_CONNECTION_FAILED = 50, CORTEX_COM_FAILED = 51, CORTEX_LOG_COM_FAILED=52, CORTEX_NO_RESPONSE =53,
 
 	// Webserver errors
-	WEBSERVER_TIMEOUT = 60,
+	WEBSERVER_TIMEOUT = 60, WEBSERVER_CONNECTION_FAILED = 61,
 
 	// last exit Brooklyn
 	UNKNOWN_ERROR= 99
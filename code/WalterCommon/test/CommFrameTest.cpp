@@ -0,0 +1,224 @@
+/*
+ * CommFrameTest.cpp
+ *
+ * Loopback test of the binary frames between webserver and Cortex: MOVETO frames are built
+ * like CortexController does, passed byte by byte through CommFrameReceiver like SerialCommand
+ * does, and decoded like HostCommunication does. Covers corrupted crc, truncated frames and
+ * resynchronisation after lost bytes and garbage. Checks the lookup of commands by name.
+ *
+ * Author: JochenAlt
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <string>
+#include <vector>
+
+#include "CommDef.h"
+
+using namespace std;
+
+// command handlers referenced by the command table in CommDef.cpp, not used here
+void cmdLED() {}; void cmdHELP() {}; void cmdECHO() {}; void cmdENABLE() {}; void cmdDISABLE() {};
+void cmdSETUP() {}; void cmdPOWER() {}; void cmdKNOB() {}; void cmdSTEP() {}; void cmdCHECKSUM() {};
+void cmdMEM() {}; void cmdSET() {}; void cmdGET() {}; void cmdMOVETO() {}; void cmdLOG() {};
+void cmdINFO() {}; void cmdPRINT() {}; void cmdPRINTLN() {}; void cmdTIME() {};
+
+static int failures = 0;
+
+#define CHECK(condition) \
+	if (!(condition)) { \
+		printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+		failures++; \
+	}
+
+// receiving end, collects text commands and frames like SerialCommand
+struct Receiver {
+	CommFrameReceiver frameReceiver;
+	string line;
+	vector<string> lines;
+	vector<vector<uint8_t> > frames;
+	vector<bool> framesOk;
+	uint32_t now;
+
+	Receiver() { now = 1000; };
+
+	void receive(uint8_t b) {
+		CommFrameReceiver::Result result = frameReceiver.receive(b, now);
+		if (result == CommFrameReceiver::FRAME_STARTED)
+			line.clear();
+		if (result == CommFrameReceiver::FRAME_COMPLETE) {
+			const uint8_t* frame = frameReceiver.getFrame();
+			frames.push_back(vector<uint8_t>(frame, frame + frameReceiver.getFrameLen()));
+			framesOk.push_back(CommFrame::check(frame, frameReceiver.getFrameLen()));
+		}
+		if (result != CommFrameReceiver::TEXT)
+			return;
+		if (b == '\r') {
+			lines.push_back(line);
+			line.clear();
+		}
+		else if (isprint(b))
+			line += (char)b;
+	}
+
+	void receive(const vector<uint8_t>& bytes) {
+		for (unsigned i = 0;i<bytes.size();i++)
+			receive(bytes[i]);
+	}
+	void receive(const string& text) {
+		receive(vector<uint8_t>(text.begin(), text.end()));
+	}
+
+	int okFrames() {
+		int count = 0;
+		for (unsigned i = 0;i<framesOk.size();i++)
+			count += framesOk[i]?1:0;
+		return count;
+	}
+};
+
+// MOVETO frame as sent by CortexController, angles in 1/100 degree
+static vector<uint8_t> moveToFrame(const int16_t angle[7], int16_t duration) {
+	uint8_t payload[CommFrame::MoveToPayloadSize];
+	for (int i = 0;i<7;i++)
+		CommFrame::putInt16(&payload[i*2], angle[i]);
+	CommFrame::putInt16(&payload[7*2], duration);
+	uint8_t frame[CommFrame::MaxFrameSize];
+	int len = CommFrame::build(CommDefType::MOVETO_CMD, payload, sizeof(payload), frame);
+	return vector<uint8_t>(frame, frame+len);
+}
+
+static vector<uint8_t> moveToFrame(int no) {
+	int16_t angle[7];
+	for (int i = 0;i<7;i++)
+		angle[i] = (int16_t)(no*100 + i*(i%2?-1:1)*1234);
+	return moveToFrame(angle, (int16_t)(no+20));
+}
+
+static void testRoundTrip() {
+	int16_t angle[7] = { 0, 1, -1, 18000, -18000, 32767, -32767 };
+	vector<uint8_t> frame = moveToFrame(angle, 100);
+	CHECK(frame.size() == (size_t)(CommFrame::HeaderSize + CommFrame::MoveToPayloadSize + CommFrame::CRCSize));
+
+	Receiver r;
+	r.receive(frame);
+	CHECK(r.frames.size() == 1);
+	CHECK(r.okFrames() == 1);
+	if (r.frames.size() == 1) {
+		const uint8_t* f = &r.frames[0][0];
+		CHECK(f[2] == CommDefType::MOVETO_CMD);
+		CHECK(f[1] - 1 == CommFrame::MoveToPayloadSize);
+		const uint8_t* payload = &f[CommFrame::HeaderSize];
+		for (int i = 0;i<7;i++)
+			CHECK(CommFrame::getInt16(&payload[i*2]) == angle[i]);
+		CHECK(CommFrame::getInt16(&payload[7*2]) == 100);
+	}
+
+	// many frames in a row, with text commands in between
+	Receiver many;
+	for (int i = 0;i<100;i++) {
+		many.receive(moveToFrame(i));
+		if (i % 10 == 0)
+			many.receive("GET all chk=12\r");
+	}
+	CHECK(many.okFrames() == 100);
+	CHECK(many.lines.size() == 10);
+	CHECK(many.lines[0] == "GET all chk=12");
+
+	// crc of a known frame, CRC-16/CCITT-FALSE of "123456789" is 0x29B1
+	const uint8_t check[] = "123456789";
+	CHECK(CommFrame::crc16(check, 9) == 0x29B1);
+}
+
+static void testCorruptedCRC() {
+	for (unsigned pos = 2;pos<moveToFrame(0).size();pos++) {
+		vector<uint8_t> frame = moveToFrame(1);
+		frame[pos] ^= 0x10;
+		Receiver r;
+		r.receive(frame);
+		r.receive(moveToFrame(2));
+		// the corrupted frame is delivered, but fails the check. The next one is fine
+		CHECK(r.frames.size() == 2);
+		CHECK(r.framesOk.size() == 2 && !r.framesOk[0] && r.framesOk[1]);
+	}
+}
+
+static void testTruncatedFrame() {
+	// sender stops in the middle of a frame, the next frame comes later
+	vector<uint8_t> frame = moveToFrame(1);
+	Receiver r;
+	r.receive(vector<uint8_t>(frame.begin(), frame.begin() + 7));
+	r.now += CommFrameReceiver::ByteTimeout + 1;
+	r.receive(moveToFrame(2));
+	CHECK(r.frames.size() == 1);
+	CHECK(r.okFrames() == 1);
+	CHECK(r.frames.size() == 1 && r.frames[0] == moveToFrame(2));
+
+	// frame with an implausible length is dropped right away
+	Receiver len;
+	vector<uint8_t> garbage = moveToFrame(3);
+	garbage[1] = CommFrame::MaxPayloadSize + 2;
+	len.receive(vector<uint8_t>(garbage.begin(), garbage.begin() + 2));
+	len.receive(moveToFrame(4));
+	CHECK(len.okFrames() == 1);
+}
+
+static void testResync() {
+	// one lost byte per frame at every position. The damaged frame takes bytes of the
+	// next one, but the frames after that are received
+	for (unsigned lost = 0;lost<moveToFrame(0).size();lost++) {
+		Receiver r;
+		vector<uint8_t> damaged = moveToFrame(1);
+		damaged.erase(damaged.begin() + lost);
+		r.receive(damaged);
+		for (int i = 2;i<10;i++)
+			r.receive(moveToFrame(i));
+		CHECK(r.okFrames() >= 7);
+		CHECK(r.frames.size() > 0 && r.frames.back() == moveToFrame(9));
+
+		// garbage of a lost start byte never turns into a text command
+		for (unsigned l = 0;l<r.lines.size();l++)
+			CHECK(r.lines[l].empty());
+	}
+
+	// printable garbage in front of a frame is dropped, without waiting for a line end
+	Receiver r;
+	r.receive("$,f[=n");
+	r.receive(moveToFrame(1));
+	r.receive("ECHO 43\r");
+	CHECK(r.okFrames() == 1);
+	CHECK(r.lines.size() == 1 && r.lines[0] == "ECHO 43");
+}
+
+static void testCommandNames() {
+	// every command is found by its own name, case does not matter, and names in the table match COMMAND_NAMES
+	for (int i = 0;i<CommDefType::NumberOfCommands;i++) {
+		string name = commDef[i].name;
+		CHECK(CommDefType::find(name.c_str(), name.length()) == &commDef[i]);
+		string lower = name;
+		for (unsigned c = 0;c<lower.size();c++)
+			lower[c] = tolower(lower[c]);
+		CHECK(CommDefType::find(lower.c_str(), lower.length()) == &commDef[i]);
+		string command = name + " 1 2";
+		CHECK(CommDefType::find(command.c_str(), name.length()) == &commDef[i]);
+	}
+	CHECK(CommDefType::find("STEPS", 5) == 0);
+	CHECK(CommDefType::find("TIM", 3) == 0);
+	CHECK(CommDefType::find("", 0) == 0);
+}
+
+int main() {
+	testRoundTrip();
+	testCorruptedCRC();
+	testTruncatedFrame();
+	testResync();
+	testCommandNames();
+	if (failures > 0) {
+		printf("CommFrameTest: %d checks failed\n", failures);
+		return 1;
+	}
+	printf("CommFrameTest: ok\n");
+	return 0;
+}
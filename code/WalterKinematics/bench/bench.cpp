@@ -0,0 +1,288 @@
+/*
+ * bench.cpp
+ *
+ * Microbenchmarks of kinematics, bezier curves, speed profiles and trajectory compilation.
+ * Poses are generated out of a seeded random generator, so all runs work on the same corpus.
+ * Results are written as JSON, in order to compare them between commits.
+ *
+ * usage: walter_bench [-o <file.json>] [-seed <n>] [-poses <n>] [-nodes <n>] [-filter <name>]
+ *
+ * Author: JochenAlt
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <random>
+#include <fstream>
+#include <iostream>
+
+#include "setup.h"
+#include "Util.h"
+#include "Kinematics.h"
+#include "BezierCurve.h"
+#include "SpeedProfile.h"
+#include "Trajectory.h"
+#include "TrajectoryPlayer.h"
+#include "ActuatorProperty.h"
+#include "Hanoi.h"
+#include "logger.h"
+
+INITIALIZE_EASYLOGGINGPP
+
+using namespace std;
+
+const double MinBenchmarkTime_ms = 500.0;	// each benchmark runs at least that long
+
+struct BenchmarkResult {
+	string name;
+	long iterations;		// number of repetitions of the benchmark body
+	long items;				// number of processed items (poses, curves, profiles, samples) per iteration
+	double total_ms;		// overall time
+};
+
+vector<BenchmarkResult> results;
+string filter;
+
+// run body repeatedly until MinBenchmarkTime_ms has passed. body returns the number of processed items
+template<typename F>
+void runBenchmark(const string& name, F body) {
+	if (!filter.empty() && (name.find(filter) == string::npos))
+		return;
+
+	body(); // warm up caches and lazy initializations
+
+	BenchmarkResult result;
+	result.name = name;
+	result.iterations = 0;
+	result.items = 0;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	double elapsed_ms = 0;
+	do {
+		result.items = body();
+		result.iterations++;
+		elapsed_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	} while (elapsed_ms < MinBenchmarkTime_ms);
+	result.total_ms = elapsed_ms;
+	results.push_back(result);
+
+	cout << setw(28) << left << name
+		 << setw(10) << right << result.iterations << " iterations "
+		 << setw(12) << fixed << setprecision(1) << (elapsed_ms*1000000.0/(result.iterations*result.items)) << " ns/item" << endl;
+}
+
+// random joint angles within the actuator limits
+JointAngles randomAngles(mt19937& rnd) {
+	JointAngles angles;
+	for (int i = 0;i<NumberOfActuators;i++) {
+		uniform_real_distribution<rational> dist(actuatorConfigType[i].minAngle, actuatorConfigType[i].maxAngle);
+		angles[i] = dist(rnd);
+	}
+	return angles;
+}
+
+// poses out of random angles, the angles of each pose are slightly moved to serve as IK seed
+vector<Pose> createPoseCorpus(mt19937& rnd, int size) {
+	vector<Pose> corpus;
+	uniform_real_distribution<rational> jitter(-radians(5), radians(5));
+	for (int i = 0;i<size;i++) {
+		Pose pose;
+		pose.angles = randomAngles(rnd);
+		Kinematics::getInstance().computeForwardKinematics(pose);
+		for (int j = 0;j<NumberOfActuators;j++)
+			pose.angles[j] += jitter(rnd);
+		corpus.push_back(pose);
+	}
+	return corpus;
+}
+
+// trajectory of random nodes close to each other, alternating interpolation types
+Trajectory createRandomTrajectory(mt19937& rnd, int size) {
+	Trajectory trajectory;
+	uniform_real_distribution<rational> step(-radians(10), radians(10));
+	JointAngles angles = JointAngles::getDefaultPosition();
+	angles[UPPERARM] = radians(20);
+	angles[FOREARM] = radians(-30);
+	angles[WRIST] = radians(30);
+	for (int i = 0;i<size;i++) {
+		TrajectoryNode node;
+		for (int j = 0;j<GRIPPER;j++)
+			angles[j] = constrain(angles[j] + step(rnd), (rational)actuatorConfigType[j].minAngle*0.8, (rational)actuatorConfigType[j].maxAngle*0.8);
+		node.pose.angles = angles;
+		Kinematics::getInstance().computeForwardKinematics(node.pose);
+		node.interpolationTypeDef = (i % 3 == 0)?POSE_LINEAR:POSE_CUBIC_BEZIER;
+		node.averageSpeedDef = 0.1;
+		node.continouslyDef = true;
+		trajectory.getSupportNodes().push_back(node);
+	}
+	return trajectory;
+}
+
+Trajectory createHanoiTrajectory(int disks) {
+	TrajectoryPlayer player;
+	player.setup(UITrajectorySampleRate);
+	HanoiTrajectory hanoi;
+	hanoi.setPlayer(player);
+	hanoi.solve(disks);
+	return player.getTrajectory();
+}
+
+void writeJSON(ostream& out, unsigned int seed, int poses, int nodes) {
+	out << "{" << endl
+		<< "  \"context\": {" << endl
+		<< "    \"seed\": " << seed << "," << endl
+		<< "    \"poses\": " << poses << "," << endl
+		<< "    \"nodes\": " << nodes << "," << endl
+		<< "    \"sampleRate_ms\": " << UITrajectorySampleRate << endl
+		<< "  }," << endl
+		<< "  \"benchmarks\": [" << endl;
+	for (unsigned int i = 0;i<results.size();i++) {
+		const BenchmarkResult& r = results[i];
+		out << "    {\"name\": \"" << r.name << "\", "
+			<< "\"iterations\": " << r.iterations << ", "
+			<< "\"items\": " << r.items << ", "
+			<< "\"total_ms\": " << fixed << setprecision(3) << r.total_ms << ", "
+			<< "\"ns_per_item\": " << fixed << setprecision(1) << (r.total_ms*1000000.0/(r.iterations*r.items)) << "}"
+			<< ((i+1 < results.size())?",":"") << endl;
+	}
+	out << "  ]" << endl
+		<< "}" << endl;
+}
+
+int main(int argc, char *argv[]) {
+	string outputFile;
+	unsigned int seed = 4711;
+	int numberOfPoses = 1000;
+	int numberOfNodes = 50;
+	for (int i = 1;i<argc;i++) {
+		if ((strcmp(argv[i], "-o") == 0) && (i+1 < argc))
+			outputFile = argv[++i];
+		else if ((strcmp(argv[i], "-seed") == 0) && (i+1 < argc))
+			seed = atoi(argv[++i]);
+		else if ((strcmp(argv[i], "-poses") == 0) && (i+1 < argc))
+			numberOfPoses = atoi(argv[++i]);
+		else if ((strcmp(argv[i], "-nodes") == 0) && (i+1 < argc))
+			numberOfNodes = atoi(argv[++i]);
+		else if ((strcmp(argv[i], "-filter") == 0) && (i+1 < argc))
+			filter = argv[++i];
+		else {
+			cerr << "usage: walter_bench [-o <file.json>] [-seed <n>] [-poses <n>] [-nodes <n>] [-filter <name>]" << endl;
+			return 1;
+		}
+	}
+
+	// no logging, kinematics logs every pose without solution
+	el::Configurations conf;
+	conf.setToDefault();
+	conf.setGlobally(el::ConfigurationType::Enabled, "false");
+	el::Loggers::reconfigureAllLoggers(conf);
+
+	Kinematics::getInstance().setup();
+
+	mt19937 rnd(seed);
+	vector<Pose> corpus = createPoseCorpus(rnd, numberOfPoses);
+	Trajectory randomTrajectory = createRandomTrajectory(rnd, numberOfNodes);
+	Trajectory hanoiTrajectory = createHanoiTrajectory(3);
+
+	// forward kinematics
+	runBenchmark("fk", [&]() {
+		for (unsigned int i = 0;i<corpus.size();i++) {
+			Pose pose;
+			pose.angles = corpus[i].angles;
+			Kinematics::getInstance().computeForwardKinematics(pose);
+		}
+		return (long)corpus.size();
+	});
+
+	// inverse kinematics pose by pose
+	runBenchmark("ik_single", [&]() {
+		for (unsigned int i = 0;i<corpus.size();i++) {
+			Pose pose(corpus[i]);
+			Kinematics::getInstance().computeInverseKinematics(pose);
+		}
+		return (long)corpus.size();
+	});
+
+	// inverse kinematics of the entire corpus in one batch
+	int n = corpus.size();
+	vector<rational> soa(n*(7+2*NumberOfActuators));
+	vector<uint8_t> validSolutions(n);
+	PoseBatch batch;
+	batch.size = n;
+	for (int i = 0;i<n;i++) {
+		for (int c = 0;c<3;c++) {
+			soa[c*n+i] = corpus[i].position[c];
+			soa[(3+c)*n+i] = corpus[i].orientation[c];
+		}
+		soa[6*n+i] = corpus[i].gripperDistance;
+		for (int a = 0;a<NumberOfActuators;a++)
+			soa[(7+a)*n+i] = corpus[i].angles[a];
+	}
+	for (int c = 0;c<3;c++) {
+		batch.position[c] = &soa[c*n];
+		batch.orientation[c] = &soa[(3+c)*n];
+	}
+	batch.gripperDistance = &soa[6*n];
+	for (int a = 0;a<NumberOfActuators;a++) {
+		batch.seed[a] = &soa[(7+a)*n];
+		batch.angles[a] = &soa[(7+NumberOfActuators+a)*n];
+	}
+	batch.validSolutions = &validSolutions[0];
+	runBenchmark("ik_batch", [&]() {
+		Kinematics::getInstance().computeInverseKinematicsBatch(batch);
+		return (long)n;
+	});
+
+	// bezier curves between random trajectory nodes, set computes the support points and the arc length table
+	vector<TrajectoryNode>& nodes = randomTrajectory.getSupportNodes();
+	vector<BezierCurve> curves(nodes.size()-3);
+	runBenchmark("bezier_set", [&]() {
+		for (unsigned int i = 0;i<curves.size();i++)
+			curves[i].set(nodes[i], nodes[i+1], nodes[i+2], nodes[i+3]);
+		return (long)curves.size();
+	});
+
+	// speed profiles with random speeds, distances and durations
+	vector<rational> profileParams;
+	uniform_real_distribution<rational> speed(0.0, 0.2);
+	uniform_real_distribution<rational> distance(1.0, 300.0);
+	for (int i = 0;i<numberOfPoses;i++) {
+		rational d = distance(rnd);
+		profileParams.push_back(speed(rnd));
+		profileParams.push_back(speed(rnd));
+		profileParams.push_back(d);
+		profileParams.push_back(d/0.1);
+	}
+	runBenchmark("speedProfile", [&]() {
+		SpeedProfile profile;
+		for (unsigned int i = 0;i<profileParams.size();i+=4) {
+			rational startSpeed = profileParams[i];
+			rational endSpeed = profileParams[i+1];
+			rational duration = profileParams[i+3];
+			profile.computeSpeedProfile(startSpeed, endSpeed, profileParams[i+2], duration);
+		}
+		return (long)profileParams.size()/4;
+	});
+
+	// compile entire trajectories, items are the compiled samples
+	runBenchmark("compile_random", [&]() {
+		Trajectory t(randomTrajectory);
+		t.compile();
+		return (long)(t.getDuration()/UITrajectorySampleRate + 1);
+	});
+
+	runBenchmark("compile_hanoi", [&]() {
+		Trajectory t(hanoiTrajectory);
+		t.compile();
+		return (long)(t.getDuration()/UITrajectorySampleRate + 1);
+	});
+
+	if (!outputFile.empty()) {
+		ofstream out(outputFile.c_str());
+		writeJSON(out, seed, numberOfPoses, numberOfNodes);
+	} else
+		writeJSON(cout, seed, numberOfPoses, numberOfNodes);
+
+	return 0;
+}
@@ -13,20 +13,25 @@
 
 bool useDynamicBezierSupportPoint = false; // if true, support points are calculated considering the speed at end points.
 
+// 5-point Gauss-Legendre quadrature on [-1,1], used to integrate the speed of the curve
+static const float GaussLegendreNodes[5] = { -0.9061798459386640, -0.5384693101056831, 0.0, 0.5384693101056831, 0.9061798459386640 };
+static const float GaussLegendreWeights[5] = { 0.2369268850561891, 0.4786286704993665, 0.5688888888888889, 0.4786286704993665, 0.2369268850561891 };
+
 BezierCurve::BezierCurve() {
+	for (int i = 0;i<=ArcLengthIntervals;i++)
+		lengthTable[i] = 0.0;
 };
 
 BezierCurve::BezierCurve(const BezierCurve& par) {
-	a = par.a;
-	supportA = par.supportA;
-	b = par.b;
-	supportB = par.supportB;
+	(*this) = par;
 };
 void BezierCurve::operator=(const BezierCurve& par) {
 	a = par.a;
 	supportA = par.supportA;
 	b = par.b;
 	supportB = par.supportB;
+	for (int i = 0;i<=ArcLengthIntervals;i++)
+		lengthTable[i] = par.lengthTable[i];
 };
 
 void BezierCurve::reset() {
@@ -34,6 +39,8 @@ void BezierCurve::reset() {
 	b.null();
 	supportA.null();
 	supportB.null();
+	for (int i = 0;i<=ArcLengthIntervals;i++)
+		lengthTable[i] = 0.0;
 }
 
 TrajectoryNode& BezierCurve::getStart() {
@@ -102,6 +109,7 @@ void BezierCurve::set(TrajectoryNode& pPrev, TrajectoryNode& pA, TrajectoryNode&
 			supportA =  getSupportPoint(pA.interpolationTypeDef, pB,pA,pPrev);
 		}
 	}
+	computeLengthTable();
 }
 
 // compute b's support point
@@ -241,25 +249,68 @@ void BezierCurve::amend(float t, TrajectoryNode& pNewB, TrajectoryNode& pNext) {
 
 	supportB = newSupportPointB;
 	supportA = newSupportA;
+	computeLengthTable();
 }
 
 
 float BezierCurve::curveLength() {
-	float distance = 0.0;
-	TrajectoryNode curr = getCurrent(0);
-
-	// BTW: computing the length of a bezier curve in maths style is really complicated, so do it numerically
-	float t = 0.01; // at least 0.01mm, in order to not divide by 0 later on
-	while (t<1.0) {
-		TrajectoryNode next = getCurrent(t);
-		distance += curr.pose.distance(next.pose);
-		curr = next;
-		t += 0.05;
-	}
+	return lengthTable[ArcLengthIntervals];
+}
+
+// derivative of the position along the curve
+Point BezierCurve::getDerivative(float t) {
+	if (a.interpolationTypeDef == POSE_LINEAR)
+		return b.pose.position - a.pose.position;
 
-	// last node
-	distance += curr.pose.distance(b.pose);
-	return distance;
+	// derivative of the cubic bezier curve
+	return (supportA.position - a.pose.position)*(3*(1-t)*(1-t)) +
+		   (supportB.position - supportA.position)*(6*(1-t)*t) +
+		   (b.pose.position - supportB.position)*(3*t*t);
 }
 
+// compute the length of the curve at equidistant values of t. Pose interpolated curves are
+// polynomials, so the speed along the curve is integrated by Gauss-Legendre quadrature. Joint interpolated
+// curves are no polynomials in space, their length is approximated by the chords between the table points
+void BezierCurve::computeLengthTable() {
+	lengthTable[0] = 0.0;
+	if (a.interpolationTypeDef == JOINT_LINEAR) {
+		Pose prev = a.pose;
+		for (int i = 1;i<=ArcLengthIntervals;i++) {
+			Pose curr = computeBezier(a.interpolationTypeDef, a.pose, supportA, b.pose, supportB, (float)i/ArcLengthIntervals);
+			lengthTable[i] = lengthTable[i-1] + prev.distance(curr);
+			prev = curr;
+		}
+	} else {
+		float halfInterval = 0.5/ArcLengthIntervals;
+		for (int i = 1;i<=ArcLengthIntervals;i++) {
+			float mid = (i-0.5)/ArcLengthIntervals;
+			float length = 0.0;
+			for (int j = 0;j<5;j++)
+				length += GaussLegendreWeights[j]*getDerivative(mid + halfInterval*GaussLegendreNodes[j]).length();
+			lengthTable[i] = lengthTable[i-1] + length*halfInterval;
+		}
+	}
+}
 
+float BezierCurve::getParameterByLengthRatio(float ratio) {
+	float totalLength = lengthTable[ArcLengthIntervals];
+	if (totalLength < floatPrecision)
+		return ratio;
+	float length = constrain(ratio, (float)0.0, (float)1.0) * totalLength;
+
+	// binary search for the interval containing the length, then interpolate linearly within
+	int low = 0;
+	int high = ArcLengthIntervals;
+	while (high - low > 1) {
+		int mid = (low + high)/2;
+		if (lengthTable[mid] < length)
+			low = mid;
+		else
+			high = mid;
+	}
+	float intervalLength = lengthTable[high] - lengthTable[low];
+	float intervalRatio = 0.0;
+	if (intervalLength > floatPrecision)
+		intervalRatio = (length - lengthTable[low])/intervalLength;
+	return constrain((low + intervalRatio)/ArcLengthIntervals, (float)0.0, (float)1.0);
+}
@@ -26,6 +26,10 @@ class BezierCurve  {
 
 		void set(TrajectoryNode& pPrev, TrajectoryNode& pA, TrajectoryNode& pB, TrajectoryNode& pNext);
 		float curveLength();
+
+		// returns the curve parameter t where the passed ratio (0..1) of the curve length is reached.
+		// Used to move with the speed of the speed profile along the curve.
+		float getParameterByLengthRatio(float ratio);
 		Pose getSupportPoint(InterpolationType interpType, const TrajectoryNode& a, const TrajectoryNode& b, const TrajectoryNode& c);
 		TrajectoryNode getCurrent(float t);
 		float distance(float dT1, float dT2);
@@ -35,17 +39,24 @@ class BezierCurve  {
 		void patchB(const TrajectoryNode& pB, const TrajectoryNode& pSupportB) {
 			supportB = pSupportB.pose;
 			b = pB;
+			computeLengthTable();
 		}
 
 	private:
 		float computeBezier(InterpolationType ipType,float a,float supportA,  float b, float supportB, float t);
 		TrajectoryNode computeBezier(InterpolationType ipType, const TrajectoryNode& a, const TrajectoryNode& supportA,  const TrajectoryNode& b, const TrajectoryNode& supportB, float t);
 		Pose computeBezier(InterpolationType ipType, const Pose& a, const Pose& supportA,  const Pose& b, const Pose& supportB, float t);
+		Point getDerivative(float t);
+		void computeLengthTable();
 
 		TrajectoryNode a;
 		Pose supportA;
 		TrajectoryNode b;
 		Pose supportB;
+
+		// arc length table, lengthTable[i] is the length of the curve from t=0 to t=i/ArcLengthIntervals
+		static const int ArcLengthIntervals = 16;
+		float lengthTable[ArcLengthIntervals+1];
 };
 
 #endif /* BEZIERCURVE_H_ */
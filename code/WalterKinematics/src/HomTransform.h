@@ -0,0 +1,98 @@
+/*
+ * HomTransform.h
+ *
+ * Fixed size homogeneous 4x4 transformation and 4-dimensional vector living on the stack.
+ * Used in the kinematics hot path instead of the generic (heap-based) techsoft::matrix.
+ * A transformation consists of a 3x3 rotation in the left upper part and a translation
+ * in the last column, the last row is always (0,0,0,1).
+ *
+ * Author: JochenAlt
+ */
+
+#ifndef HOMTRANSFORM_H_
+#define HOMTRANSFORM_H_
+
+#include "setup.h"
+
+// homogeneous vector (x,y,z,w)
+class Vec4 {
+public:
+	constexpr Vec4() : v{0,0,0,1} {};
+	constexpr Vec4(rational x, rational y, rational z, rational w) : v{x,y,z,w} {};
+
+	rational& operator[](int idx) { return v[idx]; };
+	constexpr rational operator[](int idx) const { return v[idx]; };
+
+	rational v[4];
+};
+
+class HomTransform {
+public:
+	// identity
+	constexpr HomTransform() :
+		m{{1,0,0,0},
+		  {0,1,0,0},
+		  {0,0,1,0},
+		  {0,0,0,1}} {};
+
+	// rotation r and translation t, last row is (0,0,0,1)
+	constexpr HomTransform(
+			rational r00, rational r01, rational r02, rational t0,
+			rational r10, rational r11, rational r12, rational t1,
+			rational r20, rational r21, rational r22, rational t2) :
+		m{{r00,r01,r02,t0},
+		  {r10,r11,r12,t1},
+		  {r20,r21,r22,t2},
+		  {0,  0,  0,  1}} {};
+
+	rational* operator[](int row) { return m[row]; };
+	constexpr const rational* operator[](int row) const { return m[row]; };
+
+	// multiplication of two affine transformations, the last row is not computed since it is always (0,0,0,1)
+	HomTransform operator*(const HomTransform& b) const {
+		HomTransform r;
+		for (int i = 0;i<3;i++) {
+			const rational ai0 = m[i][0];
+			const rational ai1 = m[i][1];
+			const rational ai2 = m[i][2];
+			r.m[i][0] = ai0*b.m[0][0] + ai1*b.m[1][0] + ai2*b.m[2][0];
+			r.m[i][1] = ai0*b.m[0][1] + ai1*b.m[1][1] + ai2*b.m[2][1];
+			r.m[i][2] = ai0*b.m[0][2] + ai1*b.m[1][2] + ai2*b.m[2][2];
+			r.m[i][3] = ai0*b.m[0][3] + ai1*b.m[1][3] + ai2*b.m[2][3] + m[i][3];
+		}
+		return r;
+	}
+
+	void operator*=(const HomTransform& b) {
+		(*this) = (*this)*b;
+	}
+
+	Vec4 operator*(const Vec4& v) const {
+		return Vec4(
+			m[0][0]*v[0] + m[0][1]*v[1] + m[0][2]*v[2] + m[0][3]*v[3],
+			m[1][0]*v[0] + m[1][1]*v[1] + m[1][2]*v[2] + m[1][3]*v[3],
+			m[2][0]*v[0] + m[2][1]*v[1] + m[2][2]*v[2] + m[2][3]*v[3],
+			v[3]);
+	}
+
+	// closed form inverse, valid since the rotation part is orthonormal: inv(R,t) = (R^T, -R^T*t)
+	HomTransform inverse() const {
+		return HomTransform(
+			m[0][0], m[1][0], m[2][0], -(m[0][0]*m[0][3] + m[1][0]*m[1][3] + m[2][0]*m[2][3]),
+			m[0][1], m[1][1], m[2][1], -(m[0][1]*m[0][3] + m[1][1]*m[1][3] + m[2][1]*m[2][3]),
+			m[0][2], m[1][2], m[2][2], -(m[0][2]*m[0][3] + m[1][2]*m[1][3] + m[2][2]*m[2][3]));
+	}
+
+	void inv() {
+		(*this) = inverse();
+	}
+
+	Vec4 column(int col) const {
+		return Vec4(m[0][col], m[1][col], m[2][col], m[3][col]);
+	}
+
+private:
+	rational m[4][4];
+};
+
+#endif /* HOMTRANSFORM_H_ */
@@ -1,5 +1,6 @@
 #include "setup.h"
 #include "Kinematics.h"
+#include "SimdLanes.h"
 #include "Util.h"
 #include "ActuatorProperty.h"
 #include "logger.h"
@@ -55,8 +56,25 @@ Point Kinematics::getTCPCoordinates() {
 	return tmp;
 }
 
+uint32_t Kinematics::getConstantsHash() {
+	stringstream str;
+	for (int i = 0;i<NumberOfActuators-1;i++) {
+		str << floatToString("alpha", DHParams[i].getAlpha());
+		str << floatToString("a", DHParams[i].getA());
+		str << floatToString("d", DHParams[i].getD());
+	}
+	for (int i = 0;i<3;i++)
+		str << floatToString("tcp", hand2View[i][3]);
+	for (int i = 0;i<NumberOfActuators;i++) {
+		str << floatToString("min", actuatorConfigType[i].minAngle);
+		str << floatToString("max", actuatorConfigType[i].maxAngle);
+	}
+	str << floatToString("gripperlever", GripperLeverLength);
+	return hashString(str.str());
+}
+
 // use DenavitHardenberg parameter and compute the Dh-Transformation matrix with a given joint angle (theta)
-void Kinematics::computeDHMatrix(int actuatorNo, rational pTheta, float d, HomMatrix& dh) {
+void Kinematics::computeDHMatrix(int actuatorNo, rational pTheta, float d, HomTransform& dh) {
 
 	rational ct = cos(pTheta);
 	rational st = sin(pTheta);
@@ -65,16 +83,15 @@ void Kinematics::computeDHMatrix(int actuatorNo, rational pTheta, float d, HomMa
 	rational sa = DHParams[actuatorNo].sinalpha();	// precomputed for performance (alpha is constant)
 	rational ca = DHParams[actuatorNo].cosalpha();	// precomputed for performance (alpha is constant)
 
-	dh = HomMatrix(4,4,
-			{ ct, 	-st*ca,  st*sa,  a*ct,
+	dh = HomTransform(
+			  ct, 	-st*ca,  st*sa,  a*ct,
 			  st, 	 ct*ca, -ct*sa,	 a*st,
-			  0,	 sa,		ca,		d,
-			  0,	 0,		     0,		1});
+			  0,	 sa,		ca,		d);
 }
 
 // use DenavitHardenberg parameter and compute the DH-Transformation matrix with a given joint angle (theta)
 // (used for joints besides the hand)
-void Kinematics::computeDHMatrix(int actuatorNo, rational pTheta, HomMatrix& dh) {
+void Kinematics::computeDHMatrix(int actuatorNo, rational pTheta, HomTransform& dh) {
 	if (actuatorNo < HAND)
 		computeDHMatrix(actuatorNo, pTheta, DHParams[actuatorNo].getD(), dh);
 	else
@@ -104,8 +121,8 @@ void Kinematics::computeForwardKinematics(Pose& pose ) {
 			pose.angles[0],pose.angles[1]-radians(90),pose.angles[2],pose.angles[3],pose.angles[4],pose.angles[5],pose.angles[6] };
 
 	// compute final position by multiplying all DH transformation matrixes
-	HomMatrix current;
-	HomMatrix currDHMatrix;
+	HomTransform current;
+	HomTransform currDHMatrix;
 	computeDHMatrix(HIP, angle[HIP], current);
 
 	computeDHMatrix(UPPERARM, angle[UPPERARM], currDHMatrix);
@@ -127,7 +144,7 @@ void Kinematics::computeForwardKinematics(Pose& pose ) {
 	current *= hand2View;
 
 	// position of hand is given by last row of transformation matrix
-	pose.position = current.column(3);
+	pose.position.set(current[X][3], current[Y][3], current[Z][3]);
 
 	// compute orientations out of homogeneous transformation matrix
 	// (as given in https://de.wikipedia.org/wiki/Roll-Nick-Gier-Winkel)
@@ -167,7 +184,7 @@ void Kinematics::computeForwardKinematics(Pose& pose ) {
 
 // compute reverse kinematics, i.e. compute angles out of pose
 // there will be 8 solutions, not all of them might be valid.
-void Kinematics::computeInverseKinematicsCandidates(const Pose& tcp, const JointAngles& current, std::vector<KinematicsSolutionType> &solutions) {
+void Kinematics::computeInverseKinematicsCandidates(const Pose& tcp, const JointAngles& current, KinematicsSolutionType solutions[]) {
 	LOG_IF(LOG_KIN_DETAILS,DEBUG)  << setprecision(4)
 			<< "{TCP=(" << tcp.position[0] << "," << tcp.position[1] << "," << tcp.position[2] << ");("
 			<< tcp.orientation[0] << "," << tcp.orientation[1] << "," << tcp.orientation[2] << "|" << tcp.gripperDistance << ")})";
@@ -190,18 +207,17 @@ void Kinematics::computeInverseKinematicsCandidates(const Pose& tcp, const Joint
 	// left upper 3x3 part is rotation matrix out of three euler angles in zy'x'' model
 	// (http://www-home.htwg-konstanz.de/~bittel/ain_robo/Vorlesung/02_PositionUndOrientierung.pdf)
 	// (actually only columns 3 and 4 are required, but compute everything for debugging)
-	HomMatrix T06 = HomMatrix(4,4,
-		{ 	cosz*cosy,	cosz*siny*sinx-sinz*cosx,	cosz*siny*cosx+sinz*sinx,	tcp.position[0],
+	HomTransform T06 = HomTransform(
+			cosz*cosy,	cosz*siny*sinx-sinz*cosx,	cosz*siny*cosx+sinz*sinx,	tcp.position[0],
 			sinz*cosy,	sinz*siny*sinx+cosz*cosx,	sinz*siny*cosx-cosz*sinx,	tcp.position[1],
-			-siny,		cosy*sinx,					cosy*cosx,					tcp.position[2],
-			0,			0,							0,							1 });
+			-siny,		cosy*sinx,					cosy*cosx,					tcp.position[2]);
 
 	// transform transformation matrix to reflect the gripper matrix instead of the view matrix
 	T06 *= view2Hand;
 
 	// compute wcp from tcp's perspective, then via T06 from world coord
-	HomVector wcp_from_tcp_perspective = { 0,0,-getHandLength(getGripperAngle(tcp.gripperDistance)),1 };
-	HomVector wcp = T06 * wcp_from_tcp_perspective;
+	Vec4 wcp_from_tcp_perspective(0,0,-getHandLength(getGripperAngle(tcp.gripperDistance)),1);
+	Vec4 wcp = T06 * wcp_from_tcp_perspective;
 
 	// compute base angle by wrist position
 	// we have two possible solutions, looking forward and looking backward
@@ -270,8 +286,7 @@ void Kinematics::computeInverseKinematicsCandidates(const Pose& tcp, const Joint
 			<< "angle2_2= " << angle2_sol2;
 
 	// initialize all possible 8 solutions
-	solutions.resize(8);
-	for (int i = 0;i<8;i++) {
+	for (int i = 0;i<NumberOfIKCandidates;i++) {
 		solutions[i].angles.null();
 		solutions[i].angles[GRIPPER] = getGripperAngle(tcp.gripperDistance);
 	}
@@ -300,7 +315,7 @@ void Kinematics::computeInverseKinematicsCandidates(const Pose& tcp, const Joint
 // Compute last three angles (elbow, wrist hand) out of TCP and first three angles. There are two solutions.
 void Kinematics::computeIKUpperAngles(
 		const Pose& tcp, const JointAngles& current, PoseConfigurationType::PoseDirectionType poseDirection, PoseConfigurationType::PoseFlipType poseFlip,
-		rational angle0, rational angle1, rational angle2, const HomMatrix &T06,
+		rational angle0, rational angle1, rational angle2, const HomTransform &T06,
 		KinematicsSolutionType &sol_up, KinematicsSolutionType &sol_down) {
 
 	LOG_IF(LOG_KIN_DETAILS,DEBUG)  << setprecision(4)
@@ -331,25 +346,15 @@ void Kinematics::computeIKUpperAngles(
 	// - take R0-6 aus of T0-6(which we already have)
 	// - derive R3-6 by inverse(R0-3)*R0-6
 	// - compute angle3,4,5 by solving R3-6
-	HomMatrix T01, T12, T23;
+	HomTransform T01, T12, T23;
 	computeDHMatrix(0, angle0, T01);
 	computeDHMatrix(1, angle1-radians(90), T12); // forearm null position has an offset of 90
 	computeDHMatrix(2, angle2, T23);
 
-	Matrix R01 = T01[mslice(0,0,3,3)];
-	Matrix R12 = T12[mslice(0,0,3,3)];
-	Matrix R23 = T23[mslice(0,0,3,3)];
-	Matrix R02 = R01*R12;
-	Matrix R03 = R02*R23;
+	HomTransform T03 = T01*T12*T23;
 
-	// compute inverse of R03 by transposing manually
-	Matrix R03_inv(R03);
-	mswap(R03_inv[0][1], R03_inv[1][0]);
-	mswap(R03_inv[0][2], R03_inv[2][0]);
-	mswap(R03_inv[1][2], R03_inv[2][1]);
-
-	Matrix R06 = T06[mslice(0,0,3,3)];
-	Matrix R36 = R03_inv*R06;
+	// the rotation part of inverse(T03)*T06 is transposed(R03)*R06, translation is not used
+	HomTransform R36 = T03.inverse()*T06;
 
 	rational R36_22 = R36[2][2];
 	rational R36_01 = R36[0][1];
@@ -524,58 +529,150 @@ bool Kinematics::isIKInBoundaries( const KinematicsSolutionType &sol, int& actua
 	return ok;
 }
 
+// Check all 8 candidates in lockstep lanes: forward kinematics and comparison with the pose, boundaries of all
+// actuators, and squared distance to the current angles. Equivalent to calling isSolutionValid and isIKInBoundaries
+// per candidate, but the matrix chain and all comparisons are computed with SIMD instructions (see SimdLanes.h).
+// Only sin/cos and the orientation extraction are computed lane by lane.
+void Kinematics::checkIKCandidates(const JointAngles& current, const Pose& pose, const KinematicsSolutionType solutions[],
+								   uint8_t& validSolutions, rational distance[]) {
+	// transformation matrix per lane, last row is always (0,0,0,1) and not stored
+	Lanes m[3][4];
+	for (int r = 0;r<3;r++)
+		for (int c = 0;c<4;c++)
+			lanesSet(m[r][c], (r == c)?1.0:0.0);
+
+	// multiply all DH transformation matrixes
+	for (int j = HIP;j<=HAND;j++) {
+		Lanes ct, st, d;
+		for (int l = 0;l<NumberOfLanes;l++) {
+			rational theta = solutions[l].angles[j];
+			if (j == UPPERARM)
+				theta -= radians(90); // convert to intern offset as in computeForwardKinematics
+			ct.v[l] = cos(theta);
+			st.v[l] = sin(theta);
+			d.v[l] = (j == HAND)?getHandLength(solutions[l].angles[GRIPPER]):DHParams[j].getD();
+		}
+
+		// DH matrix as in computeDHMatrix, rows 0..2
+		rational a = DHParams[j].getA();
+		rational sa = DHParams[j].sinalpha();
+		rational ca = DHParams[j].cosalpha();
+		Lanes dh[3][4];
+		dh[0][0] = ct;  lanesMul(st,-ca,dh[0][1]); lanesMul(st,sa,dh[0][2]);  lanesMul(ct,a,dh[0][3]);
+		dh[1][0] = st;  lanesMul(ct,ca,dh[1][1]);  lanesMul(ct,-sa,dh[1][2]); lanesMul(st,a,dh[1][3]);
+		lanesSet(dh[2][0],0); lanesSet(dh[2][1],sa); lanesSet(dh[2][2],ca); dh[2][3] = d;
+
+		// m = m * dh, affine multiplication in the same order as HomTransform
+		Lanes r[3][4];
+		for (int i = 0;i<3;i++) {
+			for (int k = 0;k<4;k++) {
+				lanesMul(m[i][0], dh[0][k], r[i][k]);
+				lanesMulAdd(m[i][1], dh[1][k], r[i][k], r[i][k]);
+				lanesMulAdd(m[i][2], dh[2][k], r[i][k], r[i][k]);
+			}
+			lanesAdd(r[i][3], m[i][3], r[i][3]);
+		}
+		for (int i = 0;i<3;i++)
+			for (int k = 0;k<4;k++)
+				m[i][k] = r[i][k];
+	}
+
+	// m = m * hand2View
+	Lanes r[3][4];
+	for (int i = 0;i<3;i++) {
+		for (int k = 0;k<4;k++) {
+			Lanes p;
+			lanesMul(m[i][0], hand2View[0][k], r[i][k]);
+			lanesMul(m[i][1], hand2View[1][k], p);
+			lanesAdd(r[i][k], p, r[i][k]);
+			lanesMul(m[i][2], hand2View[2][k], p);
+			lanesAdd(r[i][k], p, r[i][k]);
+		}
+		lanesAdd(r[i][3], m[i][3], r[i][3]);
+	}
+
+	// squared distance of computed position to the pose (1mm deviation is allowed)
+	Lanes poseDistance, diff, target;
+	lanesSet(poseDistance, 0);
+	for (int c = X;c<=Z;c++) {
+		lanesSet(target, pose.position[c]);
+		lanesSub(r[c][3], target, diff);
+		lanesMulAdd(diff, diff, poseDistance, poseDistance);
+	}
+	int positionMask = lanesLess(poseDistance, sqr(1.0f));
+
+	// nick angle is extracted out of the matrix like in computeForwardKinematics (0.1 deviation is allowed)
+	int nickMask = 0;
+	rational maxAngle= sqr(radians(0.1f));
+	for (int l = 0;l<NumberOfLanes;l++) {
+		rational beta = atan2(-r[2][0].v[l], sqrt(r[0][0].v[l]*r[0][0].v[l] + r[1][0].v[l]*r[1][0].v[l]));
+		rational gamma = 0;
+		if (almostEqual(beta, HALF_PI, floatPrecision))
+			gamma = atan2(r[0][1].v[l], r[1][1].v[l]);
+		else if (almostEqual(beta, -HALF_PI,floatPrecision))
+			gamma = -atan2(r[0][1].v[l], r[1][1].v[l]);
+		else
+			gamma = atan2(r[2][1].v[l], r[2][2].v[l]);
+
+		// when checking the orientation, turning by 180 gives the same orientation
+		rational nickDistance = fabs(gamma - pose.orientation[0]);
+		while (nickDistance >= PI-floatPrecision)
+			nickDistance -= PI;
+		while (nickDistance <= -PI+floatPrecision)
+			nickDistance += PI;
+		if (sqr(nickDistance) < maxAngle)
+			nickMask |= (1 << l);
+	}
+
+	// check boundaries of all actuators, and compute distance to current angles (without gripper)
+	int outOfBoundsMask = 0;
+	Lanes dist, angle, curr;
+	lanesSet(dist, 0);
+	for (int j = 0;j<NumberOfActuators;j++) {
+		for (int l = 0;l<NumberOfLanes;l++)
+			angle.v[l] = solutions[l].angles[j];
+		outOfBoundsMask |= lanesLess(angle, actuatorConfigType[j].minAngle-floatPrecision);
+		outOfBoundsMask |= lanesGreater(angle, actuatorConfigType[j].maxAngle+floatPrecision);
+		if (j < NumberOfActuators-1) {
+			lanesSet(curr, current[j]);
+			lanesSub(angle, curr, diff);
+			lanesMulAdd(diff, diff, dist, dist);
+		}
+	}
+
+	validSolutions = positionMask & nickMask & ~outOfBoundsMask;
+	for (int l = 0;l<NumberOfLanes;l++)
+		distance[l] = dist.v[l];
+}
+
 // select the solution that is best, i.e. which difference to current angles is minimal
+// validSolutions returns a bitmask with bit i set if solution i is valid
 bool Kinematics::chooseIKSolution(const JointAngles& currentAngles, const Pose& currentPose,
-					              std::vector<KinematicsSolutionType> &solutions,
-								  int &choosenSolution, std::vector<KinematicsSolutionType>& validSolutions) {
+					              const KinematicsSolutionType solutions[],
+								  int &choosenSolution, uint8_t& validSolutions) {
+	rational distance[NumberOfIKCandidates];
+	checkIKCandidates(currentAngles, currentPose, solutions, validSolutions, distance);
+
+	// take the valid solution with minimal distance to current pose
 	rational minimalDistance = 0;
 	choosenSolution = -1;
-	validSolutions.clear();
-
-	// check all solutions, take the valid ones, and find the one with minimal distance to current pose
-	for (unsigned i = 0;i<solutions.size();i++ ) {
+	for (int i = 0;i<NumberOfIKCandidates;i++ ) {
 		const KinematicsSolutionType& sol = solutions[i];
-		// check only valid solutions
-		rational precision;
-		if (isSolutionValid(currentPose,sol, precision)) {
-			// check if in valid boundaries
-			int actuatorOutOfBound;
-			if (isIKInBoundaries(sol, actuatorOutOfBound)) {
-				validSolutions.insert(validSolutions.end(),sol);
-				// check how close solution is to current position
-				rational distance = 0.0f;
-				for (unsigned j = 0;j< NumberOfActuators-1;j++) // do not count the gripper
-					distance +=	sqr(sol.angles[j] - currentAngles[j]);
-
-				if ((distance < minimalDistance) || (choosenSolution == -1)) {
-					choosenSolution = i;
-					minimalDistance = distance;
-				}
-				LOG_IF(LOG_KIN_DETAILS,DEBUG) << setprecision(4)<< endl
-							<< "solution[" << i << "] ok!(" << distance << ") [" << sol.config.poseDirection << "," << sol.config.poseFlip << "," << sol.config.poseTurn<< "]=("
-								<< sol.angles[0] << "," << sol.angles[1] << ","<< sol.angles[2] << ","<< sol.angles[3] << ","<< sol.angles[4] << ","<< sol.angles[5] << ")=("
-								<< degrees(sol.angles[0]) << "," << degrees(sol.angles[1]) << ","<< degrees(sol.angles[2]) << ","<< degrees(sol.angles[3]) << ","<< degrees(sol.angles[4]) << ","<< degrees(sol.angles[5]) << ")"
-								<< "curr=(" << degrees(currentAngles[0]) << "," << degrees(currentAngles[1]) << ","<< degrees(currentAngles[2]) << ","<< degrees(currentAngles[3]) << ","<< degrees(currentAngles[4]) << ","<< degrees(currentAngles[5]) << ")" << endl;
-			}
-			else {
-				KinematicsSolutionType sol = solutions[i];
-				LOG_IF(LOG_KIN_DETAILS,DEBUG) << setprecision(4)<< endl
-							<< "solution[" << i << "] out of bounds!(" << actuatorOutOfBound << ") [" << sol.config.poseDirection << "," << sol.config.poseFlip << "," << sol.config.poseTurn<< "]=("
-								<< sol.angles[0] << "," << sol.angles[1] << ","<< sol.angles[2] << ","<< sol.angles[3] << ","<< sol.angles[4] << ","<< sol.angles[5] << ")=("
-								<< degrees(sol.angles[0]) << "," << degrees(sol.angles[1]) << ","<< degrees(sol.angles[2]) << ","<< degrees(sol.angles[3]) << ","<< degrees(sol.angles[4]) << ","<< degrees(sol.angles[5]) << ")" << endl;
-
+		if (validSolutions & (1 << i)) {
+			if ((distance[i] < minimalDistance) || (choosenSolution == -1)) {
+				choosenSolution = i;
+				minimalDistance = distance[i];
 			}
-		} else {
-			KinematicsSolutionType sol = solutions[i];
-			LOG_IF(LOG_KIN_DETAILS,DEBUG) << setprecision(4)<< endl
-						<< "solution[" << i << "] invalid(" << precision << ")! [" << sol.config.poseDirection << "," << sol.config.poseFlip << "," << sol.config.poseTurn<< "]=("
-							<< sol.angles[0] << "," << sol.angles[1] << ","<< sol.angles[2] << ","<< sol.angles[3] << ","<< sol.angles[4] << ","<< sol.angles[5] << ")=("
-							<< degrees(sol.angles[0]) << "," << degrees(sol.angles[1]) << ","<< degrees(sol.angles[2]) << ","<< degrees(sol.angles[3]) << ","<< degrees(sol.angles[4]) << ","<< degrees(sol.angles[5]) << ")" << endl;
 		}
+		LOG_IF(LOG_KIN_DETAILS,DEBUG) << setprecision(4)<< endl
+					<< "solution[" << i << "] " << ((validSolutions & (1 << i))?"ok":"invalid") << "(" << distance[i] << ") [" << sol.config.poseDirection << "," << sol.config.poseFlip << "," << sol.config.poseTurn<< "]=("
+						<< sol.angles[0] << "," << sol.angles[1] << ","<< sol.angles[2] << ","<< sol.angles[3] << ","<< sol.angles[4] << ","<< sol.angles[5] << ")=("
+						<< degrees(sol.angles[0]) << "," << degrees(sol.angles[1]) << ","<< degrees(sol.angles[2]) << ","<< degrees(sol.angles[3]) << ","<< degrees(sol.angles[4]) << ","<< degrees(sol.angles[5]) << ")"
+						<< "curr=(" << degrees(currentAngles[0]) << "," << degrees(currentAngles[1]) << ","<< degrees(currentAngles[2]) << ","<< degrees(currentAngles[3]) << ","<< degrees(currentAngles[4]) << ","<< degrees(currentAngles[5]) << ")" << endl;
 	}
 
 	if ((choosenSolution >= 0)) {
-		KinematicsSolutionType sol = solutions[choosenSolution];
+		const KinematicsSolutionType& sol = solutions[choosenSolution];
 		LOG_IF(LOG_KIN_DETAILS,DEBUG) << setprecision(4)<< endl
 					<< "best solution [" <<  choosenSolution << "]" << sol.config.poseDirection<< "," << sol.config.poseFlip  << "," << sol.config.poseTurn<< "]=("
 						<< sol.angles[0] << "," << sol.angles[1] << ","<< sol.angles[2] << ","<< sol.angles[3] << ","<< sol.angles[4] << ","<< sol.angles[5] << ")=("
@@ -595,11 +692,18 @@ bool Kinematics::computeInverseKinematics(Pose& pose) {
 }
 
 bool Kinematics::computeInverseKinematics(const Pose& pose, KinematicsSolutionType &solution, std::vector<KinematicsSolutionType> &validSolution ) {
-	std::vector<KinematicsSolutionType> solutions;
+	KinematicsSolutionType solutions[NumberOfIKCandidates];
 
 	computeInverseKinematicsCandidates(pose, pose.angles, solutions);
 	int selectedIdx = -1;
-	bool ok = chooseIKSolution(pose.angles, pose, solutions, selectedIdx, validSolution);
+	uint8_t validMask = 0;
+	bool ok = chooseIKSolution(pose.angles, pose, solutions, selectedIdx, validMask);
+
+	validSolution.clear();
+	for (int i = 0;i<NumberOfIKCandidates;i++)
+		if (validMask & (1 << i))
+			validSolution.push_back(solutions[i]);
+
 	if (ok) {
 		solution = solutions[selectedIdx];
 		KinematicsSolutionType sol = solution;
@@ -615,6 +719,41 @@ bool Kinematics::computeInverseKinematics(const Pose& pose, KinematicsSolutionTy
 	return ok;
 }
 
+// compute inverse kinematics of a structure-of-arrays buffer of poses. Candidates are kept on the stack,
+// so there is no heap allocation per pose. A pose without solution gets its seed angles assigned.
+int Kinematics::computeInverseKinematicsBatch(PoseBatch& batch) {
+	KinematicsSolutionType solutions[NumberOfIKCandidates];
+	Pose pose;
+	JointAngles current;
+	int solved = 0;
+
+	for (int p = 0;p<batch.size;p++) {
+		pose.position.set(batch.position[X][p], batch.position[Y][p], batch.position[Z][p]);
+		pose.orientation.set(batch.orientation[X][p], batch.orientation[Y][p], batch.orientation[Z][p]);
+		pose.gripperDistance = batch.gripperDistance[p];
+		for (int a = 0;a<NumberOfActuators;a++)
+			current[a] = batch.seed[a][p];
+		pose.angles = current;
+
+		computeInverseKinematicsCandidates(pose, current, solutions);
+		int selectedIdx = -1;
+		uint8_t validMask = 0;
+		bool ok = chooseIKSolution(current, pose, solutions, selectedIdx, validMask);
+		if (ok) {
+			solved++;
+			for (int a = 0;a<NumberOfActuators;a++)
+				batch.angles[a][p] = solutions[selectedIdx].angles[a];
+		} else {
+			for (int a = 0;a<NumberOfActuators;a++)
+				batch.angles[a][p] = current[a];
+			LOG(ERROR) << "no solution found for pose " << p;
+		}
+		if (batch.validSolutions != NULL)
+			batch.validSolutions[p] = validMask;
+	}
+	return solved;
+}
+
 PoseConfigurationType Kinematics::computeConfiguration(const JointAngles angles) {
 	PoseConfigurationType config;
 	config.poseDirection = (abs(degrees(angles[HIP]))<= 90)   ?PoseConfigurationType::FRONT:PoseConfigurationType::BACK;
@@ -623,7 +762,7 @@ PoseConfigurationType Kinematics::computeConfiguration(const JointAngles angles)
 	return config;
 }
 
-void Kinematics::computeRotationMatrix(rational x, rational y, rational z, HomMatrix& m) {
+void Kinematics::computeRotationMatrix(rational x, rational y, rational z, HomTransform& m) {
 	rational sinX = sin(x);
 	rational cosX = cos(x);
 	rational sinY = sin(y);
@@ -631,10 +770,9 @@ void Kinematics::computeRotationMatrix(rational x, rational y, rational z, HomMa
 	rational sinZ = sin(z);
 	rational cosZ = cos(z);
 
-	m = HomMatrix(4,4,
-			{ 	cosZ*cosY, 	-sinZ*cosX+cosZ*sinY*sinX,  	sinZ*sinX+cosZ*sinY*cosX, 	0,
+	m = HomTransform(
+				cosZ*cosY, 	-sinZ*cosX+cosZ*sinY*sinX,  	sinZ*sinX+cosZ*sinY*cosX, 	0,
 				sinZ*cosY, 	 cosZ*cosX + sinZ*sinY*sinX, 	cosZ*sinX+sinZ*sinY*cosX, 	0,
-				-sinY,	 	cosY*sinX,						cosY*cosX,					0,
-				0,			0,								0,							1});
+				-sinY,	 	cosY*sinX,						cosY*cosX,					0);
 }
 
@@ -14,10 +14,12 @@
 
 #include <cstdio>
 #include <cstdlib>
+#include <stdint.h>
 #include <iostream>
 #include <fstream>
 #include <iomanip>
 #include "spatial.h"
+#include "HomTransform.h"
 #include "DenavitHardenbergParam.h"
 
 // a configuration is one valid solution of the inverse kinematics problem. There are 8 solutions
@@ -55,6 +57,33 @@ public:
 	JointAngles angles;
 };
 
+// structure-of-arrays buffer of poses used for batch inverse kinematics. All arrays are owned
+// by the caller and have at least size elements. position, orientation, gripperDistance and seed
+// are input, angles and validSolutions are output. validSolutions might be NULL if not required.
+struct PoseBatch {
+	PoseBatch() {
+		size = 0;
+		for (int i = 0;i<3;i++) {
+			position[i] = NULL;
+			orientation[i] = NULL;
+		}
+		gripperDistance = NULL;
+		for (int i = 0;i<NumberOfActuators;i++) {
+			seed[i] = NULL;
+			angles[i] = NULL;
+		}
+		validSolutions = NULL;
+	}
+
+	int size;									// number of poses
+	const rational* position[3];				// x,y,z of tcp
+	const rational* orientation[3];				// nick, roll, yaw of tcp
+	const rational* gripperDistance;			// distance of gripper levers
+	const rational* seed[NumberOfActuators];	// current angles per pose, the closest solution is chosen
+	rational* angles[NumberOfActuators];		// chosen solution per pose (seed if no solution has been found)
+	uint8_t* validSolutions;					// bit i is set if candidate i is a valid solution, 0 if no solution
+};
+
 // Computation class, doing forward and inverse kinematics
 class Kinematics {
 public:
@@ -82,6 +111,12 @@ public:
 	// the currently set angles represent the current position (necessary for choosing the best solution)
 	bool computeInverseKinematics(Pose& pose);
 
+	// inverse kinematics of a batch of poses without heap allocation. Returns the number of poses a solution has been found for
+	int computeInverseKinematicsBatch(PoseBatch& batch);
+
+	// number of candidates computed per inverse kinematics
+	static const int NumberOfIKCandidates = 8;
+
 	// computes the configuration type of a given solution
 	static PoseConfigurationType computeConfiguration(const JointAngles angles);
 
@@ -112,23 +147,27 @@ public:
 	// get what has been set by setTCPCoordinates
 	Point getTCPCoordinates();
 
+	// hash of all constants the kinematics depends on. Kinematics computed somewhere else can be
+	// taken over only if the hashes are equal
+	uint32_t getConstantsHash();
+
 private:
-	void computeIKUpperAngles(const Pose& tcp, const JointAngles& current, PoseConfigurationType::PoseDirectionType poseDirection, PoseConfigurationType::PoseFlipType poseFlip, rational angle0, rational angle1, rational angle2, const HomMatrix &T06,
+	void computeIKUpperAngles(const Pose& tcp, const JointAngles& current, PoseConfigurationType::PoseDirectionType poseDirection, PoseConfigurationType::PoseFlipType poseFlip, rational angle0, rational angle1, rational angle2, const HomTransform &T06,
 			KinematicsSolutionType &angles_up, KinematicsSolutionType &angles_down);
 	bool isSolutionValid(const Pose& pose, const KinematicsSolutionType& sol, rational &precision);
 	bool isIKInBoundaries(const KinematicsSolutionType &sol, int & actuatorOutOfBound);
-	bool chooseIKSolution(const JointAngles& current, const Pose& pose, std::vector<KinematicsSolutionType> &solutions, int &choosenSolution,std::vector<KinematicsSolutionType>& validSolutions);
-	void computeInverseKinematicsCandidates(const Pose& pose, const JointAngles& current, std::vector<KinematicsSolutionType> &solutions);
+	void checkIKCandidates(const JointAngles& current, const Pose& pose, const KinematicsSolutionType solutions[], uint8_t& validSolutions, rational distance[]);
+	bool chooseIKSolution(const JointAngles& current, const Pose& pose, const KinematicsSolutionType solutions[], int &choosenSolution, uint8_t& validSolutions);
+	void computeInverseKinematicsCandidates(const Pose& pose, const JointAngles& current, KinematicsSolutionType solutions[]);
 
-	void computeDHMatrix(int actuatorNo, rational pTheta, float d, HomMatrix& dh);
-	void computeDHMatrix(int actuatorNo, rational pTheta, HomMatrix& dh);
+	void computeDHMatrix(int actuatorNo, rational pTheta, float d, HomTransform& dh);
+	void computeDHMatrix(int actuatorNo, rational pTheta, HomTransform& dh);
 
-	void computeRotationMatrix(rational x, rational y, rational z, HomMatrix& m);
-	void computeInverseRotationMatrix(rational x, rational y, rational z, HomMatrix& m);
+	void computeRotationMatrix(rational x, rational y, rational z, HomTransform& m);
 
 	DenavitHardenbergParams DHParams[NumberOfActuators]; 	// DH params of actuators
-	HomMatrix hand2View; 									// rotation matrix for rotating the original gripper coord to a handy one that has a zero position of (0,0,0)
-	HomMatrix view2Hand; 									// inverse rotation matrix
+	HomTransform hand2View; 									// rotation matrix for rotating the original gripper coord to a handy one that has a zero position of (0,0,0)
+	HomTransform view2Hand; 									// inverse rotation matrix
 };
 
 
@@ -0,0 +1,120 @@
+/*
+ * SampleClock.h
+ *
+ * Time base of the TrajectoryPlayer. Samples are due at absolute deadlines,
+ * so sleeping and computing do not add up to a drift. MonotonicClock is used
+ * in production, VirtualClock lets a test or simulation step through time.
+ * LatenessHistogram counts how late samples have been computed.
+ *
+ * Author: JochenAlt
+ */
+
+#ifndef SAMPLECLOCK_H_
+#define SAMPLECLOCK_H_
+
+#include <stdint.h>
+#include <string>
+#include <sstream>
+#include <chrono>
+#include <thread>
+#ifndef _WIN32
+#include <time.h>
+#include <errno.h>
+#endif
+
+typedef int64_t microseconds;
+
+class SampleClock {
+public:
+	virtual ~SampleClock() {};
+
+	// current time of this clock
+	virtual microseconds now() = 0;
+
+	// block until the clock passed the absolute deadline
+	virtual void sleepUntil(microseconds deadline) = 0;
+};
+
+// CLOCK_MONOTONIC, which is the same time base as std::chrono::steady_clock,
+// so deadlines can be passed to condition_variable::wait_until as well
+class MonotonicClock : public SampleClock {
+public:
+	static MonotonicClock& getInstance() {
+		static MonotonicClock instance;
+		return instance;
+	}
+
+	microseconds now() {
+		return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	void sleepUntil(microseconds deadline) {
+#ifdef _WIN32
+		std::this_thread::sleep_until(toTimePoint(deadline));
+#else
+		// absolute deadline, wakeup latency does not accumulate over samples
+		struct timespec ts;
+		ts.tv_sec = deadline / 1000000;
+		ts.tv_nsec = (deadline % 1000000) * 1000;
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+#endif
+	}
+
+	static std::chrono::steady_clock::time_point toTimePoint(microseconds t) {
+		return std::chrono::steady_clock::time_point(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::microseconds(t)));
+	}
+};
+
+// time moves only when someone sleeps or advances it, used for tests and simulations
+class VirtualClock : public SampleClock {
+public:
+	VirtualClock() : currentTime(0) {};
+
+	microseconds now() { return currentTime; }
+	void sleepUntil(microseconds deadline) {
+		if (deadline > currentTime)
+			currentTime = deadline;
+	}
+	void advance(microseconds duration) { currentTime += duration; }
+private:
+	microseconds currentTime;
+};
+
+// number of samples per lateness range. Plain data, so it can be copied between threads
+struct LatenessHistogram {
+	static const int NumberOfBuckets = 9;
+
+	// upper limit of each bucket, the last bucket takes everything above
+	static microseconds bucketLimit(int bucket) {
+		static const microseconds limits[NumberOfBuckets-1] = { 50, 100, 250, 500, 1000, 2500, 5000, 10000 };
+		return limits[bucket];
+	}
+
+	long samples[NumberOfBuckets];
+	microseconds max_us;
+
+	void reset() {
+		for (int i = 0;i<NumberOfBuckets;i++)
+			samples[i] = 0;
+		max_us = 0;
+	}
+
+	void add(microseconds lateness_us) {
+		int bucket = 0;
+		while ((bucket < NumberOfBuckets-1) && (lateness_us >= bucketLimit(bucket)))
+			bucket++;
+		samples[bucket]++;
+		if (lateness_us > max_us)
+			max_us = lateness_us;
+	}
+
+	std::string toString() {
+		std::ostringstream s;
+		for (int i = 0;i<NumberOfBuckets-1;i++)
+			s << "<" << bucketLimit(i) << "us:" << samples[i] << " ";
+		s << ">=" << bucketLimit(NumberOfBuckets-2) << "us:" << samples[NumberOfBuckets-1] << " max=" << max_us << "us";
+		return s.str();
+	}
+};
+
+#endif /* SAMPLECLOCK_H_ */
@@ -0,0 +1,139 @@
+/*
+ * SimdLanes.h
+ *
+ * Lane-wise arithmetic on 8 rationals, used to evaluate the 8 inverse kinematics candidates
+ * in lockstep. Uses AVX2 or SSE2 if the compiler targets it (SSE2 is default on x86_64,
+ * AVX2 requires -mavx2), otherwise plain loops. No fused multiply-add is used, so
+ * results are identical to the scalar computation.
+ *
+ * Author: JochenAlt
+ */
+
+#ifndef SIMDLANES_H_
+#define SIMDLANES_H_
+
+#include <type_traits>
+#include "setup.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+const int NumberOfLanes = 8;
+
+// the intrinsics below work on doubles
+static_assert(std::is_same<rational, double>::value, "SimdLanes requires rational to be double");
+
+struct alignas(32) Lanes {
+	rational v[NumberOfLanes];
+};
+
+// r = x in all lanes
+inline void lanesSet(Lanes& r, rational x) {
+	for (int i = 0;i<NumberOfLanes;i++)
+		r.v[i] = x;
+}
+
+// r = a*b
+inline void lanesMul(const Lanes& a, const Lanes& b, Lanes& r) {
+#if defined(__AVX2__)
+	for (int i = 0;i<NumberOfLanes;i+=4)
+		_mm256_store_pd(&r.v[i], _mm256_mul_pd(_mm256_load_pd(&a.v[i]), _mm256_load_pd(&b.v[i])));
+#elif defined(__SSE2__)
+	for (int i = 0;i<NumberOfLanes;i+=2)
+		_mm_store_pd(&r.v[i], _mm_mul_pd(_mm_load_pd(&a.v[i]), _mm_load_pd(&b.v[i])));
+#else
+	for (int i = 0;i<NumberOfLanes;i++)
+		r.v[i] = a.v[i]*b.v[i];
+#endif
+}
+
+// r = a*s
+inline void lanesMul(const Lanes& a, rational s, Lanes& r) {
+#if defined(__AVX2__)
+	__m256d sv = _mm256_set1_pd(s);
+	for (int i = 0;i<NumberOfLanes;i+=4)
+		_mm256_store_pd(&r.v[i], _mm256_mul_pd(_mm256_load_pd(&a.v[i]), sv));
+#elif defined(__SSE2__)
+	__m128d sv = _mm_set1_pd(s);
+	for (int i = 0;i<NumberOfLanes;i+=2)
+		_mm_store_pd(&r.v[i], _mm_mul_pd(_mm_load_pd(&a.v[i]), sv));
+#else
+	for (int i = 0;i<NumberOfLanes;i++)
+		r.v[i] = a.v[i]*s;
+#endif
+}
+
+// r = a+b
+inline void lanesAdd(const Lanes& a, const Lanes& b, Lanes& r) {
+#if defined(__AVX2__)
+	for (int i = 0;i<NumberOfLanes;i+=4)
+		_mm256_store_pd(&r.v[i], _mm256_add_pd(_mm256_load_pd(&a.v[i]), _mm256_load_pd(&b.v[i])));
+#elif defined(__SSE2__)
+	for (int i = 0;i<NumberOfLanes;i+=2)
+		_mm_store_pd(&r.v[i], _mm_add_pd(_mm_load_pd(&a.v[i]), _mm_load_pd(&b.v[i])));
+#else
+	for (int i = 0;i<NumberOfLanes;i++)
+		r.v[i] = a.v[i]+b.v[i];
+#endif
+}
+
+// r = a-b
+inline void lanesSub(const Lanes& a, const Lanes& b, Lanes& r) {
+#if defined(__AVX2__)
+	for (int i = 0;i<NumberOfLanes;i+=4)
+		_mm256_store_pd(&r.v[i], _mm256_sub_pd(_mm256_load_pd(&a.v[i]), _mm256_load_pd(&b.v[i])));
+#elif defined(__SSE2__)
+	for (int i = 0;i<NumberOfLanes;i+=2)
+		_mm_store_pd(&r.v[i], _mm_sub_pd(_mm_load_pd(&a.v[i]), _mm_load_pd(&b.v[i])));
+#else
+	for (int i = 0;i<NumberOfLanes;i++)
+		r.v[i] = a.v[i]-b.v[i];
+#endif
+}
+
+// r = a*b + c (not fused)
+inline void lanesMulAdd(const Lanes& a, const Lanes& b, const Lanes& c, Lanes& r) {
+	Lanes p;
+	lanesMul(a,b,p);
+	lanesAdd(p,c,r);
+}
+
+// returns a bitmask with bit i set if a[i] < b[i]
+inline int lanesLess(const Lanes& a, const Lanes& b) {
+#if defined(__AVX2__)
+	int mask = 0;
+	for (int i = 0;i<NumberOfLanes;i+=4)
+		mask |= _mm256_movemask_pd(_mm256_cmp_pd(_mm256_load_pd(&a.v[i]), _mm256_load_pd(&b.v[i]), _CMP_LT_OQ)) << i;
+	return mask;
+#elif defined(__SSE2__)
+	int mask = 0;
+	for (int i = 0;i<NumberOfLanes;i+=2)
+		mask |= _mm_movemask_pd(_mm_cmplt_pd(_mm_load_pd(&a.v[i]), _mm_load_pd(&b.v[i]))) << i;
+	return mask;
+#else
+	int mask = 0;
+	for (int i = 0;i<NumberOfLanes;i++)
+		if (a.v[i] < b.v[i])
+			mask |= (1 << i);
+	return mask;
+#endif
+}
+
+// returns a bitmask with bit i set if a[i] < s
+inline int lanesLess(const Lanes& a, rational s) {
+	Lanes b;
+	lanesSet(b,s);
+	return lanesLess(a,b);
+}
+
+// returns a bitmask with bit i set if a[i] > s
+inline int lanesGreater(const Lanes& a, rational s) {
+	Lanes b;
+	lanesSet(b,s);
+	return lanesLess(b,a);
+}
+
+#endif /* SIMDLANES_H_ */
@@ -1,196 +1,457 @@
+#include <thread>
+#include <fstream>
+#include <map>
+#include <string.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 #include "Trajectory.h"
 #include "Kinematics.h"
 #include "logger.h"
 const int TrajectorySampleTime_ms = 100;
+const int MinSamplesPerCompileThread = 64; // below that, starting a thread costs more than it saves
 
+// the compilation is copied too, the motion thread plays trajectories compiled by the http thread
 Trajectory::Trajectory(const Trajectory& t) {
-	trajectory = t.trajectory;
-	interpolation = t.interpolation;
-	currentTrajectoryNode = t.currentTrajectoryNode;
+	*this = t;
 }
 void Trajectory::operator=(const Trajectory& t) {
 	trajectory = t.trajectory;
 	interpolation = t.interpolation;
+	speedProfile = t.speedProfile;
+	compiledCurve = t.compiledCurve;
+	compiledNodes = t.compiledNodes;
 	currentTrajectoryNode = t.currentTrajectoryNode;
+	compileThreads = t.compileThreads;
+	compiledIncrementally = t.compiledIncrementally;
 }
 
 Trajectory::Trajectory() {
 	currentTrajectoryNode = -1;// no currently selected node
+	compiledIncrementally = false;
+	setCompileThreads(std::thread::hardware_concurrency());
 }
 
-void Trajectory::compile() {
-	// update starting times per node
-	interpolation.clear();
-	speedProfile.clear();
+void Trajectory::setCompileThreads(int threads) {
+	compileThreads = max(threads, 1); // hardware_concurrency returns 0 if unknown
+}
 
+void Trajectory::compile(bool incrementally) {
+	// compilation modifies the nodes (kinematics, average speed). The state before is what the next compilation
+	// compares to, since a full compilation reads these modifications in the segment before the modified node
+	vector<TrajectoryNode> nodesBeforeCompilation(trajectory);
 	if (trajectory.size() > 1) {
-        // clear cache of trajectory nodes
-		clearCurve();
-
-		// resize interpolation and profile arrays
-		interpolation.resize(trajectory.size()-1);
-		speedProfile.resize(trajectory.size()-1);
-
-		// initialize first node
-		trajectory[0].time = 0;
-		trajectory[0].startSpeed= 0.0;
-		trajectory[0].endSpeed= 0.0;
-		trajectory[0].distance= 0.0;
-		trajectory[0].duration= 0.0;
+		int firstSegment, lastSegment;
+		if (incrementally && getDirtySegments(firstSegment, lastSegment)) {
+			if (firstSegment <= lastSegment) {
+				compileIncrementally(firstSegment, lastSegment);
+				compiledIncrementally = true;
+			}
+		}
+		else {
+			compileAll();
+			compiledIncrementally = false;
+		}
+	} else {
+		interpolation.clear();
+		speedProfile.clear();
+	}
+	compiledNodes.swap(nodesBeforeCompilation);
 
-		float fullDuration= 0;
-		float fullDistance= 0;
+	// if a node has been removed, the currently selected node could be out of range
+	if (currentTrajectoryNode >= (int)trajectory.size())
+		currentTrajectoryNode = (int)trajectory.size() -1;
+}
 
-		for (unsigned int i = 0;i<trajectory.size();i++) {
-			TrajectoryNode& curr = trajectory[i];
+// compile everything from scratch
+void Trajectory::compileAll() {
+	compileSegments();
+
+	// compute compiled curve depending on time slots
+	clearCurve();
+	milliseconds endTime = getCompiledDuration();
+	vector<int> slots;
+	for (int slot = 0;slot <= endTime/UITrajectorySampleRate;slot++)
+		slots.push_back(slot);
+	computeSamples(slots, endTime);
+}
 
-			// in case there is no user defined name, give it a number
-			if (curr.name.empty())
-				curr.name = int_to_string(i);
+// compute kinematics, bezier curves and speed profiles of all segments, but no samples
+void Trajectory::compileSegments() {
+	// resize interpolation and profile arrays
+	interpolation.clear();
+	speedProfile.clear();
+	interpolation.resize(trajectory.size()-1);
+	speedProfile.resize(trajectory.size()-1);
 
-			// depending on the interpolation type, choose the right kinematics computation (forward or inverse)
-			Kinematics::getInstance().computeInverseKinematics(curr.pose);
+	for (unsigned int i = 0;i<trajectory.size();i++)
+		compileSegment(i);
+}
 
-			if (i+1 < trajectory.size()) { // not the last node?
-				TrajectoryNode& next = trajectory[i+1];
+// Compile segments firstSegment..lastSegment only. Subsequent segments and their samples are taken over
+// from the previous compilation, shifted in time by the changed duration. Samples are taken over only
+// if their time is within half a sample of their slot, otherwise they are recomputed
+void Trajectory::compileIncrementally(int firstSegment, int lastSegment) {
+	int newSize = trajectory.size();
+	int oldSize = compiledNodes.size();
+	int shift = newSize - oldSize; // number of inserted (positive) or deleted (negative) nodes
+	milliseconds oldEndTime = getCompiledDuration();
+
+	// take over the segments before and after the dirty range, segments after are moved by shift
+	vector<BezierCurve> oldInterpolation(interpolation);
+	vector<SpeedProfile> oldSpeedProfile(speedProfile);
+	interpolation.resize(newSize-1);
+	speedProfile.resize(newSize-1);
+	for (int i = lastSegment+1;i<newSize-1;i++) {
+		interpolation[i] = oldInterpolation[i-shift];
+		speedProfile[i] = oldSpeedProfile[i-shift];
+	}
 
-				TrajectoryNode prev(curr);
-				TrajectoryNode nextnext(next);
-				if (i>0)
-					prev = trajectory[i-1];
-				if (i+2 < trajectory.size())
-					nextnext = trajectory[i+2];
+	// nodes after the dirty range still carry the result of the previous compilation
+	vector<milliseconds> oldTime(newSize);
+	vector<mmPerMillisecond> oldStartSpeed(newSize);
+	for (int i = 0;i<newSize;i++) {
+		oldTime[i] = trajectory[i].time;
+		oldStartSpeed[i] = trajectory[i].startSpeed;
+	}
 
-				// compute the bezier curve between this and next point
-				interpolation[i].set(prev, curr,next, nextnext);
+	for (int i = firstSegment;i<=lastSegment;i++)
+		compileSegment(i);
+
+	// the speed of the node after the dirty range is set by the last dirty segment,
+	// continue until the start speed equals the one of the previous compilation
+	while ((lastSegment+1 < newSize-1) && (trajectory[lastSegment+1].startSpeed != oldStartSpeed[lastSegment+1]))
+		compileSegment(++lastSegment);
+
+	// the last node has no segment, but kinematics needs to be computed
+	if (lastSegment == newSize-2)
+		compileSegment(newSize-1);
+
+	// shift the start time of all nodes after the dirty range. If the dirty range reaches the last node,
+	// that one might have been added and has no previous time, but there is nothing to take over anyway
+	int tailNode = lastSegment+1;
+	bool takeOverTail = (tailNode < newSize-1);
+	milliseconds oldDirtyEndTime = oldTime[tailNode];
+	milliseconds newDirtyEndTime = trajectory[tailNode].time;
+	milliseconds delta = takeOverTail?newDirtyEndTime - oldDirtyEndTime:0;
+	for (int i = tailNode;i<newSize-1;i++) {
+		trajectory[i+1].time = trajectory[i].time + trajectory[i].duration;
+		interpolation[i].getStart().time = trajectory[i].time;
+		interpolation[i].getEnd().time = trajectory[i+1].time;
+	}
 
-				// aproximate the distance via the bezier curve
-				curr.distance = interpolation[i].curveLength();
+	// take over the samples before and after the dirty range, compute the others
+	milliseconds dirtyStartTime = trajectory[firstSegment].time;
+	milliseconds endTime = getCompiledDuration();
+	int oldLastSlot = oldEndTime/UITrajectorySampleRate;
+	int lastSlot = endTime/UITrajectorySampleRate;
+	int slotShift = (int)round((float)delta/(float)UITrajectorySampleRate);
+
+	vector<TrajectoryNode> oldCurve;
+	oldCurve.swap(compiledCurve);
+	compiledCurve.resize(lastSlot+1);
+	vector<int> slots;
+	for (int slot = 0;slot<=lastSlot;slot++) {
+		milliseconds time = getSampleTime(slot, endTime);
+		if ((time < dirtyStartTime) && (slot < oldLastSlot)) {
+			compiledCurve[slot] = oldCurve[slot];
+		} else {
+			int oldSlot = slot - slotShift;
+			if (takeOverTail && (time > newDirtyEndTime) && (slot < lastSlot) && (oldSlot >= 0) && (oldSlot < oldLastSlot) &&
+				(oldCurve[oldSlot].time > oldDirtyEndTime) &&
+				(abs(oldCurve[oldSlot].time + delta - time) <= UITrajectorySampleRate/2)) {
+				compiledCurve[slot] = oldCurve[oldSlot];
+				compiledCurve[slot].time += delta;
+			}
+			else
+				slots.push_back(slot);
+		}
+	}
+	computeSamples(slots, endTime);
+}
 
-				// duration is either user defined, or computed via the average speed
-				if (curr.durationDef != 0)
-					curr.duration = curr.durationDef;
-				else
-					curr.duration = milliseconds(curr.distance / curr.averageSpeedDef);
+// compute the kinematics of node i and bezier curve and speed profile of the segment starting at node i
+void Trajectory::compileSegment(int i) {
+	TrajectoryNode& curr = trajectory[i];
+
+	// initialize first node
+	if (i == 0) {
+		curr.time = 0;
+		curr.startSpeed= 0.0;
+		curr.endSpeed= 0.0;
+		curr.distance= 0.0;
+		curr.duration= 0.0;
+	}
 
+	// in case there is no user defined name, give it a number
+	if (curr.name.empty())
+		curr.name = int_to_string(i);
+
+	// depending on the interpolation type, choose the right kinematics computation (forward or inverse)
+	Kinematics::getInstance().computeInverseKinematics(curr.pose);
+
+	if (i+1 < (int)trajectory.size()) { // not the last node?
+		TrajectoryNode& next = trajectory[i+1];
+
+		TrajectoryNode prev(curr);
+		TrajectoryNode nextnext(next);
+		if (i>0)
+			prev = trajectory[i-1];
+		if (i+2 < (int)trajectory.size())
+			nextnext = trajectory[i+2];
+
+		// compute the bezier curve between this and next point
+		interpolation[i].set(prev, curr,next, nextnext);
+
+		// aproximate the distance via the bezier curve
+		curr.distance = interpolation[i].curveLength();
+
+		// duration is either user defined, or computed via the average speed
+		if (curr.durationDef != 0)
+			curr.duration = curr.durationDef;
+		else
+			curr.duration = milliseconds(curr.distance / curr.averageSpeedDef);
+
+		if (i == 0) {
+			// first node, start with speed of 0
+			if (i == (int)trajectory.size() - 2) {
+				// just two nodes, we are on the first
+				curr.startSpeed = 0;
+				next.startSpeed = 0;
+				next.distance = 0.0;
+				bool possibleWithoutAmendments = speedProfile[i].computeSpeedProfile(curr.startSpeed, next.startSpeed, curr.distance, curr.duration);
+				if (!possibleWithoutAmendments)
+					curr.averageSpeedDef = curr.distance / curr.duration;
+			} else {
+				// first node, and we have at least three nodes, accelerate to average speed
+				curr.startSpeed = 0;
+				next.startSpeed = next.averageSpeedDef;
+				if (!curr.continouslyDef)
+					next.startSpeed = 0;
+				bool endSpeedFine = true;
+				if (curr.startSpeed != 0) {
+					rational computedDuration;
+					endSpeedFine = SpeedProfile::getRampProfileDuration(curr.startSpeed, next.startSpeed, curr.distance, computedDuration);
+					if (computedDuration>curr.duration)
+						curr.duration = computedDuration;
+				}
+				/* bool possibleWithoutAmendments = */ speedProfile[i].computeSpeedProfile(curr.startSpeed, next.startSpeed, curr.distance, curr.duration);
+				if (!endSpeedFine)
+					curr.averageSpeedDef = next.startSpeed;
+			}
+		} else {
+			if (i == (int)trajectory.size()-2) {
 				if (i == 0) {
-					// first node, start with speed of 0
-					if (i == trajectory.size() - 2) {
-						// just two nodes, we are on the first
-						curr.startSpeed = 0;
-						next.startSpeed = 0;
-						next.distance = 0.0;
-						bool possibleWithoutAmendments = speedProfile[i].computeSpeedProfile(curr.startSpeed, next.startSpeed, curr.distance, curr.duration);
-						if (!possibleWithoutAmendments)
-							curr.averageSpeedDef = curr.distance / curr.duration;
-					} else {
-						// first node, and we have at least three nodes, accelerate to average speed
-						curr.startSpeed = 0;
-						next.startSpeed = next.averageSpeedDef;
-						if (!curr.continouslyDef)
-							next.startSpeed = 0;
-						bool endSpeedFine = true;
-						if (curr.startSpeed != 0) {
-							rational computedDuration;
-							endSpeedFine = SpeedProfile::getRampProfileDuration(curr.startSpeed, next.startSpeed, curr.distance, computedDuration);
-							if (computedDuration>curr.duration)
-								curr.duration = computedDuration;
-						}
-						/* bool possibleWithoutAmendments = */ speedProfile[i].computeSpeedProfile(curr.startSpeed, next.startSpeed, curr.distance, curr.duration);
-						if (!endSpeedFine)
-							curr.averageSpeedDef = next.startSpeed;
-					}
+					// we have two nodes and are on the last one
+					// Dont compute speed profile again
+					next.startSpeed = 0;
+					next.distance = 0.0;
+					next.duration = 0.0;
 				} else {
-					if (i == trajectory.size()-2) {
-						if (i == 0) {
-							// we have two nodes and are on the last one
-							// Dont compute speed profile again
-							next.startSpeed = 0;
-							next.distance = 0.0;
-							next.duration = 0.0;
-						} else {
-							// next is last node, and we have more than two nodes, we end up with speed of 0
-							next.startSpeed = 0;
-							bool endSpeedFine = true;
-							if (curr.startSpeed != 0) {
-								rational computedDuration;
-								endSpeedFine = SpeedProfile::getRampProfileDuration(curr.startSpeed, next.startSpeed, curr.distance, computedDuration);
-								if (computedDuration>curr.duration)
-									curr.duration = computedDuration;
-							}
-							/*bool possibleWithoutAmendments = */speedProfile[i].computeSpeedProfile(curr.startSpeed, next.startSpeed, curr.distance, curr.duration);
-							curr.averageSpeedDef = curr.startSpeed;
-
-							if (!endSpeedFine) {
-								// todo: backtracking, end speed not null.
-							}
-							next.distance = 0.0;
-							next.duration = 0.0;
-						}
-					} else {
-						// neither first nor last node, somewhere in the middle.
-						if (i == trajectory.size()-3)
-							next.startSpeed = nextnext.averageSpeedDef;
-						else
-							next.startSpeed = next.averageSpeedDef;
-
-						if (!curr.continouslyDef)
-							next.startSpeed = 0;
-
-						bool possibleWithoutAmendments = speedProfile[i].computeSpeedProfile(curr.startSpeed, next.startSpeed, curr.distance, curr.duration);
-						if (!possibleWithoutAmendments)
-							curr.averageSpeedDef = curr.distance / curr.duration;
+					// next is last node, and we have more than two nodes, we end up with speed of 0
+					next.startSpeed = 0;
+					bool endSpeedFine = true;
+					if (curr.startSpeed != 0) {
+						rational computedDuration;
+						endSpeedFine = SpeedProfile::getRampProfileDuration(curr.startSpeed, next.startSpeed, curr.distance, computedDuration);
+						if (computedDuration>curr.duration)
+							curr.duration = computedDuration;
 					}
-				}
-
+					/*bool possibleWithoutAmendments = */speedProfile[i].computeSpeedProfile(curr.startSpeed, next.startSpeed, curr.distance, curr.duration);
+					curr.averageSpeedDef = curr.startSpeed;
 
-				next.time = curr.time + curr.duration;
+					if (!endSpeedFine) {
+						// todo: backtracking, end speed not null.
+					}
+					next.distance = 0.0;
+					next.duration = 0.0;
+				}
+			} else {
+				// neither first nor last node, somewhere in the middle.
+				if (i == (int)trajectory.size()-3)
+					next.startSpeed = nextnext.averageSpeedDef;
+				else
+					next.startSpeed = next.averageSpeedDef;
 
-				interpolation[i].getStart() = curr; // assign the computed values into bezier curve
-				interpolation[i].getEnd() = next;
+				if (!curr.continouslyDef)
+					next.startSpeed = 0;
 
-				fullDuration += curr.duration;
-				fullDistance += curr.distance;
-				curr.endSpeed = next.startSpeed;
+				bool possibleWithoutAmendments = speedProfile[i].computeSpeedProfile(curr.startSpeed, next.startSpeed, curr.distance, curr.duration);
+				if (!possibleWithoutAmendments)
+					curr.averageSpeedDef = curr.distance / curr.duration;
 			}
 		}
 
-		// compute compiled curve depending on time slots
-		milliseconds startTime = trajectory[0].time;
-		milliseconds endTime = fullDuration;
-		milliseconds time = startTime;
-		TrajectoryNode prev;
-		while (time < endTime+UITrajectorySampleRate) {
-			TrajectoryNode node = computeNodeByTime(time, false);
-
-			// depending on the interpolation type, choose the right kinematics computation (forward or inverse)
-			if (node.isPoseInterpolation())
-				Kinematics::getInstance().computeInverseKinematics(node.pose);
-			else
-				Kinematics::getInstance().computeForwardKinematics(node.pose);
-
-			// change timing from support points to finegrained interpolation
-			node.time = time;
-			node.duration = UITrajectorySampleRate;
-			node.startSpeed = node.averageSpeedDef;
-			if (!prev.isNull())
-				prev.distance = prev.pose.distance(node.pose);
-
-			// store kinematics in trajectory
-			if (time > endTime)
-				setCurvePoint(endTime, node);
-			else
-				setCurvePoint(time, node);
 
-			// next time step
-			time += UITrajectorySampleRate;
-			prev = node;
+		next.time = curr.time + curr.duration;
+
+		interpolation[i].getStart() = curr; // assign the computed values into bezier curve
+		interpolation[i].getEnd() = next;
+
+		curr.endSpeed = next.startSpeed;
+	}
+}
+
+// returns the dirty range of segments compared to the previous compilation. Returns false if everything needs
+// to be compiled. If nothing changed, firstSegment is greater than lastSegment.
+bool Trajectory::getDirtySegments(int& firstSegment, int& lastSegment) {
+	int newSize = trajectory.size();
+	int oldSize = compiledNodes.size();
+	if ((oldSize < 2) || ((int)interpolation.size() != oldSize-1) || ((int)speedProfile.size() != oldSize-1))
+		return false;
+
+	// number of untouched nodes at the beginning and at the end
+	int minSize = min(newSize, oldSize);
+	int prefix = 0;
+	while ((prefix < minSize) && isSameNode(trajectory[prefix], compiledNodes[prefix]))
+		prefix++;
+	int suffix = 0;
+	while ((suffix < minSize-prefix) && isSameNode(trajectory[newSize-1-suffix], compiledNodes[oldSize-1-suffix]))
+		suffix++;
+
+	if ((prefix == newSize) && (newSize == oldSize)) {
+		firstSegment = 0;
+		lastSegment = -1;
+		return true;
+	}
+
+	// a bezier curve depends on two nodes before and one node after, the speed profile on the next two nodes
+	int lastChangedNode = newSize-1-suffix; // less than prefix if nodes have been deleted only
+	firstSegment = max(0, prefix-2);
+	lastSegment = min(newSize-2, lastChangedNode+1);
+
+	// the last three segments depend on the number of nodes
+	if ((newSize != oldSize) && (firstSegment > newSize-3))
+		firstSegment = max(0, newSize-3);
+
+	// nothing to take over at the end
+	if (suffix == 0)
+		lastSegment = newSize-2;
+
+	return true;
+}
+
+// true if both nodes have the same input of the compilation
+bool Trajectory::isSameNode(const TrajectoryNode& a, const TrajectoryNode& b) {
+	for (int i = 0;i<3;i++) {
+		if ((a.pose.position[i] != b.pose.position[i]) || (a.pose.orientation[i] != b.pose.orientation[i]))
+			return false;
+	}
+	for (int i = 0;i<NumberOfActuators;i++) {
+		if (a.pose.angles[i] != b.pose.angles[i])
+			return false;
+	}
+	return (a.pose.gripperDistance == b.pose.gripperDistance) &&
+		   (a.durationDef == b.durationDef) &&
+		   (a.interpolationTypeDef == b.interpolationTypeDef) &&
+		   (a.averageSpeedDef == b.averageSpeedDef) &&
+		   (a.continouslyDef == b.continouslyDef);
+}
+
+// duration of the compiled trajectory, summed up like the compilation does
+milliseconds Trajectory::getCompiledDuration() {
+	float fullDuration = 0;
+	for (unsigned int i = 0;i+1<trajectory.size();i++)
+		fullDuration += trajectory[i].duration;
+	return fullDuration;
+}
+
+// time a sample slot represents. The last slot contains the end of the trajectory
+milliseconds Trajectory::getSampleTime(int slot, milliseconds endTime) {
+	milliseconds time = slot*UITrajectorySampleRate;
+	if ((slot == endTime/UITrajectorySampleRate) && (time < endTime))
+		time += UITrajectorySampleRate;
+	return time;
+}
+
+// compute the samples of the passed slots, i.e. interpolate the curve and compute kinematics.
+// Samples do not depend on each other, since inverse kinematics is seeded by the angles interpolated
+// out of the segment's support nodes. So the slots are split into consecutive chunks computed in parallel,
+// the result does not depend on the number of threads.
+void Trajectory::computeSamples(const vector<int>& slots, milliseconds endTime) {
+	int numberOfSamples = slots.size();
+	vector<TrajectoryNode> samples(numberOfSamples);
+	int chunks = constrain(numberOfSamples/MinSamplesPerCompileThread, 1, compileThreads);
+	int chunkSize = (numberOfSamples + chunks - 1)/chunks;
+	vector<std::thread> threads;
+	for (int chunk = 1;chunk<chunks;chunk++)
+		threads.push_back(std::thread(&Trajectory::computeSampleChunk, this, std::cref(slots),
+				chunk*chunkSize, min((chunk+1)*chunkSize, numberOfSamples), endTime, std::ref(samples)));
+	computeSampleChunk(slots, 0, min(chunkSize, numberOfSamples), endTime, samples);
+	for (unsigned int i = 0;i<threads.size();i++)
+		threads[i].join();
+
+	if (!slots.empty() && ((int)compiledCurve.size() <= slots.back()))
+		compiledCurve.resize(slots.back()+1);
+	for (unsigned int i = 0;i<slots.size();i++) {
+		TrajectoryNode& node = samples[i];
+
+		// change timing from support points to finegrained interpolation
+		node.time = getSampleTime(slots[i], endTime);
+		node.duration = UITrajectorySampleRate;
+		node.startSpeed = node.averageSpeedDef;
+
+		// store kinematics in trajectory
+		compiledCurve[slots[i]] = node;
+	}
+}
+
+// compute the samples slots[begin..end-1] into samples[begin..end-1]. Runs concurrently on disjoint ranges,
+// so it must not modify the trajectory
+void Trajectory::computeSampleChunk(const vector<int>& slots, int begin, int end, milliseconds endTime, vector<TrajectoryNode>& samples) {
+	// interpolate all samples first, then compute the kinematics of all pose interpolated samples in one batch
+	vector<int> ikSamples;
+	for (int i = begin;i<end;i++) {
+		samples[i] = computeNodeByTime(getSampleTime(slots[i], endTime), false);
+		if (samples[i].isPoseInterpolation())
+			ikSamples.push_back(i);
+		else
+			Kinematics::getInstance().computeForwardKinematics(samples[i].pose);
+	}
+	computeInverseKinematics(samples, ikSamples);
+}
+
+// compute inverse kinematics of the samples with the passed indexes via the batch interface
+void Trajectory::computeInverseKinematics(vector<TrajectoryNode>& samples, const vector<int>& sampleIdx) {
+	int n = sampleIdx.size();
+	if (n == 0)
+		return;
+
+	// structure-of-arrays buffer, 7 input rows, 7 seed rows and 7 output rows
+	vector<rational> buffer(n*(7+2*NumberOfActuators));
+	PoseBatch batch;
+	batch.size = n;
+	rational* row = &buffer[0];
+	for (int i = 0;i<n;i++) {
+		const Pose& pose = samples[sampleIdx[i]].pose;
+		for (int c = 0;c<3;c++) {
+			row[c*n+i] = pose.position[c];
+			row[(3+c)*n+i] = pose.orientation[c];
 		}
+		row[6*n+i] = pose.gripperDistance;
+		for (int a = 0;a<NumberOfActuators;a++)
+			row[(7+a)*n+i] = pose.angles[a];
+	}
+	for (int c = 0;c<3;c++) {
+		batch.position[c] = &row[c*n];
+		batch.orientation[c] = &row[(3+c)*n];
+	}
+	batch.gripperDistance = &row[6*n];
+	for (int a = 0;a<NumberOfActuators;a++) {
+		batch.seed[a] = &row[(7+a)*n];
+		batch.angles[a] = &row[(7+NumberOfActuators+a)*n];
 	}
 
-	// if a node has been removed, the currently selected node could be out of range
-	if (currentTrajectoryNode >= (int)trajectory.size())
-		currentTrajectoryNode = (int)trajectory.size() -1;
+	Kinematics::getInstance().computeInverseKinematicsBatch(batch);
+
+	for (int i = 0;i<n;i++) {
+		Pose& pose = samples[sampleIdx[i]].pose;
+		for (int a = 0;a<NumberOfActuators;a++)
+			pose.angles[a] = batch.angles[a][i];
+	}
 }
 
 TrajectoryNode& Trajectory::get(int idx) {
@@ -233,11 +494,11 @@ TrajectoryNode Trajectory::computeNodeByTime(milliseconds time, bool select) {
 			SpeedProfile& profile= speedProfile[idx];
 			float t = ((float)time-startNode.time) / ((float)startNode.duration);
 
-			// adapt time ratio with speed profile
+			// adapt time ratio with speed profile, this gives the ratio of the distance on the curve
 			t = profile.apply(SpeedProfile::TRAPEZOIDAL, t);
 
-			// now get position within bezier curve
-			result = bezier.getCurrent(t);
+			// now get position within bezier curve by mapping the distance to the curve parameter
+			result = bezier.getCurrent(bezier.getParameterByLengthRatio(t));
 		} else {
 			result = trajectory[trajectory.size()-1];
 		}
@@ -341,11 +602,200 @@ Trajectory  Trajectory::unmarshal(string str) {
 void Trajectory::load(string filename) {
 	trajectory.clear();
 	interpolation.clear();
+	compiledNodes.clear();
 	currentTrajectoryNode= -1;
-	merge(filename);
+
+	TrajectoryFileView file;
+	if (file.open(filename))
+		loadBinary(file);
+	else
+		merge(filename);
+}
+
+// take over nodes and samples of a binary file. Samples are used only if they have been compiled
+// from these nodes with the current kinematics, otherwise the trajectory is compiled
+void Trajectory::loadBinary(TrajectoryFileView& file) {
+	for (int i = 0;i<file.getNumberOfNodes();i++)
+		trajectory.push_back(file.toNode(file.getNode(i)));
+
+	int numberOfSamples = file.getNumberOfSamples();
+	if ((numberOfSamples > 0) && (file.getSampleRate() == UITrajectorySampleRate) &&
+		(file.getCompilationHash() == getCompilationHash())) {
+		vector<TrajectoryNode> samples(numberOfSamples);
+		for (int i = 0;i<numberOfSamples;i++)
+			samples[i] = file.toNode(file.getSample(i));
+		if (compileWithSamples(samples))
+			return;
+	}
+	compile();
+}
+
+// compile bezier curves and speed profiles only and take over the passed samples instead of computing them.
+// Returns false without changing anything if the number of samples does not fit to the trajectory
+bool Trajectory::compileWithSamples(vector<TrajectoryNode>& samples) {
+	if (trajectory.size() < 2)
+		return false;
+
+	vector<TrajectoryNode> nodesBeforeCompilation(trajectory);
+	compileSegments();
+	if ((int)samples.size() != getCompiledDuration()/UITrajectorySampleRate + 1) {
+		trajectory.swap(nodesBeforeCompilation);
+		return false;
+	}
+	compiledCurve.swap(samples);
+	compiledIncrementally = false; // samples are passed on from full compilations only
+	compiledNodes.swap(nodesBeforeCompilation);
+	return true;
+}
+
+uint32_t Trajectory::getCompilationHash() const {
+	int indent = 0;
+	return getCompilationHash(toString(indent));
+}
+
+uint32_t Trajectory::getCompilationHash(const string& trajectoryStr) {
+	uint32_t hash = hashString(trajectoryStr);
+	hash = hashString(int_to_string(UITrajectorySampleRate), hash);
+	hash = hashString(int_to_string(Kinematics::getInstance().getConstantsHash()), hash);
+	return hash;
+}
+
+string Trajectory::samplesToString(uint32_t hash, int &indent) const {
+	stringstream str;
+	str << listStartToString("samples",indent);
+	str << uint32ToString("hash", hash);
+	str << intToString("rate", UITrajectorySampleRate);
+	str << intToString("count", compiledCurve.size());
+	str << endofline(indent);
+	for (unsigned i = 0;i< compiledCurve.size();i++)
+		str << compiledCurve[i].pose.angles.toString(indent);
+	str << listEndToString(indent);
+	return str.str();
+}
+
+bool Trajectory::samplesFromString(const string& str, int &idx, uint32_t hash) {
+	if (!listStartFromString("samples", str, idx))
+		return false; // no precompiled samples sent
+
+	uint32_t sentHash;
+	int rate, count;
+	bool ok = uint32FromString("hash", str, sentHash, idx);
+	ok = ok && intFromString("rate", str, rate, idx);
+	ok = ok && intFromString("count", str, count, idx);
+	if (!ok) {
+		LOG(ERROR) << "parse error samples";
+		return false;
+	}
+	if ((sentHash != hash) || (rate != UITrajectorySampleRate)) {
+		LOG(WARNING) << "samples have been compiled differently, compile again";
+		return false;
+	}
+
+	vector<TrajectoryNode> samples(max(count,0));
+	for (int i = 0;ok && (i<count);i++)
+		ok = samples[i].pose.angles.fromString(str, idx);
+	ok = ok && listEndFromString(str, idx);
+	if (!ok) {
+		LOG(ERROR) << "parse error samples";
+		return false;
+	}
+	if (!compileWithSamples(samples)) {
+		LOG(WARNING) << "samples do not fit to trajectory, compile again";
+		return false;
+	}
+
+	// take over the attributes of the support node of each sample, like computeSamples does
+	milliseconds endTime = getCompiledDuration();
+	unsigned int nodeIdx = 0;
+	for (int slot = 0;slot<count;slot++) {
+		TrajectoryNode& sample = compiledCurve[slot];
+		milliseconds time = getSampleTime(slot, endTime);
+		while ((nodeIdx < trajectory.size()-1) && (trajectory[nodeIdx].time + trajectory[nodeIdx].duration < time))
+			nodeIdx++;
+		Pose pose;
+		pose.angles = sample.pose.angles;
+		Kinematics::getInstance().computeForwardKinematics(pose);
+		sample = trajectory[nodeIdx];
+		sample.pose = pose;
+		sample.time = time;
+		sample.duration = UITrajectorySampleRate;
+		sample.startSpeed = sample.averageSpeedDef;
+	}
+	return true;
+}
+
+bool Trajectory::saveBinary(string filename, bool withSamples) {
+	if (withSamples && compiledIncrementally)
+		compile(false);
+
+	// string table with each name once
+	string stringTable;
+	map<string, uint32_t> stringOffset;
+	vector<TrajectoryNodeRecord> records;
+	int numberOfSamples = withSamples?compiledCurve.size():0;
+	for (int i = 0;i<(int)trajectory.size() + numberOfSamples;i++) {
+		const TrajectoryNode& node = (i < (int)trajectory.size())?trajectory[i]:compiledCurve[i-trajectory.size()];
+		TrajectoryNodeRecord r;
+		memset(&r, 0, sizeof(r));
+		for (int c = 0;c<3;c++) {
+			r.position[c] = node.pose.position[c];
+			r.orientation[c] = node.pose.orientation[c];
+			r.tcpDeviation[c] = node.pose.tcpDeviation[c];
+		}
+		for (int a = 0;a<NumberOfActuators;a++)
+			r.angles[a] = node.pose.angles[a];
+		r.gripperDistance = node.pose.gripperDistance;
+		r.averageSpeedDef = node.averageSpeedDef;
+		r.duration = node.duration;
+		r.startSpeed = node.startSpeed;
+		r.endSpeed = node.endSpeed;
+		r.distance = node.distance;
+		r.durationDef = node.durationDef;
+		r.time = node.time;
+		if (stringOffset.find(node.name) == stringOffset.end()) {
+			stringOffset[node.name] = stringTable.size();
+			stringTable += node.name;
+		}
+		r.nameOffset = stringOffset[node.name];
+		r.nameLength = node.name.size();
+		r.interpolationTypeDef = node.interpolationTypeDef;
+		r.continouslyDef = node.continouslyDef;
+		records.push_back(r);
+	}
+
+	TrajectoryFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, TrajectoryFileMagic, sizeof(header.magic));
+	header.version = TrajectoryFileVersion;
+	header.nodeCount = trajectory.size();
+	header.recordSize = sizeof(TrajectoryNodeRecord);
+	header.sampleCount = numberOfSamples;
+	header.sampleRate = UITrajectorySampleRate;
+	header.stringTableSize = stringTable.size();
+	header.compilationHash = getCompilationHash();
+
+	ofstream f(filename, ios::out | ios::binary);
+	f.write((const char*)&header, sizeof(header));
+	if (!records.empty())
+		f.write((const char*)&records[0], records.size()*sizeof(TrajectoryNodeRecord));
+	f.write(stringTable.c_str(), stringTable.size());
+	f.close();
+	if (!f) {
+		LOG(ERROR) << "could not write " << filename;
+		return false;
+	}
+	return true;
 }
 
 void Trajectory::merge(string filename) {
+	TrajectoryFileView file;
+	if (file.open(filename)) {
+		for (int i = 0;i<file.getNumberOfNodes();i++)
+			trajectory.push_back(file.toNode(file.getNode(i)));
+		compile();
+		return;
+	}
+
 	ifstream f(filename);
 	TrajectoryNode node;
 	string str;
@@ -386,7 +836,6 @@ bool Trajectory::fromString(const string& str, int &idx) {
 	trajectory.clear();
 	do {
     	TrajectoryNode node;
-    	string s = str.substr(idx);
         ok = node.fromString(str,idx);
         if (ok)
         	trajectory.insert(trajectory.end(),node);
@@ -396,4 +845,127 @@ bool Trajectory::fromString(const string& str, int &idx) {
     return ok;
 }
 
+TrajectoryFileView::TrajectoryFileView() {
+	data = NULL;
+	dataSize = 0;
+	mapped = false;
+	header = NULL;
+}
+
+TrajectoryFileView::~TrajectoryFileView() {
+	close();
+}
+
+bool TrajectoryFileView::open(string filename) {
+	close();
+
+	// records are read in place, this works on little endian machines only
+	const uint16_t endianTest = 1;
+	if (*(const uint8_t*)&endianTest != 1) {
+		LOG(ERROR) << "binary trajectory files require a little endian machine";
+		return false;
+	}
+
+#ifdef _WIN32
+	ifstream f(filename, ios::in | ios::binary);
+	if (!f)
+		return false;
+	f.seekg(0, ios::end);
+	buffer.resize(f.tellg());
+	f.seekg(0, ios::beg);
+	if (!buffer.empty())
+		f.read(&buffer[0], buffer.size());
+	if (buffer.empty() || !f) {
+		close();
+		return false;
+	}
+	data = &buffer[0];
+	dataSize = buffer.size();
+#else
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	if ((fstat(fd, &st) != 0) || (st.st_size == 0)) {
+		::close(fd);
+		return false;
+	}
+	void* addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd); // the mapping stays valid
+	if (addr == MAP_FAILED)
+		return false;
+	data = (const char*)addr;
+	dataSize = st.st_size;
+	mapped = true;
+#endif
+
+	// check header and size of the sections
+	header = (const TrajectoryFileHeader*)data;
+	bool ok = (dataSize >= sizeof(TrajectoryFileHeader)) &&
+			  (memcmp(header->magic, TrajectoryFileMagic, sizeof(header->magic)) == 0);
+	if (ok && (header->version != TrajectoryFileVersion)) {
+		LOG(ERROR) << "binary trajectory file " << filename << " has unknown version " << header->version;
+		ok = false;
+	}
+	if (ok) {
+		uint64_t expectedSize = sizeof(TrajectoryFileHeader) +
+				((uint64_t)header->nodeCount + header->sampleCount)*header->recordSize + header->stringTableSize;
+		if ((header->recordSize < sizeof(TrajectoryNodeRecord)) || (header->recordSize % 8 != 0) || (dataSize < expectedSize)) {
+			LOG(ERROR) << "binary trajectory file " << filename << " is corrupt";
+			ok = false;
+		}
+	}
+	if (!ok)
+		close();
+	return ok;
+}
+
+void TrajectoryFileView::close() {
+#ifndef _WIN32
+	if (mapped)
+		munmap((void*)data, dataSize);
+#endif
+	buffer.clear();
+	data = NULL;
+	dataSize = 0;
+	mapped = false;
+	header = NULL;
+}
 
+const TrajectoryNodeRecord& TrajectoryFileView::getNode(int idx) {
+	return *(const TrajectoryNodeRecord*)(data + sizeof(TrajectoryFileHeader) + (size_t)idx*header->recordSize);
+}
+
+const TrajectoryNodeRecord& TrajectoryFileView::getSample(int idx) {
+	return getNode(header->nodeCount + idx);
+}
+
+string TrajectoryFileView::getName(const TrajectoryNodeRecord& record) {
+	const char* stringTable = data + sizeof(TrajectoryFileHeader) + ((size_t)header->nodeCount + header->sampleCount)*header->recordSize;
+	if ((uint64_t)record.nameOffset + record.nameLength > header->stringTableSize)
+		return "";
+	return string(stringTable + record.nameOffset, record.nameLength);
+}
+
+TrajectoryNode TrajectoryFileView::toNode(const TrajectoryNodeRecord& record) {
+	TrajectoryNode node;
+	for (int c = 0;c<3;c++) {
+		node.pose.position[c] = record.position[c];
+		node.pose.orientation[c] = record.orientation[c];
+		node.pose.tcpDeviation[c] = record.tcpDeviation[c];
+	}
+	for (int a = 0;a<NumberOfActuators;a++)
+		node.pose.angles[a] = record.angles[a];
+	node.pose.gripperDistance = record.gripperDistance;
+	node.averageSpeedDef = record.averageSpeedDef;
+	node.duration = record.duration;
+	node.startSpeed = record.startSpeed;
+	node.endSpeed = record.endSpeed;
+	node.distance = record.distance;
+	node.durationDef = record.durationDef;
+	node.time = record.time;
+	node.name = getName(record);
+	node.interpolationTypeDef = (InterpolationType)record.interpolationTypeDef;
+	node.continouslyDef = record.continouslyDef;
+	return node;
+}
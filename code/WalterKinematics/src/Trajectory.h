@@ -14,6 +14,76 @@
 
 using namespace std;
 
+// Binary trajectory file, all values are little endian. Layout is
+//    header | node records | sample records (optional) | string table
+// Records have a fixed size and are 8-byte aligned, so a mapped file can be read without copying.
+const char TrajectoryFileMagic[4] = { 'W','T','R','J' };
+const uint32_t TrajectoryFileVersion = 1;
+
+struct TrajectoryFileHeader {
+	char magic[4];				// TrajectoryFileMagic
+	uint32_t version;			// TrajectoryFileVersion
+	uint32_t nodeCount;			// number of support nodes
+	uint32_t recordSize;		// size of node and sample records, allows to append fields in later versions
+	uint32_t sampleCount;		// number of compiled samples, 0 if not stored
+	uint32_t sampleRate;		// [ms] time between two samples
+	uint32_t stringTableSize;	// [bytes] size of string table at the end of the file
+	uint32_t compilationHash;	// getCompilationHash of the nodes the samples have been compiled from
+};
+
+struct TrajectoryNodeRecord {
+	double position[3];
+	double orientation[3];
+	double tcpDeviation[3];
+	double angles[NumberOfActuators];
+	double gripperDistance;
+	double averageSpeedDef;
+	double duration;
+	double startSpeed;
+	double endSpeed;
+	double distance;
+	int32_t durationDef;
+	int32_t time;
+	uint32_t nameOffset;		// offset of name within the string table
+	uint32_t nameLength;
+	uint8_t interpolationTypeDef;
+	uint8_t continouslyDef;
+	uint8_t reserved[6];
+};
+
+// read-only view on a binary trajectory file. The file is mapped into memory, records are
+// accessed in place. On Windows, the file is read into a buffer instead.
+class TrajectoryFileView {
+public:
+	TrajectoryFileView();
+	~TrajectoryFileView();
+
+	// map the file and check its header. Returns false if it is not a valid binary trajectory file.
+	bool open(string filename);
+	void close();
+
+	int getNumberOfNodes() { return header->nodeCount; };
+	int getNumberOfSamples() { return header->sampleCount; };
+	milliseconds getSampleRate() { return header->sampleRate; };
+	uint32_t getCompilationHash() { return header->compilationHash; };
+
+	const TrajectoryNodeRecord& getNode(int idx);
+	const TrajectoryNodeRecord& getSample(int idx);
+	string getName(const TrajectoryNodeRecord& record);
+
+	// convert a record into a trajectory node
+	TrajectoryNode toNode(const TrajectoryNodeRecord& record);
+private:
+	TrajectoryFileView(const TrajectoryFileView&);
+	void operator=(const TrajectoryFileView&);
+
+	const char* data;
+	size_t dataSize;
+	bool mapped;
+	vector<char> buffer;
+	const TrajectoryFileHeader* header;
+};
+
 
 class Trajectory {
 public:
@@ -21,8 +91,18 @@ public:
 	Trajectory(const Trajectory& t);
 	void operator=(const Trajectory& t);
 
-	// compute speed profile and interpolation points out of given trajectory
-	void compile();
+	// compute speed profile and interpolation points out of given trajectory. Only the segments
+	// around nodes that changed since the previous compilation are recomputed, unless incrementally is false.
+	void compile(bool incrementally = true);
+
+	// true if the samples are the result of an incremental compilation. Sample times may then differ
+	// by up to one sample from a full compilation, so these samples must not be passed on.
+	bool isCompiledIncrementally() const { return compiledIncrementally; };
+
+	// number of threads computing the samples during compilation, 1 computes everything in the calling thread.
+	// Default is the number of cores.
+	void setCompileThreads(int threads);
+	int getCompileThreads() { return compileThreads; };
 
 	// returns the trajectory node vector. Supposed to be used for adding new nodes
 	vector<TrajectoryNode>& getSupportNodes() { return trajectory; };
@@ -55,16 +135,49 @@ public:
 	// assign the trajectory from the passed string at index idx
 	bool fromString(const string& str, int &idx);
 
+	// hash of a trajectory string and the kinematic constants. Identifies the result of a compilation.
+	static uint32_t getCompilationHash(const string& trajectoryStr);
+	uint32_t getCompilationHash() const;
+
+	// get a string out of the compiled joint angles of all samples. Sent after the trajectory, so the receiver
+	// does not need to compile again. Pass the compilation hash of the sent trajectory string. Samples need
+	// to be the result of a full compilation.
+	string samplesToString(uint32_t hash, int &indent) const;
+
+	// take over the compiled joint angles from the passed string instead of compiling. Returns false
+	// if the string has no samples, the hash differs from the passed one or the samples do not fit to the
+	// trajectory. The trajectory needs to be compiled then.
+	bool samplesFromString(const string& str, int &idx, uint32_t hash);
+
 	// save trajectory to a file
 	void save(string filename);
 
-	// load trajectory from file. Existing trajectory is deleted.
+	// save trajectory to a binary file, optionally including the compiled samples. If these are the result
+	// of an incremental compilation, the trajectory is compiled again fully before.
+	bool saveBinary(string filename, bool withSamples);
+
+	// load trajectory from file, text or binary. Existing trajectory is deleted.
+	// If a binary file contains samples of the same compilation hash, these are taken instead of being computed.
 	void load(string filename);
 
 	// merge trajectory to existing trajectory
 	void merge(string filename);
 private:
+	void compileAll();
+	void compileSegments();
+	bool compileWithSamples(vector<TrajectoryNode>& samples);
+	void loadBinary(TrajectoryFileView& file);
+	void compileIncrementally(int firstSegment, int lastSegment);
+	void compileSegment(int i);
+	bool getDirtySegments(int& firstSegment, int& lastSegment);
+	static bool isSameNode(const TrajectoryNode& a, const TrajectoryNode& b);
+	milliseconds getCompiledDuration();
+	milliseconds getSampleTime(int slot, milliseconds endTime);
+	void computeSamples(const vector<int>& slots, milliseconds endTime);
+	void computeSampleChunk(const vector<int>& slots, int begin, int end, milliseconds endTime, vector<TrajectoryNode>& samples);
+
 	TrajectoryNode computeNodeByTime(milliseconds time, bool select);
+	void computeInverseKinematics(vector<TrajectoryNode>& samples, const vector<int>& sampleIdx);
 	TrajectoryNode getCurvePoint(int time);
 	bool isCurveAvailable(int time);
 
@@ -76,8 +189,11 @@ private:
 	vector<SpeedProfile> speedProfile; 		// speed profile between support nodes
 
 	vector<TrajectoryNode> compiledCurve; 	// compiled interpolated points including kinematics.
+	vector<TrajectoryNode> compiledNodes; 	// support nodes before the previous compilation, used to detect changes
 
 	int currentTrajectoryNode;
+	int compileThreads;
+	bool compiledIncrementally;				// compiledCurve is the result of compileIncrementally
 };
 
 
@@ -33,6 +33,8 @@ void TrajectoryPlayer::setAngles(const JointAngles& pAngles) {
 }
 
 TrajectoryPlayer::TrajectoryPlayer() {
+	clock = &MonotonicClock::getInstance();
+	lateness.reset();
 	trajectoryPlayerOn  = false;
 	resetTrajectory();
 }
@@ -41,6 +43,11 @@ int TrajectoryPlayer::getSampleRate() {
 	return sampleRate;
 };
 
+void TrajectoryPlayer::setClock(SampleClock* pClock) {
+	clock = pClock;
+	resetTrajectory();
+}
+
 void TrajectoryPlayer::setup(int pSampleRate_ms) {
 	sampleRate = pSampleRate_ms;
 	currNode.pose.angles = Kinematics::getNullPositionAngles();
@@ -58,9 +65,11 @@ void TrajectoryPlayer::setPlayerPosition(int time_ms) {
 
 void TrajectoryPlayer::loop() {
 	if (trajectoryPlayerOn) {
-		milliseconds currentTime = millis()-startTime;
-		if ((currentTime  >= trajectoryPlayerTime_ms+sampleRate)) {
+		microseconds now = clock->now();
+		microseconds deadline = getNextSampleDeadline();
+		if (now >= deadline) {
 			if (!playerStopped) {
+				lateness.add(now - deadline);
 				if (trajectoryPlayerTime_ms > trajectory.getDuration()) {
 					currNode = trajectory.getCompiledNodeByTime(trajectory.getDuration());
 					if (!currNode.isNull())
@@ -82,6 +91,18 @@ void TrajectoryPlayer::loop() {
 	}
 }
 
+microseconds TrajectoryPlayer::getNextSampleDeadline() {
+	if (!trajectoryPlayerOn || playerStopped)
+		return -1;
+	return startTime + (microseconds)(trajectoryPlayerTime_ms + sampleRate)*1000;
+}
+
+void TrajectoryPlayer::waitForNextSample() {
+	microseconds deadline = getNextSampleDeadline();
+	if (deadline >= 0)
+		clock->sleepUntil(deadline);
+}
+
 // start playing of the set trajectory by setting the node that corresponds to the current time
 void TrajectoryPlayer::playTrajectory() {
 	if (trajectory.size() > 1) {
@@ -105,7 +126,7 @@ void TrajectoryPlayer::playTrajectory() {
 		// first node is displayed here, next is done in ::loop
 		trajectoryPlayerTime_ms = (trajectoryPlayerTime_ms/sampleRate)*sampleRate + sampleRate;
 
-		startTime = millis() - trajectoryPlayerTime_ms;
+		startTime = clock->now() - (microseconds)trajectoryPlayerTime_ms*1000;
 		trajectoryPlayerOn = true;
 		singleStepMode = false;
 		playerStopped = false;
@@ -124,7 +145,7 @@ void TrajectoryPlayer::stopTrajectory() {
 void TrajectoryPlayer::resetTrajectory() {
 	trajectoryPlayerOn = false;
 	trajectoryPlayerTime_ms = 0;
-	startTime = millis();
+	startTime = clock->now();
 	singleStepMode = false;
 	// reset selected node to the beginning
 	if (trajectory.size() > 0)
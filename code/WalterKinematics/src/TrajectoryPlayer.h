@@ -13,6 +13,7 @@
 #include "spatial.h"
 #include "Kinematics.h"
 #include "Trajectory.h"
+#include "SampleClock.h"
 
 class TrajectoryPlayer {
 public:
@@ -60,6 +61,18 @@ public:
 	// true if player is running (complete or stepwise)
 	bool isOn() { return trajectoryPlayerOn; }
 
+	// absolute time when loop computes the next sample, -1 if the player is not running
+	microseconds getNextSampleDeadline();
+
+	// sleep until the next sample is due, returns immediately if the player is not running
+	void waitForNextSample();
+
+	// time base of the player, default is the monotonic clock
+	void setClock(SampleClock* pClock);
+
+	// how late samples have been computed compared to their deadline
+	const LatenessHistogram& getLateness() { return lateness; };
+
 	// set player position to a certain point in time
 	void setPlayerPosition(int time_ms);
 
@@ -81,9 +94,11 @@ private:
 	bool trajectoryPlayerOn;
 	bool singleStepMode;
 	bool playerStopped;
-	milliseconds startTime;
+	microseconds startTime;
 	Trajectory trajectory;
 	int sampleRate;
+	SampleClock* clock;
+	LatenessHistogram lateness;
 };
 
 
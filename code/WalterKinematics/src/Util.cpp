@@ -1,5 +1,6 @@
 
 #include <stdlib.h>
+#include <ctype.h>
 #include <chrono>
 #include <unistd.h>
 #include <thread>
@@ -37,7 +38,10 @@ struct HTMLReplace {
   {"'", "&apos;"},
   {"<", "&lt;"},
   {">", "&gt;"},
-  {"\t", "&#9;"}
+  {"\t", "&#9;"},
+  {"\n", "&#10;"},
+  {"\r", "&#13;"},
+  {"\\", "&#92;"}
 };
 
 
@@ -64,17 +68,17 @@ string htmlEncode( const string s )
 string htmlDecode( string s )
 {
   string rs = s;
-  // Replace each matching token in turn
-  for ( size_t i = 0; i < array_length( codes ); i++ ) {
-    // Find the first match
-    const string& match = codes[i].replace;
-    const string& repl = codes[i].match;
-    string::size_type start = rs.find_first_of( match );
+  // Replace each matching token in turn, &amp; last, so that an encoded "&quot;" is not decoded twice
+  for ( size_t i = array_length( codes ); i > 0; i-- ) {
+    // Find the first match (entities are multi-character tokens, so find instead of find_first_of)
+    const string& match = codes[i-1].replace;
+    const string& repl = codes[i-1].match;
+    string::size_type start = rs.find( match );
     // Replace all matches
     while ( start != string::npos ) {
       rs.replace( start, match.size(), repl );
       // Be sure to jump forward by the replacement length
-      start = rs.find_first_of( match, start + repl.size() );
+      start = rs.find( match, start + repl.size() );
     }
   }
   return rs;
@@ -185,10 +189,8 @@ int randomPosNeg() {
 }
 
 milliseconds millis() {
-    auto epoch = std::chrono::high_resolution_clock::from_time_t(0);
-    auto now   = std::chrono::high_resolution_clock::now();
-    auto mseconds = std::chrono::duration_cast<std::chrono::milliseconds>(now - epoch).count();
-    return mseconds;
+	// steady clock does not jump when the system time is set
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
 }
 
 string currentTimeToString()
@@ -417,11 +419,20 @@ vector<std::string> readDirectory(const string & dir, const string& ext) {
 }
 #endif
 
-void eatWhiteSpace(string s, int & idx) {
+// The xxxFromString functions parse in place at position idx of the passed string and move idx
+// behind the parsed token, so parsing an entire document is linear in its size.
+void eatWhiteSpace(const string& s, int & idx) {
 	while ((idx < (int)s.size()) && ((s[idx] == ' ') || (s[idx] == '\n') || (s[idx] == '\r') || (s[idx] == '\t')))
 		idx++;
 }
 
+// returns the position behind "<tag>=" at idx, or -1 if the tag does not match
+static int tagValueIdx(const string& tag, const string& str, int idx) {
+	if ((idx + tag.size() >= str.size()) || (str.compare(idx, tag.size(), tag) != 0) || (str[idx+tag.size()] != '='))
+		return -1;
+	return idx + tag.size() + 1;
+}
+
 
 string endofline(int indent) {
 	string s = "\n";
@@ -438,14 +449,19 @@ string floatToString(const string& tag, double x) {
 }
 
 bool floatFromString (const string& tag, const string& str, double &x, int& idx) {
-	string parseStr = tag + "=%lf %n";
-	int tmpIdx;
 	eatWhiteSpace(str,idx);
-    int noOfItems = sscanf(str.substr(idx).c_str(),parseStr.c_str(), &x, &tmpIdx);
-    bool ok = (noOfItems == 1);
-    if (ok)
-        idx += tmpIdx;
-    return ok;
+	int valueIdx = tagValueIdx(tag, str, idx);
+	if (valueIdx < 0)
+		return false;
+	const char* value = str.c_str() + valueIdx;
+	char* valueEnd;
+	double result = strtod(value, &valueEnd);
+	if (valueEnd == value)
+		return false;
+	x = result;
+	idx = valueIdx + (valueEnd - value);
+	eatWhiteSpace(str,idx);
+	return true;
 }
 
 string intToString(const string& tag, int x) {
@@ -456,16 +472,18 @@ string intToString(const string& tag, int x) {
 }
 
 bool intFromString (const string& tag, const string& str, int &x, int& idx) {
-	string parseStr = tag + "=%i%n";
-	int tmpIdx;
-	string s = str.substr(idx);
 	eatWhiteSpace(str,idx);
-    int noOfItems = sscanf(str.substr(idx).c_str(),parseStr.c_str(), &x, &tmpIdx);
-    bool ok = (noOfItems == 1);
-    if (ok)
-        idx += tmpIdx;
-
-    return ok;
+	int valueIdx = tagValueIdx(tag, str, idx);
+	if (valueIdx < 0)
+		return false;
+	const char* value = str.c_str() + valueIdx;
+	char* valueEnd;
+	long result = strtol(value, &valueEnd, 0); // base 0 like %i
+	if (valueEnd == value)
+		return false;
+	x = result;
+	idx = valueIdx + (valueEnd - value);
+	return true;
 }
 
 string boolToString(const string& tag, bool x) {
@@ -476,18 +494,11 @@ string boolToString(const string& tag, bool x) {
 }
 
 bool boolFromString (const string& tag, const string& str, bool &x, int& idx) {
-	string parseStr = tag + "=%i%n";
-	int tmpIdx;
-	eatWhiteSpace(str,idx);
-	string s = str.substr(idx);
-	int dummyInt;
-    int noOfItems = sscanf(str.substr(idx).c_str(),parseStr.c_str(), &dummyInt, &tmpIdx);
-    x = (dummyInt == 1);
-    bool ok = (noOfItems == 1);
-    if (ok)
-        idx += tmpIdx;
-
-    return ok;
+	int intValue;
+	bool ok = intFromString(tag, str, intValue, idx);
+	if (ok)
+		x = (intValue == 1);
+	return ok;
 }
 
 
@@ -499,16 +510,18 @@ string uint32ToString(const string& tag, uint32_t x) {
 }
 
 bool uint32FromString (const string& tag, const string& str, uint32_t &x, int& idx) {
-	string parseStr = tag + "=%u%n";
-	int tmpIdx;
 	eatWhiteSpace(str,idx);
-	string s = str.substr(idx);
-    int noOfItems = sscanf(str.substr(idx).c_str(),parseStr.c_str(), &x, &tmpIdx);
-    bool ok = (noOfItems == 1);
-    if (ok)
-        idx += tmpIdx;
-
-    return ok;
+	int valueIdx = tagValueIdx(tag, str, idx);
+	if (valueIdx < 0)
+		return false;
+	const char* value = str.c_str() + valueIdx;
+	char* valueEnd;
+	unsigned long result = strtoul(value, &valueEnd, 10);
+	if (valueEnd == value)
+		return false;
+	x = result;
+	idx = valueIdx + (valueEnd - value);
+	return true;
 }
 
 string stringToString(const string& tag, const string& x) {
@@ -521,18 +534,22 @@ string stringToString(const string& tag, const string& x) {
 }
 
 bool stringFromString (const string& tag, const string& str, string &x, int& idx) {
-	string parseStr = tag + "=%s%n";
-	int tmpIdx;
 	eatWhiteSpace(str,idx);
-	string s = str.substr(idx);
-	char buffer[256];
-    int noOfItems = sscanf(str.substr(idx).c_str(),parseStr.c_str(), buffer, &tmpIdx);
-    x = buffer;
-    x = hex_to_string(x);
-    x = x.substr(1);
-    idx += tmpIdx;
-    bool ok = (noOfItems == 1);
-    return ok;
+	int valueIdx = tagValueIdx(tag, str, idx);
+	if (valueIdx < 0)
+		return false;
+	eatWhiteSpace(str,valueIdx);
+
+	// the value is hex encoded and ends with the next whitespace
+	int valueEnd = valueIdx;
+	while ((valueEnd < (int)str.size()) && !isspace((unsigned char)str[valueEnd]))
+		valueEnd++;
+	if (valueEnd == valueIdx)
+		return false;
+	x = hex_to_string(str.substr(valueIdx, valueEnd-valueIdx));
+	x = x.substr(min((size_t)1, x.size()));
+	idx = valueEnd;
+	return true;
 }
 
 string listStartToString(const string& tag, int &indent) {
@@ -549,32 +566,31 @@ string listEndToString(int& indent) {
 	return str.str();
 }
 bool listStartFromString (const string& tag, const string& str, int& idx) {
-	string parseStr = tag + " {%n";
-	int tmpIdx;
 	eatWhiteSpace(str,idx);
-	string s = str.substr(idx);
-    bool ok = false;
-	if (string_starts_with(s,tag)) {
-		int noOfItems = sscanf(str.substr(idx).c_str(),parseStr.c_str(),  &tmpIdx);
-		ok = (noOfItems == 0);
-		if (ok)
-			idx += tmpIdx;
-	}
-    return ok;
+	if ((idx > (int)str.size()) || (str.compare(idx, tag.size(), tag) != 0))
+		return false;
+	int bracketIdx = idx + tag.size();
+	eatWhiteSpace(str,bracketIdx);
+	if ((bracketIdx >= (int)str.size()) || (str[bracketIdx] != '{'))
+		return false;
+	idx = bracketIdx + 1;
+	return true;
 }
 
 bool listEndFromString (const string& str, int& idx) {
-	int tmpIdx;
 	eatWhiteSpace(str,idx);
-	string s = str.substr(idx);
-	bool ok = false;
-	if (string_starts_with(s,"}")) {
-		int noOfItems = sscanf(str.substr(idx).c_str(),"}%n", &tmpIdx);
-		ok = (noOfItems == 0);
-		if (ok)
-			idx += tmpIdx;
+	if ((idx >= (int)str.size()) || (str[idx] != '}'))
+		return false;
+	idx++;
+	return true;
+}
+
+uint32_t hashString(const string& s, uint32_t hash) {
+	for (size_t i = 0;i<s.size();i++) {
+		hash ^= (uint8_t)s[i];
+		hash *= 16777619u;
 	}
-    return ok;
+	return hash;
 }
 
 std::string string_to_hex(const std::string& input)
@@ -88,6 +88,7 @@ string urlDecode(string input);
 string urlEncode(const string &value);
 string htmlDecode(string input);
 string htmlEncode(string input);
+uint32_t hashString(const string& s, uint32_t hash = 2166136261u);	// FNV-1a hash, pass a previous hash to continue hashing
 
 // math helper functions
 #define PI 3.141592653589793238462643383279502884
@@ -275,8 +275,9 @@ string JointAngles::toString(int& indent) const {
 bool JointAngles::fromString(const string& str, int& idx){
 	bool ok = listStartFromString("angles", str, idx);
 
+	static const string tags[7] = { "0", "1", "2", "3", "4", "5", "6" };
 	for (int i = 0;i<7;i++) {
-    	ok = ok && floatFromString(int_to_string(i), str, a[i], idx);
+    	ok = ok && floatFromString(tags[i], str, a[i], idx);
     }
 	ok = ok && listEndFromString(str, idx);
 
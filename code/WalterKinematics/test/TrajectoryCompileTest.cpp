@@ -0,0 +1,148 @@
+/*
+ * TrajectoryCompileTest.cpp
+ *
+ * Edits a compiled trajectory (insert, append and delete a node) and compiles it incrementally.
+ * The result has to match a full compilation of the same nodes: same node times, same number of
+ * samples, recomputed samples are identical, samples taken over from the previous compilation are
+ * within half a sample of their slot.
+ *
+ * Author: JochenAlt
+ */
+
+#include <cstdio>
+#include <vector>
+#include <limits>
+
+#include "setup.h"
+#include "Util.h"
+#include "Kinematics.h"
+#include "Trajectory.h"
+#include "logger.h"
+
+INITIALIZE_EASYLOGGINGPP
+
+using namespace std;
+
+static int failures = 0;
+
+#define EXPECT(condition) \
+	if (!(condition)) { \
+		printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+		failures++; \
+	}
+
+const int NumberOfNodes = 16;
+
+static TrajectoryNode createNode(int i) {
+	TrajectoryNode node;
+	JointAngles angles = JointAngles::getDefaultPosition();
+	angles[HIP] = radians(-60 + 8*i);
+	angles[UPPERARM] = radians(20 + 3*(i % 3));
+	angles[FOREARM] = radians(-30 + 4*(i % 2));
+	angles[WRIST] = radians(30);
+	node.pose.angles = angles;
+	// angles as inverse kinematics computes them, so compilation does not modify the nodes
+	Kinematics::getInstance().computeForwardKinematics(node.pose);
+	Kinematics::getInstance().computeInverseKinematics(node.pose);
+	node.interpolationTypeDef = (i % 2)?POSE_CUBIC_BEZIER:POSE_LINEAR;
+	node.averageSpeedDef = 0.1;
+	node.continouslyDef = true;
+	return node;
+}
+
+static Trajectory createTrajectory() {
+	Trajectory trajectory;
+	trajectory.setCompileThreads(1);
+	for (int i = 0;i<NumberOfNodes;i++)
+		trajectory.getSupportNodes().push_back(createNode(i));
+	trajectory.compile(false);
+	return trajectory;
+}
+
+// compile incrementally and compare with a full compilation of a copy
+static void compareWithFullCompilation(Trajectory& trajectory) {
+	Trajectory full(trajectory);
+	full.compile(false);
+	trajectory.compile(true);
+	EXPECT(trajectory.isCompiledIncrementally());
+
+	EXPECT(trajectory.size() == full.size());
+	EXPECT(trajectory.getDuration() == full.getDuration());
+	for (int i = 0;(i<trajectory.size()) && (i<full.size());i++) {
+		EXPECT(trajectory.get(i).time == full.get(i).time);
+		EXPECT(trajectory.get(i).duration == full.get(i).duration);
+	}
+
+	// a taken over sample has been computed at the old time of its point on the curve, so it lies between
+	// the neighbours of the full compilation's sample of its slot
+	int lastSlot = full.getDuration()/UITrajectorySampleRate;
+	int takenOver = 0;
+	for (int slot = 0;slot <= lastSlot;slot++) {
+		TrajectoryNode sample = trajectory.getCompiledNodeByTime(slot*UITrajectorySampleRate);
+		TrajectoryNode expected = full.getCompiledNodeByTime(slot*UITrajectorySampleRate);
+		EXPECT(!sample.isNull());
+		if (sample.time == expected.time) {
+			EXPECT(sample.pose.position.distance(expected.pose.position) < floatPrecision);
+		} else {
+			takenOver++;
+			EXPECT(abs(sample.time - expected.time) <= UITrajectorySampleRate/2);
+			TrajectoryNode before = full.getCompiledNodeByTime(max(slot-1, 0)*UITrajectorySampleRate);
+			TrajectoryNode after = full.getCompiledNodeByTime(min(slot+1, lastSlot)*UITrajectorySampleRate);
+			float tolerance = max(before.pose.position.distance(expected.pose.position),
+								  after.pose.position.distance(expected.pose.position));
+			EXPECT(sample.pose.position.distance(expected.pose.position) <= tolerance + floatPrecision);
+		}
+	}
+	EXPECT(takenOver < lastSlot);
+}
+
+static void testInsert() {
+	Trajectory trajectory = createTrajectory();
+	vector<TrajectoryNode>& nodes = trajectory.getSupportNodes();
+	TrajectoryNode node = createNode(3);
+	node.pose.position.z += 20;
+	Kinematics::getInstance().computeInverseKinematics(node.pose);
+	nodes.insert(nodes.begin()+3, node);
+	compareWithFullCompilation(trajectory);
+}
+
+static void testAppend() {
+	// the dirty range reaches the new last node, which has not been compiled before and has any time
+	Trajectory trajectory = createTrajectory();
+	TrajectoryNode node = createNode(NumberOfNodes);
+	node.time = numeric_limits<milliseconds>::min();
+	trajectory.getSupportNodes().push_back(node);
+	compareWithFullCompilation(trajectory);
+}
+
+static void testDelete() {
+	Trajectory trajectory = createTrajectory();
+	vector<TrajectoryNode>& nodes = trajectory.getSupportNodes();
+	nodes.erase(nodes.begin()+4);
+	compareWithFullCompilation(trajectory);
+
+	// last node
+	nodes.pop_back();
+	compareWithFullCompilation(trajectory);
+}
+
+int main() {
+	// no logging, kinematics logs every pose without solution
+	el::Configurations conf;
+	conf.setToDefault();
+	conf.setGlobally(el::ConfigurationType::Enabled, "false");
+	el::Loggers::reconfigureAllLoggers(conf);
+
+	Kinematics::getInstance().setup();
+
+	testInsert();
+	testAppend();
+	testDelete();
+
+	if (failures > 0) {
+		printf("TrajectoryCompileTest: %d checks failed\n", failures);
+		return 1;
+	}
+	printf("TrajectoryCompileTest: ok\n");
+	return 0;
+}
@@ -0,0 +1,164 @@
+/*
+ * TrajectoryPlayerTest.cpp
+ *
+ * Plays a trajectory on a VirtualClock. Checks that samples are due at absolute deadlines
+ * that do not drift when samples are computed late, that every sample shows the trajectory
+ * at its point in time, and that the lateness ends up in the right LatenessHistogram bucket.
+ *
+ * Author: JochenAlt
+ */
+
+#include <cstdio>
+#include <vector>
+
+#include "setup.h"
+#include "Util.h"
+#include "Kinematics.h"
+#include "Trajectory.h"
+#include "TrajectoryPlayer.h"
+#include "SampleClock.h"
+#include "logger.h"
+
+INITIALIZE_EASYLOGGINGPP
+
+using namespace std;
+
+static int failures = 0;
+
+#define EXPECT(condition) \
+	if (!(condition)) { \
+		printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+		failures++; \
+	}
+
+const int SampleRate_ms = 10;
+
+// remembers each computed pose together with the time of the virtual clock
+class RecordingPlayer : public TrajectoryPlayer {
+public:
+	RecordingPlayer(SampleClock& pClock) : clock(pClock) {};
+	void notifyNewPose(const Pose& pose) {
+		poses.push_back(pose);
+		times.push_back(clock.now());
+	}
+	SampleClock& clock;
+	vector<Pose> poses;
+	vector<microseconds> times;
+};
+
+static Trajectory createTrajectory() {
+	Trajectory trajectory;
+	JointAngles angles = JointAngles::getDefaultPosition();
+	angles[UPPERARM] = radians(20);
+	angles[FOREARM] = radians(-30);
+	angles[WRIST] = radians(30);
+	for (int i = 0;i<3;i++) {
+		TrajectoryNode node;
+		angles[HIP] = radians(10*i);
+		node.pose.angles = angles;
+		Kinematics::getInstance().computeForwardKinematics(node.pose);
+		node.interpolationTypeDef = POSE_LINEAR;
+		node.averageSpeedDef = 0.1;
+		node.continouslyDef = true;
+		trajectory.getSupportNodes().push_back(node);
+	}
+	trajectory.compile();
+	return trajectory;
+}
+
+static void testHistogram() {
+	LatenessHistogram h;
+	h.reset();
+	microseconds lateness[] = { 0, 49, 50, 99, 100, 9999, 10000, 20000 };
+	int bucket[] = { 0, 0, 1, 1, 2, 7, 8, 8 };
+	for (int i = 0;i<8;i++) {
+		LatenessHistogram single;
+		single.reset();
+		single.add(lateness[i]);
+		EXPECT(single.samples[bucket[i]] == 1);
+		h.add(lateness[i]);
+	}
+	EXPECT(h.samples[0] == 2);
+	EXPECT(h.samples[8] == 2);
+	EXPECT(h.max_us == 20000);
+}
+
+static void testPlayer() {
+	VirtualClock clock;
+	clock.advance(1000000);
+	RecordingPlayer player(clock);
+	player.setClock(&clock);
+	player.setup(SampleRate_ms);
+	player.getTrajectory() = createTrajectory();
+	int duration_ms = player.getTrajectory().getDuration();
+	EXPECT(duration_ms > 10*SampleRate_ms);
+
+	EXPECT(player.getNextSampleDeadline() == -1);
+	microseconds playTime = clock.now();
+	player.playTrajectory();
+	EXPECT(player.isOn());
+	EXPECT(player.poses.size() == 1); // start pose is set right away
+
+	// compute each sample somewhat late, in a pattern that covers several buckets. The deadlines
+	// stay multiples of the sample rate, lateness does not shift them
+	const microseconds latePattern[] = { 0, 75, 300, 3000, 7000 };
+	const int lateBucket[] = { 0, 1, 3, 6, 7 };
+	long expectedSamples[LatenessHistogram::NumberOfBuckets] = { 0 };
+	int sample = 0;
+	while (player.isOn() && (sample < 10000)) {
+		sample++;
+		microseconds deadline = player.getNextSampleDeadline();
+		EXPECT(deadline == playTime + (microseconds)sample*SampleRate_ms*1000);
+
+		// nothing is computed before the deadline
+		player.loop();
+		EXPECT(player.poses.size() == (size_t)sample);
+
+		player.waitForNextSample();
+		EXPECT(clock.now() == deadline);
+		clock.advance(latePattern[sample % 5]);
+		player.loop();
+		expectedSamples[lateBucket[sample % 5]]++;
+
+		EXPECT(player.poses.size() == (size_t)sample+1);
+		EXPECT(player.times.back() == deadline + latePattern[sample % 5]);
+
+		// sample shows the trajectory at sample*SampleRate_ms, the last one shows its end
+		int time_ms = min(sample*SampleRate_ms, duration_ms);
+		TrajectoryNode node = player.getTrajectory().getCompiledNodeByTime(time_ms);
+		EXPECT(player.poses.back().position == node.pose.position);
+	}
+
+	EXPECT(!player.isOn());
+	EXPECT(player.getNextSampleDeadline() == -1);
+	EXPECT(sample == duration_ms/SampleRate_ms + 1); // the last sample passes the end and shows the last node
+
+	const LatenessHistogram& lateness = player.getLateness();
+	long total = 0;
+	for (int i = 0;i<LatenessHistogram::NumberOfBuckets;i++) {
+		EXPECT(lateness.samples[i] == expectedSamples[i]);
+		total += lateness.samples[i];
+	}
+	EXPECT(total == sample);
+	EXPECT(lateness.max_us == 7000);
+}
+
+int main() {
+	// no logging, kinematics logs every pose without solution
+	el::Configurations conf;
+	conf.setToDefault();
+	conf.setGlobally(el::ConfigurationType::Enabled, "false");
+	el::Loggers::reconfigureAllLoggers(conf);
+
+	Kinematics::getInstance().setup();
+
+	testHistogram();
+	testPlayer();
+
+	if (failures > 0) {
+		printf("TrajectoryPlayerTest: %d checks failed\n", failures);
+		return 1;
+	}
+	printf("TrajectoryPlayerTest: ok\n");
+	return 0;
+}
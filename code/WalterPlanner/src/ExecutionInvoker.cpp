@@ -9,6 +9,7 @@
 #include "Poco/Net/HTTPClientSession.h"
 #include "Poco/Net/HTTPRequest.h"
 #include "Poco/Net/HTTPResponse.h"
+#include "Poco/Net/WebSocket.h"
 #include <Poco/Net/HTTPCredentials.h>
 #include "Poco/StreamCopier.h"
 #include "Poco/NullStream.h"
@@ -31,89 +32,130 @@ using namespace Net;
 using namespace std;
 
 
-bool ExecutionInvoker::httpGET(string path, string &responsestr, int timeout_ms) {
-	std::ostringstream address;
-	address << "http://" << host << ":" << port;
-	if (path.find("/") != 0)
-		address << "/";
-	address << path;
-
-	LOG(DEBUG) << "calling " << address.str();
-
-	URI uri(address.str());
-    std::string pathandquery(uri.getPathAndQuery());
-    if (pathandquery.empty())
-    	pathandquery = "/";
-
-    HTTPClientSession session(uri.getHost(), uri.getPort());
-    HTTPRequest request(HTTPRequest::HTTP_GET, pathandquery, HTTPMessage::HTTP_1_1);
-    HTTPResponse response;
-
-    session.setTimeout(Timespan(timeout_ms/1000,timeout_ms%1000)); // = 3s 0ms
-    try {
-    	session.sendRequest(request);
-    	std::istream& rs = session.receiveResponse(response);
-        string line;
-        responsestr = "";
-        while(std::getline(rs, line))
-        	responsestr += line + "\r\n";
-
-    	return (response.getStatus() == HTTPResponse::HTTP_OK);
-    }
-    catch (Poco::TimeoutException ex) {
-    	setError(WEBSERVER_TIMEOUT);
-    	LOG(DEBUG) << "request timeout " << ex.name();
-    	std::ostringstream s;
-    	s << "NOK(" << WEBSERVER_TIMEOUT << ") " << getLastErrorMessage();
-    	responsestr = s.str();
-    	return false;
-    }
-}
-
-
-bool ExecutionInvoker::httpPOST(string path, string body, string &responsestr, int timeout_ms) {
-	std::ostringstream address;
-	address << "http://" << host << ":" << port;
+bool ExecutionInvoker::httpGET(Connection& connection, string path, string &responsestr, int timeout_ms) {
+	return httpRequest(connection, HTTPRequest::HTTP_GET, path, "", responsestr, timeout_ms);
+}
+
+bool ExecutionInvoker::httpPOST(Connection& connection, string path, string body, string &responsestr, int timeout_ms) {
+	return httpRequest(connection, HTTPRequest::HTTP_POST, path, body, responsestr, timeout_ms);
+}
+
+bool ExecutionInvoker::httpRequest(Connection& connection, const string& method, string path, const string& body, string &responsestr, int timeout_ms) {
 	if (path.find("/") != 0)
-		address << "/";
-	address << path;
-
-	URI uri(address.str());
-    std::string pathandquery(uri.getPathAndQuery());
-    if (pathandquery.empty())
-    	pathandquery = "/";
-
-    HTTPClientSession session(uri.getHost(), uri.getPort());
-    HTTPRequest request(HTTPRequest::HTTP_POST, pathandquery, HTTPMessage::HTTP_1_1);
-    request.setContentType("application/x-www-form-urlencoded");
-    request.setKeepAlive(true); // notice setKeepAlive is also called on session (above)
-    request.add("Content-Length", int_to_string((int)body.size()));
-
-    HTTPResponse response;
-
-    session.setTimeout(Timespan(timeout_ms/1000,timeout_ms%1000)); // = 3s 0ms
-    try {
-    	std::ostream& bodyOStream = session.sendRequest(request);
-    	bodyOStream << body;  // sends the body
-   	    std::istream& rs = session.receiveResponse(response);
-
-    	string line;
-    	responsestr = "";
-    	while(std::getline(rs, line))
-    		responsestr += line + "\r\n";
-
-    	return (response.getStatus() == HTTPResponse::HTTP_OK);
-    }
-    catch (Poco::TimeoutException ex) {
-      	setError(WEBSERVER_TIMEOUT);
-      	LOG(DEBUG) << "request timeout " << ex.name();
-      	std::ostringstream s;
-      	s << "NOK(" << WEBSERVER_TIMEOUT << ") " << getLastErrorMessage();
-      	responsestr = s.str();
-      	return false;
-     }
+		path = "/" + path;
+
+	LOG(DEBUG) << "calling " << method << " " << path;
+
+	// the UI connection is used by the UI thread and the console
+	std::lock_guard<std::mutex> lock(connection.mutex);
+	HTTPClientSession*& session = connection.session;
+
+	// the webserver might have closed the kept alive connection meanwhile, then reconnect once. That is done only
+	// if the request has not been sent yet, otherwise the webserver might have executed it already
+	for (int attempt = 0;attempt < 2;attempt++) {
+		if (session == NULL) {
+			session = new HTTPClientSession(host, port);
+			session->setKeepAlive(true);
+		}
+		session->setTimeout(Timespan(timeout_ms/1000,(timeout_ms%1000)*1000));
+
+		HTTPRequest request(method, path, HTTPMessage::HTTP_1_1);
+		request.setKeepAlive(true);
+		if (method == HTTPRequest::HTTP_POST) {
+			request.setContentType("application/x-www-form-urlencoded");
+			request.setContentLength(body.size());
+		}
+		HTTPResponse response;
+		bool requestSent = false;
+		try {
+			std::ostream& bodyOStream = session->sendRequest(request);
+			bodyOStream << body;  // sends the body, if any
+			bodyOStream.flush();
+			if (!bodyOStream.good())
+				throw Poco::IOException("request could not be sent");
+			requestSent = true;
+			std::istream& rs = session->receiveResponse(response);
+
+			// read the complete response, otherwise the connection cannot be used for the next request
+			string line;
+			responsestr = "";
+			while(std::getline(rs, line))
+				responsestr += line + "\r\n";
+
+			return (response.getStatus() == HTTPResponse::HTTP_OK);
+		}
+		catch (Poco::TimeoutException& ex) {
+			// state of the connection is unknown, start with a new one next time
+			delete session;
+			session = NULL;
+			setError(WEBSERVER_TIMEOUT);
+			LOG(DEBUG) << "request timeout " << ex.name();
+			std::ostringstream s;
+			s << "NOK(" << WEBSERVER_TIMEOUT << ") " << getLastErrorMessage();
+			responsestr = s.str();
+			return false;
+		}
+		catch (Poco::Exception& ex) {
+			delete session;
+			session = NULL;
+			if (requestSent) {
+				LOG(DEBUG) << "connection to webserver lost after sending " << path << " (" << ex.displayText() << ")";
+				break;
+			}
+			LOG(DEBUG) << "connection to webserver lost (" << ex.displayText() << "), reconnecting";
+		}
+	}
+
+	setError(WEBSERVER_CONNECTION_FAILED);
+	std::ostringstream s;
+	s << "NOK(" << WEBSERVER_CONNECTION_FAILED << ") " << getLastErrorMessage();
+	responsestr = s.str();
+	return false;
+}
+
+void ExecutionInvoker::startWorker() {
+	std::lock_guard<std::mutex> lock(mailboxMutex);
+	if (workerThread == NULL)
+		workerThread = new std::thread(&ExecutionInvoker::workerLoop, this);
 }
 
+void ExecutionInvoker::workerLoop() {
+	while (true) {
+		JointAngles angles;
+		bool sendAngles, fetchNode;
+		{
+			std::unique_lock<std::mutex> lock(mailboxMutex);
+			mailboxPending.wait(lock, [this]{ return anglesPending || fetchNodePending; });
+			angles = pendingAngles;
+			sendAngles = anglesPending;
+			fetchNode = fetchNodePending;
+			anglesPending = false;
+			fetchNodePending = false;
+		}
+
+		if (sendAngles) {
+			string response;
+			int indent = 0;
+			std::ostringstream request;
+			request << "/executor/setangles?param=" << urlEncode(angles.toString(indent));
+			bool ok = httpGET(workerConnection, request.str(), response, 200);
+			std::lock_guard<std::mutex> lock(mailboxMutex);
+			lastSetAnglesOk = (ok && (response.find("OK") == 0));
+		}
+
+		if (fetchNode) {
+			string response;
+			if (httpGET(workerConnection, "/executor/getangles", response, 200)) {
+				TrajectoryNode node;
+				int idx = 0;
+				if (node.fromString(response, idx)) {
+					std::lock_guard<std::mutex> lock(mailboxMutex);
+					fetchedNode = node;
+				}
+			}
+		}
+	}
+}
 
 void ExecutionInvoker::setHost(string pHost, int pPort) {
 	host = pHost;
@@ -122,6 +164,15 @@ void ExecutionInvoker::setHost(string pHost, int pPort) {
 
 ExecutionInvoker::ExecutionInvoker() {
 	Poco::Net::initializeNetwork();
+	precompiledUpload = true;
+	streamThread = NULL;
+	streamAlive = false;
+	uiConnection.session = NULL;
+	workerConnection.session = NULL;
+	workerThread = NULL;
+	anglesPending = false;
+	lastSetAnglesOk = true;
+	fetchNodePending = false;
 }
 
 ExecutionInvoker& ExecutionInvoker::getInstance() {
@@ -130,66 +181,133 @@ ExecutionInvoker& ExecutionInvoker::getInstance() {
 
 bool ExecutionInvoker::startupBot() {
 	string response;
-	bool ok = httpGET("/executor/startupbot", response,10000);
+	bool ok = httpGET(uiConnection, "/executor/startupbot", response,10000);
 	// no response expected
 	return ok;
 }
 
 bool ExecutionInvoker::teardownBot() {
 	string response;
-	bool ok = httpGET("/executor/teardownbot", response,50000);
+	bool ok = httpGET(uiConnection, "/executor/teardownbot", response,50000);
 	// no response expected
 	return ok;
 }
 
 bool ExecutionInvoker::isBotUpAndRunning() {
 	string response;
-	bool ok = httpGET("/executor/isupandrunning", response,500);
+	bool ok = httpGET(uiConnection, "/executor/isupandrunning", response,500);
 	return (ok && (response.find("true") == 0));
 }
 
 bool ExecutionInvoker::setAngles(JointAngles angles) {
-	string response;
-	int indent = 0;
-	string anglesAsString = angles.toString(indent);
-	std::ostringstream request;
-	request << "/executor/setangles?param=" << urlEncode(anglesAsString);
-	bool ok = httpGET(request.str(), response,200);
-	return (ok && (response.find("OK") == 0));
+	startWorker();
+	std::lock_guard<std::mutex> lock(mailboxMutex);
+	pendingAngles = angles;
+	anglesPending = true;
+	mailboxPending.notify_one();
+	return lastSetAnglesOk;
+}
+
+void ExecutionInvoker::streamLoop() {
+	while (true) {
+		try {
+			HTTPClientSession session(host, port);
+			HTTPRequest request(HTTPRequest::HTTP_GET, "/stream?topics=node", HTTPMessage::HTTP_1_1);
+			HTTPResponse response;
+			WebSocket ws(session, request, response);
+			ws.setReceiveTimeout(Timespan(1,0));
+
+			const int BufferSize = 16384;
+			char buffer[BufferSize];
+			int flags = 0;
+			int n = 1;
+			do {
+				// the node is pushed only when it changed, so a timeout just means that the bot does not move
+				try {
+					n = ws.receiveFrame(buffer, BufferSize, flags);
+				} catch (Poco::TimeoutException& ex) {
+					continue;
+				}
+				string update(buffer, n);
+
+				// update is {"node":"<html encoded node>"}
+				string key = "\"node\":\"";
+				int start = update.find(key);
+				if (start >= 0) {
+					start += key.length();
+					int end = update.find("\"", start);
+					string nodeStr = htmlDecode(update.substr(start, end-start));
+					TrajectoryNode node;
+					int idx = 0;
+					if (node.fromString(nodeStr, idx)) {
+						std::lock_guard<std::mutex> lock(streamMutex);
+						streamedNode = node;
+						streamAlive = true;
+					}
+				}
+			} while ((n > 0) && ((flags & WebSocket::FRAME_OP_BITMASK) != WebSocket::FRAME_OP_CLOSE));
+		}
+		catch (Poco::Exception& ex) {
+			LOG(DEBUG) << "stream from webserver interrupted " << ex.displayText();
+		}
+		// retry later, meanwhile getAngles falls back to http
+		{
+			std::lock_guard<std::mutex> lock(streamMutex);
+			streamAlive = false;
+		}
+		delay(1000);
+	}
 }
 
 TrajectoryNode ExecutionInvoker::getAngles() {
-	TrajectoryNode node;
-	string response;
-	bool okHttp = httpGET("/executor/getangles", response,200);
-	if (okHttp) {
-		int idx = 0;
-		bool ok = node.fromString(response, idx);
-		if (!ok)
-			node.null();
+	if (streamThread == NULL)
+		streamThread = new std::thread(&ExecutionInvoker::streamLoop, this);
+
+	// the webserver pushes the node whenever it changes, so the latest one is current as long as the stream is alive
+	{
+		std::lock_guard<std::mutex> lock(streamMutex);
+		if (streamAlive)
+			return streamedNode;
 	}
-	return node;
+
+	// otherwise let the worker poll it, meanwhile return what it fetched last time
+	startWorker();
+	std::lock_guard<std::mutex> lock(mailboxMutex);
+	fetchNodePending = true;
+	mailboxPending.notify_one();
+	return fetchedNode;
 }
 
-bool ExecutionInvoker::runTrajectory(Trajectory traj) {
+bool ExecutionInvoker::runTrajectory(const Trajectory& traj) {
+	// samples of an incremental compilation are off by up to one sample, upload a full compilation
+	const Trajectory* uploaded = &traj;
+	Trajectory fullyCompiled;
+	if (precompiledUpload && traj.isCompiledIncrementally()) {
+		fullyCompiled = traj;
+		fullyCompiled.compile(false);
+		uploaded = &fullyCompiled;
+	}
+
 	int indent = 0;
-	string trajectoryStr = traj.toString(indent);
+	string trajectoryStr = uploaded->toString(indent);
+	if (precompiledUpload)
+		trajectoryStr += uploaded->samplesToString(Trajectory::getCompilationHash(trajectoryStr), indent);
 	string response;
 	string bodyMessage = urlEncode(trajectoryStr);
-	bool ok = httpPOST("/executor/settrajectory", bodyMessage, response, 5000);
+	bool ok = httpPOST(uiConnection, "/executor/settrajectory", bodyMessage, response, 5000);
 	return (ok && (response.find("OK") == 0));
 }
 
 bool ExecutionInvoker::stopTrajectory() {
 	string response;
-	bool ok = httpGET("/executor/stoptrajectory", response, 1000);
+	bool ok = httpGET(uiConnection, "/executor/stoptrajectory", response, 1000);
 	return (ok && (response.find("OK") == 0));
 }
 
 string ExecutionInvoker::directAccess(string directCommand,string &response) {
 	std::ostringstream request;
 	request << "/direct/cmd?param=" << urlEncode(directCommand);
-	httpGET(request.str(), response, 3000);
+	httpGET(uiConnection, request.str(), response, 3000);
 	return response;
 }
 
@@ -10,9 +10,14 @@
 #define EXECUTIONINVOKER_H_
 
 #include <string.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #include "spatial.h"
 #include "Trajectory.h"
 
+namespace Poco { namespace Net { class HTTPClientSession; } }
+
 using namespace std;
 
 
@@ -27,12 +32,16 @@ public:
 	bool teardownBot();
 	// true if bot is up and running
 	bool isBotUpAndRunning();
-	// send passed angles to webserver
+	// send passed angles to webserver. Does not wait, angles are sent by the worker thread, a newer
+	// call overrides angles that have not been sent yet. Returns the result of the last completed call
 	bool setAngles(JointAngles angles);
-	// fetch current angles of bot
+	// fetch current angles of bot. Taken from the /stream websocket if it is alive, otherwise
+	// the worker thread fetches them via http. Does not wait, returns the latest node received
 	TrajectoryNode getAngles();
 	// pass a full trajectory to webserver. Start it immediately.
-	bool runTrajectory(Trajectory traj);
+	bool runTrajectory(const Trajectory& traj);
+	// if set, runTrajectory sends the compiled samples too, so the webserver does not need to compile
+	void setPrecompiledUpload(bool on) { precompiledUpload = on; };
 	// stop currently running trajectory
 	bool stopTrajectory();
 	// pass a direct command to webserver
@@ -40,11 +49,43 @@ public:
 	// define url of webserver
 	void setHost(string host, int port);
 private:
-	bool httpGET(string path, string &responsestr, int timeout_ms);
-	bool httpPOST(string path, string body, string &responsestr, int timeout_ms);
+	// kept alive connection to the webserver, reconnected if the webserver closed it. The worker has its own,
+	// so sending angles does not wait behind a long request of the UI and vice versa
+	struct Connection {
+		Poco::Net::HTTPClientSession* session;
+		std::mutex mutex;
+	};
+
+	bool httpGET(Connection& connection, string path, string &responsestr, int timeout_ms);
+	bool httpPOST(Connection& connection, string path, string body, string &responsestr, int timeout_ms);
+	bool httpRequest(Connection& connection, const string& method, string path, const string& body, string &responsestr, int timeout_ms);
+	// sends angles and fetches nodes posted to the mailbox
+	void workerLoop();
+	void startWorker();
+	// receives the bot's current node pushed by the webserver
+	void streamLoop();
+
+	std::thread* streamThread;
+	std::mutex streamMutex;
+	TrajectoryNode streamedNode;
+	bool streamAlive;				// connected and the initial node has been received
+
+	Connection uiConnection;
+	Connection workerConnection;
+
+	// mailbox of the worker, latest value wins
+	std::thread* workerThread;
+	std::mutex mailboxMutex;
+	std::condition_variable mailboxPending;
+	JointAngles pendingAngles;
+	bool anglesPending;
+	bool lastSetAnglesOk;
+	bool fetchNodePending;
+	TrajectoryNode fetchedNode;
 
 	std::string host;
 	int port;
+	bool precompiledUpload;
 };
 
 #endif /* EXECUTIONINVOKER_H_ */
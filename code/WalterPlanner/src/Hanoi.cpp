@@ -1,6 +1,5 @@
 #include "Hanoi.h"
 #include "logger.h"
-#include "TrajectorySimulation.h"
 
 #include <iostream>
 using namespace std;
@@ -49,6 +48,8 @@ HanoiTrajectory::HanoiTrajectory() {
 		pegsBase[0] = Point(250, -pegDistance,gameBaseHeight);
 		pegsBase[1] = Point(250, 0,gameBaseHeight);
 		pegsBase[2] = Point(250, pegDistance,gameBaseHeight);
+
+		player = NULL;
 };
 
 void HanoiTrajectory::init(int numberOfDisks) {
@@ -69,12 +70,12 @@ void HanoiTrajectory::init(int numberOfDisks) {
 }
 
 void HanoiTrajectory::addPose(Pose &pose, InterpolationType interpolationType, rational duration) {
-	vector<TrajectoryNode>& trajectory = TrajectorySimulation::getInstance().getTrajectory().getSupportNodes();
+	vector<TrajectoryNode>& trajectory = player->getTrajectory().getSupportNodes();
 
 	// this sets the pose, does inverse kinematics but does not return the angles
-	TrajectorySimulation::getInstance().setPose(pose);
+	player->setPose(pose);
 	// so fetch the angles explicitely
-	pose.angles = TrajectorySimulation::getInstance().getCurrentAngles();
+	pose.angles = player->getCurrentAngles();
 
 	TrajectoryNode node;
 	node.pose = pose;
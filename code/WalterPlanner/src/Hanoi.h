@@ -8,6 +8,7 @@
 #define HANOI_H_
 
 #include "spatial.h"
+#include "TrajectoryPlayer.h"
 
 class Hanoi {
 public:
@@ -32,6 +33,9 @@ class HanoiTrajectory : public Hanoi {
 public:
 	HanoiTrajectory();
 
+	// set the player whose trajectory receives the poses. Poses are set via the player to obtain the angles.
+	void setPlayer(TrajectoryPlayer& pPlayer) { player = &pPlayer; };
+
 	virtual void init(int numberOfDisks);
 	virtual void move(int fromPegNumber, int toPegNumber);
 
@@ -58,6 +62,8 @@ public:
 
 	Point pegsBase[3];
 
+private:
+	TrajectoryPlayer* player;
 };
 
 extern HanoiTrajectory hanoi;
@@ -79,7 +79,7 @@ void TrajectorySimulation::loop() {
 		if (retrieveFromRealBotFlag) {
 			TrajectoryNode currentNode = ExecutionInvoker::getInstance().getAngles();
 			if (currentNode.isNull())
-				LOG(ERROR) << "parse error node";
+				LOG(DEBUG) << "no node received from bot yet";
 			else {
 				// set pose of bot to current node and send to UI
 				TrajectorySimulation::getInstance().setAngles(currentNode.pose.angles);
@@ -43,6 +43,7 @@ const int DownButtonID 		= 4;
 const int LoadButtonID 		= 5;
 const int SaveButtonID 		= 6;
 const int MergeButtonID 	= 7;
+const int SaveTextButtonID 	= 8;
 
 const int SimulateButtonID 		= 11;
 const int StopButtonID 		= 13;
@@ -311,7 +312,8 @@ void trajectoryButtonCallback(int controlNo) {
 				}
 			}
 			break;
-		case SaveButtonID: {
+		case SaveButtonID:
+		case SaveTextButtonID: {
 			// find a free filename
 			vector<TrajectoryNode>& trajectory = TrajectorySimulation::getInstance().getTrajectory().getSupportNodes();
 			if (trajectory.size() >=2) {
@@ -330,7 +332,12 @@ void trajectoryButtonCallback(int controlNo) {
 					i++;
 				}
 				// remove invalid characters
-				TrajectorySimulation::getInstance().getTrajectory().save(filename + ".trj");
+				// binary with the compiled samples, so loading does not need to compile again. Text is readable and editable,
+				// load takes both
+				if (controlNo == SaveButtonID)
+					TrajectorySimulation::getInstance().getTrajectory().saveBinary(filename + ".trj", true);
+				else
+					TrajectorySimulation::getInstance().getTrajectory().save(filename + ".trj");
 				fillfileSelectorList();
 			}
 			break;
@@ -372,6 +379,7 @@ void trajectoryButtonCallback(int controlNo) {
 			break;
 		}
 		case CreateHanoiButtonID: {
+			hanoi.setPlayer(TrajectorySimulation::getInstance());
 			hanoi.solve(3);
 			TrajectorySimulation::getInstance().getTrajectory().compile();
 			TrajectoryView::getInstance().fillTrajectoryListControl();
@@ -522,6 +530,10 @@ void TrajectoryView::create(GLUI *windowHandle, GLUI_Panel* pInteractivePanel) {
 	button->set_alignment(GLUI_ALIGN_CENTER);
 	button->set_w(70);
 
+	button = new GLUI_Button( trajectoryMgrButtonPanel, "Save Text" ,SaveTextButtonID,trajectoryButtonCallback );
+	button->set_alignment(GLUI_ALIGN_CENTER);
+	button->set_w(70);
+
 	button = new GLUI_Button( trajectoryMgrButtonPanel, "Load",LoadButtonID,trajectoryButtonCallback  );
 	button->set_alignment(GLUI_ALIGN_CENTER);
 	button->set_w(70);
@@ -13,42 +13,42 @@
 
 CommandDispatcher commandDispatcher;
 
-
-bool getURLParameter(vector<string> names, vector<string> values, string key, string &value) {
-	for (int i = 0;i<(int)names.size();i++) {
-		if (names[i].compare(key) == 0) {
-			value = values[i];
-			return true;
-		}
-	}
-	return false;
-}
-
-
-void compileURLParameter(string uri, vector<string> &names, vector<string> &values) {
-	names.clear();
-	values.clear();
-
-	std::istringstream iss(uri);
-	std::string token;
-	while (std::getline(iss, token, '&'))
-	{
-		// extract name and value of parameter
-		int equalsIdx = token.find("=");
-		if (equalsIdx > 0) {
-			string name = token.substr(0,equalsIdx);
-			string value = token.substr(equalsIdx+1);
-			names.insert(names.end(), name);
-			values.insert(values.end(), urlDecode(value));
-		};
+using namespace std::placeholders;
+
+// OK or NOK with the last error, used as response of all commands passed to the motion thread
+static string okOrNOkResponse(bool ok) {
+	std::ostringstream s;
+	if (ok) {
+		s << "OK";
+	} else {
+		s << "NOK(" << getLastError() << ") " << getErrorMessage(getLastError());
 	}
+	return s.str();
 }
 
 CommandDispatcher::CommandDispatcher() {
-	logLineCounter = 0;
-	cmdLineCounter = 0;
 	addCmdLine("<no command>");
 	addLogLine("start logging");
+
+	// example: /cortex/LED?blink
+	router.addPrefix("/cortex", std::bind(&CommandDispatcher::cortexRoute, this, _1, _2));
+	// example: /direct?param=LED+blink
+	router.addPrefix("/direct", std::bind(&CommandDispatcher::directRoute, this, _1, _2));
+	// polling of the web page, example: /web?key=cortexlog&from=12
+	router.addExact("/web", std::bind(&CommandDispatcher::webRoute, this, _1, _2));
+
+	// orchestrated calls of TrajectoryExecution
+	router.addExact("/executor/startupbot", std::bind(&CommandDispatcher::motionRoute, this, MotionCommand::STARTUP_BOT, _1, _2));
+	router.addExact("/executor/teardownbot", std::bind(&CommandDispatcher::motionRoute, this, MotionCommand::TEARDOWN_BOT, _1, _2));
+	router.addExact("/executor/nullpositionbot", std::bind(&CommandDispatcher::motionRoute, this, MotionCommand::NULL_POSITION_BOT, _1, _2));
+	router.addExact("/executor/stoptrajectory", std::bind(&CommandDispatcher::motionRoute, this, MotionCommand::STOP_TRAJECTORY, _1, _2));
+	router.addExact("/executor/setangles", std::bind(&CommandDispatcher::motionRoute, this, MotionCommand::SET_ANGLES, _1, _2));
+	router.addExact("/executor/emergencystop", std::bind(&CommandDispatcher::emergencyStopRoute, this, _1, _2));
+	router.addExact("/executor/settrajectory", std::bind(&CommandDispatcher::setTrajectoryRoute, this, _1, _2));
+	router.addExact("/executor/isupandrunning", std::bind(&CommandDispatcher::stateRoute, this, IS_UP_AND_RUNNING, _1, _2));
+	router.addExact("/executor/getangles", std::bind(&CommandDispatcher::stateRoute, this, GET_ANGLES, _1, _2));
+	router.addExact("/executor/jitter", std::bind(&CommandDispatcher::stateRoute, this, JITTER, _1, _2));
+	router.addExact("/executor/lateness", std::bind(&CommandDispatcher::stateRoute, this, LATENESS, _1, _2));
 }
 
 CommandDispatcher& CommandDispatcher::getInstance() {
@@ -58,326 +58,287 @@ CommandDispatcher& CommandDispatcher::getInstance() {
 // central dispatcher of all url requests arriving at the webserver
 // returns true, if request has been dispatched within dispatch. Otherwise the caller
 // should assume that static content is to be displayed.
-bool  CommandDispatcher::dispatch(string uri, string query, string body, string &response, bool &okOrNOk) {
-
+bool  CommandDispatcher::dispatch(const string& uri, const string& query, const string& body, string &response, bool &okOrNOk) {
 	response = "";
-	string urlPath = getPath(uri);
-
-	vector<string> urlParamName;
-	vector<string> urlParamValue;
+	okOrNOk = false;
+	resetError(); // errors of the previous request of this thread
+	HttpRequest request(uri, query, body);
+	return router.dispatch(request, response, okOrNOk);
+}
 
-	compileURLParameter(query,urlParamName,urlParamValue);
+// cortex command in the path, parameters in the query
+bool CommandDispatcher::cortexRoute(HttpRequest& request, string& response) {
+	LOG(DEBUG) << request.path << " " << request.params.raw();
 
-	// check if direct cortex command defined via URL parameter
-	// example: /cortex/LED?blink
-	if (hasPrefix(uri, "/cortex")) {
-		LOG(DEBUG) << uri << " " << query;
-
-		string cmd = uri.substr(string("/cortex/").length());
-		for (int i = 0;i<CommDefType::NumberOfCommands;i++) {
-			string cortexCmdStr = string(commDef[i].name);
-			if (hasPrefix(cmd, cortexCmdStr)) {
-				string command = string(commDef[i].name);
-				// are there any parameters ?
-				if (query.length() > 0) {
-					std::istringstream iss(query);
-					std::string token;
-					while (std::getline(iss, token, '&'))
-					{
-						// extract name and value of parameter
-						int equalsIdx = token.find("=");
-						if (equalsIdx > 0) {
-							string name = token.substr(0,equalsIdx);
-							string value = token.substr(equalsIdx+1);
-							command += " " + name + "=" + value;
-						} else {
-							command += " " + token;
-						}
-					}
-				};
-				LOG(DEBUG) << "calling cortex with \"" << command << "\"";
-				string cmdReply;
-				TrajectoryExecution::getInstance().directAccess(command, cmdReply, okOrNOk);
-
-				if (cmdReply.length() > 0)
-					response += cmdReply + "";
-				if (okOrNOk)
-					response += "ok";
-				else
-					response += "failed";
-				return true;
-			}
-		}
+	CommDefType* comm = CommDefType::find(request.tail.c_str(), request.tail.length());
+	if (comm == 0) {
+		response = "unknown command " + request.tail;
+		return false;
 	}
 
-	// check, if cortex is called via one command string
-	// example /direct?param=LED+blink
-	if (hasPrefix(uri, "/direct")) {
-		if (hasPrefix(query, "param=")) {
-			LOG(DEBUG) << uri << " " << query;
+	string command = string(comm->name);
+	// are there any parameters ?
+	const string& query = request.params.raw();
+	if (query.length() > 0) {
+		std::istringstream iss(query);
+		std::string token;
+		while (std::getline(iss, token, '&'))
+			command += " " + token;
+	};
+	LOG(DEBUG) << "calling cortex with \"" << command << "\"";
+	string cmdReply;
+	bool ok = TrajectoryExecution::getInstance().request(MotionCommand::DIRECT_ACCESS, command, cmdReply);
+
+	response = cmdReply + (ok?"ok":"failed");
+	return ok;
+}
 
-			string cmd = urlDecode(query.substr(string("param=").length()));
-			LOG(DEBUG) << "calling cortex with \"" << cmd << "\"";
-			string cmdReply;
+// cortex called via one command string
+bool CommandDispatcher::directRoute(HttpRequest& request, string& response) {
+	LOG(DEBUG) << request.path << " " << request.params.raw();
 
-			TrajectoryExecution::getInstance().directAccess(cmd, cmdReply, okOrNOk);
-			std::ostringstream s;
-			if (okOrNOk) {
-				s << "OK";
-			} else {
-				s << "NOK(" << getLastError() << ") " << getErrorMessage(getLastError());
-			}
-			response += s.str();
-			return true;
-		}
+	string cmd;
+	if (!request.params.get("param", cmd)) {
+		response = "param missing";
+		return false;
 	}
+	LOG(DEBUG) << "calling cortex with \"" << cmd << "\"";
+	string cmdReply;
+	bool ok = TrajectoryExecution::getInstance().request(MotionCommand::DIRECT_ACCESS, cmd, cmdReply);
+	response = okOrNOkResponse(ok);
+	return ok;
+}
 
-	// check, if TransactionExecutor is called with orchestrated calls
-	if (hasPrefix(uri, "/executor/")) {
-		string executorPath = uri.substr(string("/executor/").length());
+// commands executed by the motion thread, the only parameter is "param"
+bool CommandDispatcher::motionRoute(MotionCommand::CommandType type, HttpRequest& request, string& response) {
+	LOG(DEBUG) << request.path << " " << request.params.raw();
 
-		if (hasPrefix(executorPath, "startupbot")) {
-			LOG(DEBUG) << uri << " " << query;
+	string param;
+	request.params.get("param", param);
+	string reply;
+	bool ok = TrajectoryExecution::getInstance().request(type, param, reply);
+	response = okOrNOkResponse(ok);
+	return ok;
+}
 
+bool CommandDispatcher::emergencyStopRoute(HttpRequest& request, string& response) {
+	LOG(DEBUG) << request.path << " " << request.params.raw();
 
-			okOrNOk =  TrajectoryExecution::getInstance().startupBot();
-			std::ostringstream s;
-			if (okOrNOk) {
-				s << "OK";
-			} else {
-				s << "NOK(" << getLastError() << ") " << getErrorMessage(getLastError());
-			}
-			response = s.str();
-		}
-		else if (hasPrefix(executorPath, "teardownbot")) {
-			LOG(DEBUG) << uri << " " << query;
+	string reply;
+	bool result = TrajectoryExecution::getInstance().request(MotionCommand::EMERGENCY_STOP_BOT, "", reply);
+	response = result?"true":"false";
+	return true;
+}
 
+bool CommandDispatcher::setTrajectoryRoute(HttpRequest& request, string& response) {
+	LOG(DEBUG) << request.path << " " << request.params.raw();
 
-			okOrNOk = TrajectoryExecution::getInstance().teardownBot();
-			std::ostringstream s;
-			if (okOrNOk) {
-				s << "OK";
-			} else {
-				s << "NOK(" << getLastError() << ") " << getErrorMessage(getLastError());
-			}
-			response = s.str();
-			return true;
-		}
-		else if (hasPrefix(executorPath, "nullpositionbot")) {
-			LOG(DEBUG) << uri << " " << query;
+	string param = urlDecode(request.body);
+	LOG(DEBUG) << "body:" << param;
 
+	resetError();
+	bool ok = TrajectoryExecution::getInstance().requestTrajectory(param) && !isError();
+	response = okOrNOkResponse(ok);
+	return ok;
+}
 
-			okOrNOk = TrajectoryExecution::getInstance().moveToNullPosition();
-			std::ostringstream s;
-			if (okOrNOk) {
-				s << "OK";
-			} else {
-				s << "NOK(" << getLastError() << ") " << getErrorMessage(getLastError());
-			}
-			response = s.str();
+// read the state published by the motion thread, does not wait for it
+bool CommandDispatcher::stateRoute(StateQuery query, HttpRequest& request, string& response) {
+	MotionState state = TrajectoryExecution::getInstance().getState();
+	switch (query) {
+		case IS_UP_AND_RUNNING:
+			response = state.botIsUpAndRunning?"true":"false";
 			return true;
+		case GET_ANGLES: {
+			int indent = 0;
+			TrajectoryNode node;
+			node.pose = state.pose;
+			response = node.toString(indent);
+			return !isError();
 		}
-		else if (hasPrefix(executorPath, "isupandrunning")) {
-			response = "";
-			bool result = TrajectoryExecution::getInstance().isBotUpAndReady();
-			okOrNOk = true;
-			response = result?"true":"false";
+		case JITTER:
+			// deviation of the MOVETO interval from the sample rate, measured in the motion thread
+			response = state.jitter.toString();
 			return true;
-		}
-		else if (hasPrefix(executorPath, "emergencystop")) {
-			LOG(DEBUG) << uri << " " << query;
-
-
-			response = "";
-			bool result = TrajectoryExecution::getInstance().emergencyStopBot();
-			okOrNOk = true;
-			response = result?"true":"false";
+		case LATENESS:
+			// histogram of how late the player computed samples compared to their deadline
+			response = state.lateness.toString();
 			return true;
-		}
-		else if (hasPrefix(executorPath, "setangles")) {
-			LOG(DEBUG) << uri << " " << query;
+	}
+	return false;
+}
 
+// lines since the id passed in "from", all lines if not passed
+static int getFromParam(HttpRequest& request) {
+	string from;
+	if (request.params.get("from", from))
+		return string_to_int(from);
+	return -1;
+}
 
-			string param = urlDecode(query.substr(string("param=").length()));
-			okOrNOk = TrajectoryExecution::getInstance().setAnglesAsString(param);
-			std::ostringstream s;
-			if (okOrNOk) {
-				s << "OK";
-			} else {
-				s << "NOK(" << getLastError() << ") " << getErrorMessage(getLastError());
-			}
-			response = s.str();
+bool CommandDispatcher::webRoute(HttpRequest& request, string& response) {
+	string key;
+	if (request.params.get("key", key)) {
+		if (key.compare("cortexcmd") == 0) {
+			int from = getFromParam(request);
+			response = getCmdLineJson((from >= 0)?from+1:0);
 			return true;
 		}
-		else if (hasPrefix(executorPath, "getangles")) {
-			LOG(DEBUG) << uri << " " << query;
-
-			int indent = 0;
-			response  = TrajectoryExecution::getInstance().currentTrajectoryNodeToString(indent);
-			okOrNOk = !isError();
+		if (key.compare("cortexlog") == 0) {
+			int from = getFromParam(request);
+			response = getLogLineJson((from >= 0)?from+1:0);
 			return true;
 		}
-		else if (hasPrefix(executorPath, "settrajectory")) {
-			LOG(DEBUG) << uri << " " << query;
-
-			string param = urlDecode(body);
-			LOG(DEBUG) << "body:" << param;
-
-			TrajectoryExecution::getInstance().runTrajectory(param);
-			okOrNOk = !isError();
-			std::ostringstream s;
-			if (okOrNOk) {
-				s << "OK";
-			} else {
-				s << "NOK(" << getLastError() << ") " << getErrorMessage(getLastError());
+		if (key.compare("alert") == 0) {
+			string from;
+			if (!request.params.get("from", from)) {
+				response = int_to_string(alerts.count());
+				return true;
 			}
-			response += s.str();
-			return true;
-		}
-		else if (hasPrefix(executorPath, "stoptrajectory")) {
-			LOG(DEBUG) << uri << " " << query;
-
-
-			TrajectoryExecution::getInstance().stopTrajectory();
-			okOrNOk = !isError();
-			std::ostringstream s;
-			if (okOrNOk) {
-				s << "OK";
-			} else {
-				s << "NOK(" << getLastError() << ") " << getErrorMessage(getLastError());
+			if (string_to_int(from) >= 0) {
+				response = getAlertLineJson(string_to_int(from));
+				return true;
 			}
-			response = s.str();
+		}
+		if (key.compare("heartbeat") == 0) {
+			response = getHeartbeatJson();
 			return true;
 		}
-
+		return false;
 	}
 
-	if (hasPrefix(uri, "/web")) {
-		string keyValue;
-		if (getURLParameter(urlParamName, urlParamValue, "key", keyValue)) {
-			if (keyValue.compare(string("cortexcmd")) == 0) {
-				if (getURLParameter(urlParamName, urlParamValue, "from", keyValue)) {
-					int from = string_to_int(keyValue);
-					if (from >=0 )
-						response = getCmdLineJson(from+1);
-					else
-						response = getCmdLineJson(0);
-				} else
-					response = getCmdLineJson(0);
-				okOrNOk = true;
-				return true;
-			} else {
-				if (keyValue.compare(string("cortexlog")) == 0) {
-					if (getURLParameter(urlParamName, urlParamValue, "from", keyValue)) {
-						int from = string_to_int(keyValue);
-						if (from >=0)
-							response = getLogLineJson(from+1);
-						else
-							response = getLogLineJson(0);
-					} else
-						response = getLogLineJson(0);
-					okOrNOk = true;
-					return true;
-				} else {
-					if (keyValue.compare(string("alert")) == 0) {
-						if (getURLParameter(urlParamName, urlParamValue, "from", keyValue)) {
-							int from = string_to_int(keyValue);
-							if (from >=0) {
-								response = getAlertLineJson(from);
-								okOrNOk = true;
-								return true;
-							}
-						} else {
-							response = int_to_string(alertCounter);
-							okOrNOk = true;
-							return true;
-						}
-					}
-					else {
-						if (keyValue.compare(string("heartbeat")) == 0) {
-							response = getHeartbeatJson();
-							okOrNOk = true;
-							return true;
-						}
-					}
-				}
-			}
-		} else {
-			if (getURLParameter(urlParamName, urlParamValue, "action", keyValue)) {
-				if (keyValue.compare("savecmd") == 0) {
-					LOG(DEBUG) << uri << " " << query;
-
-
-					string value;
-					if (getURLParameter(urlParamName, urlParamValue, "value", value)) {
-						string cmdReply;
-						TrajectoryExecution::getInstance().directAccess(value, cmdReply, okOrNOk);
-						response = cmdReply;
-						return true;
-					}
-				}
-			}
+	string action;
+	if (request.params.get("action", action) && (action.compare("savecmd") == 0)) {
+		LOG(DEBUG) << request.path << " " << request.params.raw();
+
+		string value;
+		if (request.params.get("value", value)) {
+			string cmdReply;
+			bool ok = TrajectoryExecution::getInstance().request(MotionCommand::DIRECT_ACCESS, value, cmdReply);
+			response = cmdReply;
+			return ok;
 		}
 	}
-
-	okOrNOk = false;
 	return false;
 }
 
 string CommandDispatcher::getHeartbeatJson() {
+	std::lock_guard<std::mutex> lock(heartbeatMutex);
 	if (millis() - lastHeartbeat < 1000)
 		return "true";
 	return "";
 }
 
 void CommandDispatcher::updateHeartbeat() {
+	std::lock_guard<std::mutex> lock(heartbeatMutex);
 	lastHeartbeat = millis();
 }
 
-string  CommandDispatcher::getCmdLineJson(int fromId) {
-	string fromIdStr = string("{\"id\":") + int_to_string(fromId);
-	string cmdJson;
-	int idx = cortexCmdJson.find(fromIdStr);
-	if (idx>=0){
-		cmdJson = cortexCmdJson.substr(idx);
-	} else
-		cmdJson = "";
-
-	string result = "[";
-	result += cmdJson + string("]");
+// render lines as json array
+static string linesToJson(const vector<LogRecord>& records, bool withTrajectory) {
+	string result;
+	for (unsigned i = 0;i<records.size();i++) {
+		if (i > 0)
+			result += ", ";
+		result += "{\"id\":" + int_to_string(records[i].id) +
+				", \"time\":\"" + htmlEncode(records[i].time) + "\"";
+		if (withTrajectory)
+			result += ", \"traj\":\"" + htmlEncode(records[i].traj) + "\"";
+		result += ", \"line\":\"" + htmlEncode(records[i].line) + "\"}";
+	}
 	return result;
 }
 
+string  CommandDispatcher::getCmdLineJson(int fromId) {
+	vector<LogRecord> records;
+	cortexCmds.get(fromId, records);
+	return "[" + linesToJson(records, true) + "]";
+}
+
 string CommandDispatcher::getAlertLineJson(int fromId) {
-	string fromIdStr = string("{\"id\":") + int_to_string(fromId);
-	string shortAlertJson;
-	int idx = alertJson.find(fromIdStr);
-	if (idx>=0){
-		int start = alertJson.find("\"line\":", idx);
-		int end = alertJson.find("}", start);
-
-		shortAlertJson = alertJson.substr(start+string("\"line\":\"").length(),end-start-string("\"line\":\"").length()-1);
-	} else
-		shortAlertJson = "";
-
-	return shortAlertJson;
+	LogRecord alert;
+	if (alerts.get(fromId, alert))
+		return htmlEncode(alert.line);
+	return "";
 }
 
 string CommandDispatcher::getLogLineJson(int fromId) {
-	string fromIdStr = string("{\"id\":") + int_to_string(fromId);
-	string logJson;
-	int idx = cortexLogJson.find(fromIdStr);
-	if (idx>=0){
-		logJson = cortexLogJson.substr(idx);
-	} else
-		logJson = "";
-
-	string result = "[ ";
-	result += logJson + " ]";
-	return result;
+	vector<LogRecord> records;
+	cortexLog.get(fromId, records);
+	return "[ " + linesToJson(records, false) + " ]";
+}
+
+void CommandDispatcher::initStreamClient(StreamClient& client, string topics) {
+	client.nodeTopic = topics.empty() || (topics.find("node") != string::npos);
+	client.linesTopic = topics.empty() || (topics.find("lines") != string::npos);
+	client.node = "";
+	client.nextCmdId = 0;
+	client.nextLogId = 0;
+	client.nextAlertId = alerts.count(); // only alerts that come up after connecting
+	client.heartbeat = false;
+	client.upAndRunning = false;
+	client.initial = true;
+}
+
+string CommandDispatcher::getStreamUpdateJson(StreamClient& client) {
+	string result;
+	MotionState state = TrajectoryExecution::getInstance().getState();
+
+	if (client.nodeTopic) {
+		int indent = 0;
+		TrajectoryNode node;
+		node.pose = state.pose;
+		string nodeStr = node.toString(indent);
+		if (nodeStr != client.node) {
+			client.node = nodeStr;
+			result += ", \"node\":\"" + htmlEncode(nodeStr) + "\"";
+		}
+	}
+
+	if (client.linesTopic) {
+		vector<LogRecord> records;
+		cortexCmds.get(client.nextCmdId, records);
+		if (!records.empty()) {
+			client.nextCmdId = records.back().id + 1;
+			result += ", \"cmd\":[" + linesToJson(records, true) + "]";
+		}
+
+		records.clear();
+		cortexLog.get(client.nextLogId, records);
+		if (!records.empty()) {
+			client.nextLogId = records.back().id + 1;
+			result += ", \"log\":[" + linesToJson(records, false) + "]";
+		}
+
+		string alertsJson;
+		LogRecord alert;
+		while (client.nextAlertId < alerts.count()) {
+			if (alerts.get(client.nextAlertId, alert))
+				alertsJson += string(alertsJson.empty()?"":", ") + "\"" + htmlEncode(alert.line) + "\"";
+			client.nextAlertId++;
+		}
+		if (!alertsJson.empty())
+			result += ", \"alert\":[" + alertsJson + "]";
+
+		bool heartbeat = !getHeartbeatJson().empty();
+		if (client.initial || (heartbeat != client.heartbeat)) {
+			client.heartbeat = heartbeat;
+			result += string(", \"heartbeat\":") + (heartbeat?"true":"false");
+		}
+		if (client.initial || (state.botIsUpAndRunning != client.upAndRunning)) {
+			client.upAndRunning = state.botIsUpAndRunning;
+			result += string(", \"up\":") + (state.botIsUpAndRunning?"true":"false");
+		}
+	}
+	client.initial = false;
+
+	if (result.empty())
+		return "";
+	return "{" + result.substr(2) + "}";
 }
 
 void CommandDispatcher::setOneTimeTrajectoryNodeName(string name) {
+	std::lock_guard<std::mutex> lock(heartbeatMutex);
 	oneTimeTrajectoryName = name;
 }
 
@@ -394,19 +355,16 @@ void CommandDispatcher::addCmdLine(string line) {
 			s = line;
 		}
 
-		if (line.compare("") != 0) {
-			int idx = cortexCmdJson.find("\"line\"");
-			if (idx >= 0)
-				cortexCmdJson += ", ";
-
-			string time = currentTimeToString();
-
-			cortexCmdJson += "{\"id\":" + int_to_string(cmdLineCounter++) +
-					", \"time\":\"" + htmlEncode(time) + "\"" +
-					", \"traj\":\"" + htmlEncode(oneTimeTrajectoryName) + "\"" +
-					", \"line\":\"" + htmlEncode(s) + "\"" +
-					"}";
-			oneTimeTrajectoryName = "";
+		if (s.compare("") != 0) {
+			LogRecord record;
+			record.time = currentTimeToString();
+			record.line = s;
+			{
+				std::lock_guard<std::mutex> lock(heartbeatMutex);
+				record.traj = oneTimeTrajectoryName;
+				oneTimeTrajectoryName = "";
+			}
+			cortexCmds.add(record);
 		}
 	}
 	while ((CRLNRidx >= 0));
@@ -414,43 +372,23 @@ void CommandDispatcher::addCmdLine(string line) {
 }
 
 void CommandDispatcher::addAlert(string line) {
-	int idx = alertJson.find("\"line\"");
-	if (idx >= 0)
-		alertJson += ", ";
-
-	alertJson += "{\"id\":" + int_to_string(alertCounter++) + ", \"line\":\"" + htmlEncode(line) + "\"}";
+	LogRecord record;
+	record.line = line;
+	alerts.add(record);
 }
 
 
 
 void CommandDispatcher::addLogLine(string line) {
-	string time;
-
+	LogRecord record;
 	if ((line.length() > 24) && (line[13] == ':') && (line[16] == ':')) {
-		time = line.substr(11,12);
-		line = line.substr(24);
-	} else
-		time = currentTimeToString();
-
-
-	int idx = cortexLogJson.find("\"line\"");
-
-	if (idx >= 0)
-		cortexLogJson += ", ";
-	cortexLogJson += "{\"id\":" + int_to_string(logLineCounter++) +
-			", \"time\":\"" + htmlEncode(time) + "\"" +
-			", \"line\":\"" + htmlEncode(line) + "\"}";
-
-
-	// remove staff from beginning if log gets loo long to be displayed
-	while (cortexLogJson.length() > LOGVIEW_MAXSIZE) {
-		int idx = cortexLogJson.find("{\"id\"");
-		if (idx >= 0) {
-			idx = cortexLogJson.find("{\"id\"", idx+1);
-			if (idx>= 0) {
-				cortexLogJson = cortexLogJson.substr(idx);
-			}
-		}
+		record.time = line.substr(11,12);
+		record.line = line.substr(24);
+	} else {
+		record.time = currentTimeToString();
+		record.line = line;
 	}
+	// the oldest line is dropped when the ring is full
+	cortexLog.add(record);
 }
 
@@ -11,13 +11,37 @@
 #define WEBSERVERAPI_H_
 
 #include "TrajectoryExecution.h"
+#include "LogRing.h"
+#include "HttpRouter.h"
 #include <vector>
+#include <mutex>
+
+// one line of the cortex log, the command history or an alert
+struct LogRecord {
+	int id;
+	string time;
+	string traj;	// command history only, name of the trajectory node that caused the command
+	string line;
+};
+
+// a client of the /stream websocket, remembers what has been pushed already
+struct StreamClient {
+	bool nodeTopic;			// current trajectory node of the bot
+	bool linesTopic;		// command history, log lines, alerts, heartbeat and bot state
+	string node;
+	int nextCmdId;
+	int nextLogId;
+	int nextAlertId;
+	bool heartbeat;
+	bool upAndRunning;
+	bool initial;			// nothing has been pushed yet
+};
 
 class CommandDispatcher {
 public:
 	CommandDispatcher();
 
-	bool dispatch(string uri, string query, string body, string &response, bool &okOrNOk);
+	bool dispatch(const string& uri, const string& query, const string& body, string &response, bool &okOrNOk);
 	static CommandDispatcher& getInstance();
 
 	string getCmdLineJson(int fromIdx);
@@ -32,17 +56,33 @@ public:
 
 	string getIncrLogLineJSon(string line);
 	void setOneTimeTrajectoryNodeName(string name);
+
+	// client subscribing to the passed topics ("node", "lines", empty means all)
+	void initStreamClient(StreamClient& client, string topics);
+	// everything that changed since the last call as json object, empty if nothing changed
+	string getStreamUpdateJson(StreamClient& client);
 private:
+	enum StateQuery { IS_UP_AND_RUNNING, GET_ANGLES, JITTER, LATENESS };
 
-	string cortexCmdJson;
-	string cortexLogJson;
-	string alertJson;
-	string oneTimeTrajectoryName;
-	int logLineCounter;
-	int cmdLineCounter;
-	int alertCounter;
+	// handlers of the routes registered in the constructor, return true if the request was successful
+	bool cortexRoute(HttpRequest& request, string& response);
+	bool directRoute(HttpRequest& request, string& response);
+	bool motionRoute(MotionCommand::CommandType type, HttpRequest& request, string& response);
+	bool emergencyStopRoute(HttpRequest& request, string& response);
+	bool setTrajectoryRoute(HttpRequest& request, string& response);
+	bool stateRoute(StateQuery query, HttpRequest& request, string& response);
+	bool webRoute(HttpRequest& request, string& response);
+
+	HttpRouter router;
 
+	// lines are added by the motion thread and the serial reactor, read by the http thread
+	LogRing<LogRecord, 512> cortexCmds;
+	LogRing<LogRecord, 512> cortexLog;
+	LogRing<LogRecord, 64> alerts;
+
+	string oneTimeTrajectoryName;
 	uint32_t lastHeartbeat = 0;
+	std::mutex heartbeatMutex;	// guards heartbeat and trajectory name
 };
 
 
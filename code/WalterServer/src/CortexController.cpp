@@ -31,6 +31,8 @@ using namespace std;
 
 const string reponseOKStr =">ok\r\n>";	 // reponse code from uC: >ok or >nok(errornumber)
 const string reponseNOKStr =">nok(";
+const int StreamNAKGuard_ms = 5;		// a NAKed frame is not resent again if it has been sent that recently
+const int CortexTimeResync_ms = 10000;	// clocks of Cortex and host drift apart, synchronise that often
 
 // the following functions are dummys, real functions are used in the uC. Purpose is to have
 // one communication interface header between uC and host containing all commands. uC uses a
@@ -55,6 +57,7 @@ void cmdHELP();
 void cmdINFO(){};
 void cmdPRINT(){};
 void cmdPRINTLN(){};
+void cmdTIME(){};
 
 
 bool CortexController::microControllerPresent(string cmd) {
@@ -157,22 +160,26 @@ bool CortexController::cmdPOWER(bool onOff) {
 	return ok;
 }
 
-bool CortexController::cmdCHECKSUM(bool onOff) {
-	string cmd = "";
+bool CortexController::cmdCHECKSUM(bool onOff, bool binary) {
 	CommDefType* comm = CommDefType::get(CommDefType::CommandType::CHECKSUM_CMD);
 
 	bool ok = false;
 	do {
+		string cmd = "";
 		cmd.append(comm->name);
 		if (onOff)
-			cmd.append(" on");
+			cmd.append(binary?" binary":" on");
 		else
 			cmd.append(" off");
 
 		string responseStr;
 		ok = callMicroController(cmd, responseStr, comm->expectedExecutionTime_ms);
-		if (ok)
+		if (ok) {
 			withChecksum = onOff;
+			withFrames = onOff && binary;
+			resetStream(); // Cortex starts with sequence number 0 as well
+			cortexTimeSynced = false;
+		}
 	} while (retry(ok));
 
 	return ok;
@@ -252,9 +259,95 @@ bool CortexController::cmdMOVETO(JointAngles angle_rad, int duration_ms) {
 		cmd.append(" ");
 		cmd.append(std::to_string(duration_ms));
 
-		string responseStr;
+		if (withFrames) {
+			// angles in 1/100 degree, cuts a MOVETO from ~70 bytes to 21 bytes
+			uint8_t payload[CommFrame::MoveToPayloadSize];
+			for (int i = 0;i<7;i++)
+				CommFrame::putInt16(&payload[i*2], (int16_t)constrain((rational)round(degrees(angle_rad[i])*100.0), (rational)-32767.0, (rational)32767.0));
+			CommFrame::putInt16(&payload[7*2], (int16_t)duration_ms);
+			if (streamWindow > 0)
+				return streamMOVETO(payload, CommFrame::MoveToPayloadSize, cmd, comm->expectedExecutionTime_ms); // no retry, the stream resends by itself
+			ok = callMicroController(comm->cmd, payload, CommFrame::MoveToPayloadSize, cmd, comm->expectedExecutionTime_ms);
+		} else {
+			string responseStr;
+			ok = callMicroController(cmd, responseStr, comm->expectedExecutionTime_ms);
+		}
+	} while (retry(ok));
+	return ok;
+}
+
+// MOVETO reaching the angles at the passed Cortex time
+bool CortexController::cmdMOVETOat(JointAngles angle_rad, uint32_t cortexTime_ms) {
+	if (!microControllerPresent("cmdMOVETOat"))
+		return false;
+	bool ok = false;
+	do {
+		string cmd = "";
+		CommDefType* comm = CommDefType::get(CommDefType::CommandType::MOVETO_CMD);
+
+		cmd.append(comm->name);
+		for (int i = 0;i<7;i++) {
+			cmd.append(" ");
+			rational angle_deg = degrees(angle_rad[i]);
+			string angleStr = string_format("%.2f",angle_deg);
+			cmd.append(angleStr);
+		}
+		cmd.append(" at=");
+		cmd.append(std::to_string(cortexTime_ms));
+
+		if (withFrames) {
+			uint8_t payload[CommFrame::MoveAtPayloadSize];
+			for (int i = 0;i<7;i++)
+				CommFrame::putInt16(&payload[i*2], (int16_t)constrain((rational)round(degrees(angle_rad[i])*100.0), (rational)-32767.0, (rational)32767.0));
+			CommFrame::putUInt32(&payload[7*2], cortexTime_ms);
+			if (streamWindow > 0)
+				return streamMOVETO(payload, CommFrame::MoveAtPayloadSize, cmd, comm->expectedExecutionTime_ms);
+			ok = callMicroController(comm->cmd, payload, CommFrame::MoveAtPayloadSize, cmd, comm->expectedExecutionTime_ms);
+		} else {
+			string responseStr;
+			ok = callMicroController(cmd, responseStr, comm->expectedExecutionTime_ms);
+		}
+	} while (retry(ok));
+	return ok;
+}
+
+bool CortexController::cmdTIME(uint32_t& cortexTime_ms) {
+	if (!microControllerPresent("cmdTIME"))
+		return false;
+
+	bool ok = false;
+	string responseStr;
+	do {
+		string cmd = "";
+		CommDefType* comm = CommDefType::get(CommDefType::CommandType::TIME_CMD);
+
+		cmd.append(comm->name);
 		ok = callMicroController(cmd, responseStr, comm->expectedExecutionTime_ms);
 	} while (retry(ok));
+
+	size_t idx = responseStr.find("t=");
+	if (ok && (idx != string::npos)) {
+		cortexTime_ms = strtoul(responseStr.c_str() + idx + 2, NULL, 10);
+		return true;
+	}
+	return false;
+}
+
+// estimate the offset of Cortex' clock, assuming that it answered in the middle of the round trip
+bool CortexController::syncCortexTime() {
+	if (!flushStream(CommDefType::get(CommDefType::CommandType::MOVETO_CMD)->expectedExecutionTime_ms))
+		return false;
+
+	milliseconds sendTime = millis();
+	uint32_t cortexTime_ms;
+	bool ok = cmdTIME(cortexTime_ms);
+	if (ok) {
+		milliseconds receiveTime = millis();
+		cortexTimeOffset = (int32_t)(cortexTime_ms - (uint32_t)(sendTime + (receiveTime - sendTime)/2));
+		cortexTimeSynced = true;
+		cortexTimeSyncTime = receiveTime;
+		LOG(DEBUG) << "Cortex time offset " << cortexTimeOffset << "ms, round trip " << receiveTime - sendTime << "ms";
+	}
 	return ok;
 }
 
@@ -517,72 +610,67 @@ bool CortexController::cmdINFO(bool &powered, bool& setuped, bool &enabled) {
 	return ok;
 }
 
-void CortexController::logFetcher() {
-
-	string currentLine;
-	string str;
+// called by the serial reactor with everything the uC logged
+void CortexController::logReceived(const string& str) {
+	currentLogLine.append(str);
 
-	while (true) {
-		int bytesRead = serialLog.receive(str);
-		if (bytesRead > 0) {
-
-			currentLine.append(str);
-			// log full lines only
-			int endOfLineIdx = currentLine.find("\r", 0);
-			if (endOfLineIdx > 0) {
-				string line = currentLine.substr(0,endOfLineIdx);
-				currentLine = currentLine.substr(endOfLineIdx+1);
+	// log full lines only
+	int endOfLineIdx;
+	while ((endOfLineIdx = currentLogLine.find("\r", 0)) >= 0) {
+		if (endOfLineIdx == 0) {
+			currentLogLine = currentLogLine.substr(1); // empty line
+			continue;
+		}
+		string line = currentLogLine.substr(0,endOfLineIdx);
+		currentLogLine = currentLogLine.substr(endOfLineIdx+1);
 
-				if (line[0] == '\r')
-					line = line.substr(1);
-				if (line[0] == '\n')
-					line = line.substr(1);
+		if (line[0] == '\r')
+			line = line.substr(1);
+		if (line[0] == '\n')
+			line = line.substr(1);
 
-				replaceWhiteSpace(line);
+		replaceWhiteSpace(line);
 
- 				if (logMCToConsole)
-					cout << "log>" << line << endl;
+		if (logMCToConsole)
+			cout << "log>" << line << endl;
 
- 				// push log message to cmd dispatcher
- 				CommandDispatcher::getInstance().addLogLine(line);
+		// push log message to cmd dispatcher
+		CommandDispatcher::getInstance().addLogLine(line);
 
- 				LOG(TRACE) << line;
-				logSuckingThreadState = 1; // a log line has been detected, state success!
-			}
-		} else
-			delay(1);
+		LOG(TRACE) << line;
+		logReceiverState = 1; // a log line has been detected, state success!
 	}
 }
 
+void CortexController::setSerialPorts(string pCmdDevice, string pLogDevice) {
+	cmdDevice = pCmdDevice;
+	logDevice = pLogDevice;
+}
+
 bool CortexController::setupCommunication() {
 	LOG(DEBUG) << "entering ActuatorCtrlInterface::setup";
 
-	LOG(DEBUG) << "log sucking thread started";
-	logSuckingThreadState = 0;
+	logReceiverState = 0;
 	serialLog.disconnect();
-	bool ok= serialLog.connect(CORTEX_LOGGER_SERIAL_PORT, CORTEX_LOGGER_BAUD_RATE);
+	serialLog.onReceive(std::bind(&CortexController::logReceived, this, std::placeholders::_1));
+	bool ok= serialLog.connect(logDevice, CORTEX_LOGGER_BAUD_RATE);
 	if (!ok) {
-		LOG(ERROR) << "connecting to " << CORTEX_LOGGER_SERIAL_PORT << "(" << CORTEX_LOGGER_BAUD_RATE << ") failed";
+		LOG(ERROR) << "connecting to " << logDevice << "(" << CORTEX_LOGGER_BAUD_RATE << ") failed";
 		setError(CORTEX_LOG_COM_FAILED);
 		return false;
 	}
 
 	// now start command interface
 	serialCmd.disconnect();
-	ok = serialCmd.connect(CORTEX_COMMAND_SERIAL_PORT , CORTEX_COMMAND_BAUD_RATE);
+	ok = serialCmd.connect(cmdDevice, CORTEX_COMMAND_BAUD_RATE);
 	if (!ok) {
-		LOG(ERROR) << "connecting to " << CORTEX_COMMAND_SERIAL_PORT << "(" << CORTEX_COMMAND_BAUD_RATE << ") failed";
+		LOG(ERROR) << "connecting to " << cmdDevice << "(" << CORTEX_COMMAND_BAUD_RATE << ") failed";
 		setError(CORTEX_COM_FAILED);
 
 		return false;
 	}
 
-	// start log fetching thread
-	if (logSuckingThread == NULL)
-		logSuckingThread = new std::thread(&CortexController::logFetcher, this);
-	delay(1);
-
-	 ok = cmdLOGtest(true); // writes a log entry
+	ok = cmdLOGtest(true); // writes a log entry
 	if (!ok) {
 		if (getLastError() == CHECKSUM_EXPECTED) {
 			// try with checksum, uC must have been started earlier with checksum set
@@ -597,10 +685,10 @@ bool CortexController::setupCommunication() {
 	// wait at most 100ms for log entry
 	unsigned long startTime  = millis();
 	do { delay(1); }
-	while ((millis() - startTime < 1000) && (logSuckingThreadState != 1));
+	while ((millis() - startTime < 1000) && (logReceiverState != 1));
 
-	if (logSuckingThreadState != 1) {
-		LOG(ERROR) << "log thread failed";
+	if (logReceiverState != 1) {
+		LOG(ERROR) << "log receiver failed";
 		return false;
 	}
 
@@ -613,8 +701,12 @@ bool CortexController::setupCommunication() {
 		return false;
 	}
 
-	// switch checksum on
-	ok = cmdCHECKSUM(true);
+	// switch checksum and binary frames on, older firmware knows checksum only
+	ok = cmdCHECKSUM(true, true);
+	if (!ok) {
+		LOG(WARNING) << "binary frames not supported by uC, use text commands";
+		ok = cmdCHECKSUM(true, false);
+	}
 	if (!ok) {
 		LOG(ERROR) << "switching on checksum to uC failed";
 		return false;
@@ -629,7 +721,7 @@ bool CortexController::setupCommunication() {
 		return false;
 	}
 
-	if (logSuckingThreadState != 1) {
+	if (logReceiverState != 1) {
 		LOG(ERROR) << "logging interface could not be established";
 		return false;
 	}
@@ -752,6 +844,14 @@ bool CortexController::move(JointAngles angle_rad, int duration_ms) {
 	return cmdMOVETO(angle_rad, min(9999,duration_ms));
 }
 
+bool CortexController::moveAt(JointAngles angle_rad, milliseconds time) {
+	if (!cortexTimeSynced || (millis() - cortexTimeSyncTime > CortexTimeResync_ms)) {
+		if (!syncCortexTime())
+			return false;
+	}
+	return cmdMOVETOat(angle_rad, (uint32_t)time + cortexTimeOffset);
+}
+
 void CortexController::directAccess(string cmd, string& response, bool &okOrNOk) {
 	okOrNOk = callMicroController(cmd, response, 5000);
 }
@@ -782,20 +882,18 @@ void CortexController::sendString(string str) {
 
 
 bool CortexController::callMicroController(string& cmd, string& response, int timeout_ms) {
+	// replies of streamed frames must not interfere with this reply
+	if (!flushStream(timeout_ms))
+		return false;
 	resetError();
 
 	CommandDispatcher::getInstance().addCmdLine(cmd);
 	// check command to identify timeout
-	for (int i = 0;i<CommDefType::NumberOfCommands;i++) {
-		string cmdStr = string(commDef[i].name);
-		if (hasPrefix(cmd,cmdStr)) {
-			timeout_ms = commDef[i].expectedExecutionTime_ms;
-			break;
-		}
-	}
+	CommDefType* comm = CommDefType::find(cmd.c_str(), std::min(cmd.find(' '), cmd.length()));
+	if (comm != 0)
+		timeout_ms = comm->expectedExecutionTime_ms;
 	sendString(cmd);
-	delay(5);
-	bool ok = receive(response, timeout_ms-5);
+	bool ok = receive(response, timeout_ms);
 	replace (response.begin(), response.end(), '\r' , ' ');
 	// replace (response.begin(), response.end(), '\n' , 'N');
 
@@ -813,6 +911,199 @@ bool CortexController::callMicroController(string& cmd, string& response, int ti
 	return ok;
 }
 
+// send a binary frame, cmdStr is the same command in text form used for logging only
+bool CortexController::callMicroController(CommDefType::CommandType cmd, const uint8_t* payload, int payloadLen, string& cmdStr, int timeout_ms) {
+	if (!flushStream(timeout_ms))
+		return false;
+	resetError();
+
+	CommandDispatcher::getInstance().addCmdLine(cmdStr);
+
+	uint8_t frame[CommFrame::MaxFrameSize];
+	int frameLen = CommFrame::build(cmd, payload, payloadLen, frame);
+	serialCmd.sendBinary(frame, frameLen);
+	bool ok = receiveFrame(cmd, timeout_ms);
+
+	if (ok) {
+		CommandDispatcher::getInstance().updateHeartbeat();
+	}
+	else {
+		if (getLastError() != ABSOLUTELY_NO_ERROR)
+			CommandDispatcher::getInstance().addCmdLine(getLastErrorMessage());
+		else
+			CommandDispatcher::getInstance().addCmdLine("unknown error");
+	}
+	LOG(DEBUG) << "send frame -> \"" << cmdStr << "\" timeout=" << timeout_ms << " ok=" << string(ok?"true":"false") << " (" << getLastError() << ")";
+	return ok;
+}
+
+// receive the reply frame containing the status byte. Returns true if status is ok,
+// communicationFailureCounter is handled like in receive
+bool CortexController::receiveFrame(uint8_t cmd, int timeout_ms) {
+	string response = "";
+	string rawResponse = "";
+	string replyFrame = "";
+	unsigned long startTime = millis();
+	bool replyIsOk = false;
+	bool isTimeout = false;
+	do {
+		int bytesRead = serialCmd.receive(rawResponse, timeout_ms - (int)(millis() - startTime));
+		if (bytesRead > 0) {
+			response += rawResponse;
+			replyIsOk = extractFrame(response, replyFrame);
+		}
+		isTimeout = (millis() - startTime > (unsigned long)timeout_ms);
+	}
+	while (!isTimeout && !replyIsOk);
+
+	const uint8_t* reply = (const uint8_t*)replyFrame.c_str();
+	if (replyIsOk && CommFrame::check(reply, replyFrame.length()) && (reply[2] == cmd)) {
+		communicationFailureCounter = 0;
+		uint8_t status = reply[CommFrame::HeaderSize];
+		if (status != ABSOLUTELY_NO_ERROR) {
+			setError((ErrorCodeType)status);
+			LOG(WARNING) << "response frame NOK(" << getLastError() << ")";
+		}
+		return (status == ABSOLUTELY_NO_ERROR);
+	}
+
+	if (isTimeout) {
+		LOG(WARNING) << "no response";
+		setError(CORTEX_NO_RESPONSE);
+	} else {
+		LOG(WARNING) << "response frame corrupt";
+		setError(CHECKSUM_WRONG);
+	}
+	serialCmd.clear();
+	delay(10);
+	serialCmd.clear();
+	communicationFailureCounter++;
+	return false;
+}
+// take the first complete frame out of buffer, anything in front of it is skipped
+bool CortexController::extractFrame(string& buffer, string& frame) {
+	while (true) {
+		size_t startIdx = buffer.find((char)CommFrame::StartByte);
+		if (startIdx == string::npos) {
+			buffer = "";
+			return false;
+		}
+		if (startIdx > 0)
+			buffer.erase(0, startIdx);
+		if (buffer.length() < 2)
+			return false;
+		int len = (uint8_t)buffer[1];
+		if ((len < 1) || (len > CommFrame::MaxPayloadSize+1)) {
+			buffer.erase(0,1); // not a frame, look for the next start byte
+			continue;
+		}
+		int frameLen = len + 2 + CommFrame::CRCSize;
+		if (buffer.length() < (size_t)frameLen)
+			return false;
+		frame = buffer.substr(0, frameLen);
+		buffer.erase(0, frameLen);
+		return true;
+	}
+}
+
+void CortexController::setStreamWindow(int frames) {
+	flushStream(CommDefType::get(CommDefType::CommandType::MOVETO_CMD)->expectedExecutionTime_ms);
+	streamWindow = constrain(frames, 0, CommFrame::StreamWindowSize);
+}
+
+void CortexController::resetStream() {
+	streamSeq = 0;
+	streamInFlight.clear();
+	streamReceiveBuffer = "";
+}
+
+// send a MOVETO frame with sequence number without waiting for its ack, unless the window is full
+bool CortexController::streamMOVETO(const uint8_t* payload, int payloadLen, string& cmdStr, int timeout_ms) {
+	CommandDispatcher::getInstance().addCmdLine(cmdStr);
+
+	bool ok = pollStream(timeout_ms, false);
+	while (ok && ((int)streamInFlight.size() >= streamWindow))
+		ok = pollStream(timeout_ms, true);
+	if (!ok)
+		return false;
+
+	uint8_t streamPayload[CommFrame::MaxPayloadSize];
+	streamPayload[0] = streamSeq;
+	memcpy(&streamPayload[1], payload, payloadLen);
+
+	StreamFrame frame;
+	frame.seq = streamSeq++;
+	frame.len = CommFrame::build(CommDefType::MOVETO_CMD, streamPayload, 1 + payloadLen, frame.frame);
+	frame.sentTime = millis();
+	serialCmd.sendBinary(frame.frame, frame.len);
+	streamInFlight.push_back(frame);
+
+	LOG(DEBUG) << "stream frame " << (int)frame.seq << " -> \"" << cmdStr << "\" in flight=" << streamInFlight.size();
+	return true;
+}
+
+void CortexController::resendStreamFrame(StreamFrame& frame) {
+	frame.sentTime = millis();
+	serialCmd.sendBinary(frame.frame, frame.len);
+}
+
+// process all received acks and naks, resend NAKed and timed out frames. If wait is set, block until
+// a reply comes in or the oldest frame times out. Returns false if Cortex does not respond anymore.
+bool CortexController::pollStream(int timeout_ms, bool wait) {
+	string rawResponse, replyFrame;
+	int wait_ms = 0;
+	if (wait && !streamInFlight.empty())
+		wait_ms = max(1, timeout_ms - (int)(millis() - streamInFlight.front().sentTime));
+	if (serialCmd.receive(rawResponse, wait_ms) > 0)
+		streamReceiveBuffer += rawResponse;
+
+	while (extractFrame(streamReceiveBuffer, replyFrame)) {
+		const uint8_t* reply = (const uint8_t*)replyFrame.c_str();
+		if (!CommFrame::check(reply, replyFrame.length()) || (reply[1] != CommFrame::ReplyPayloadSize+1)) {
+			LOG(WARNING) << "stream reply corrupt";
+			continue; // timeout of the oldest frame will resend
+		}
+		uint8_t status = reply[CommFrame::HeaderSize];
+		uint8_t nextSeq = reply[CommFrame::HeaderSize+1];
+		communicationFailureCounter = 0;
+		CommandDispatcher::getInstance().updateHeartbeat();
+
+		// acknowledgement is cumulative, all frames before nextSeq have been received
+		while (!streamInFlight.empty() && ((uint8_t)(nextSeq - streamInFlight.front().seq - 1) < 128))
+			streamInFlight.pop_front();
+
+		// NAK, resend only the missing frame, Cortex keeps the others
+		if ((status != ABSOLUTELY_NO_ERROR) && !streamInFlight.empty() && (streamInFlight.front().seq == nextSeq) &&
+			(millis() - streamInFlight.front().sentTime >= (unsigned long)StreamNAKGuard_ms)) {
+			LOG(DEBUG) << "stream frame " << (int)nextSeq << " NAK(" << (int)status << "), resend";
+			resendStreamFrame(streamInFlight.front());
+		}
+	}
+
+	// oldest frame has not been acknowledged in time
+	if (!streamInFlight.empty() && (millis() - streamInFlight.front().sentTime > (unsigned long)timeout_ms)) {
+		communicationFailureCounter++;
+		if (communicationFailureCounter >= 5) {
+			LOG(ERROR) << "stream frame " << (int)streamInFlight.front().seq << " not acknowledged, quitting";
+			setError(CORTEX_NO_RESPONSE);
+			// sequence numbers of both sides are out of sync, setupCommunication negotiates them again
+			resetStream();
+			microControllerOk = false;
+			return false;
+		}
+		LOG(WARNING) << "stream frame " << (int)streamInFlight.front().seq << " timed out, resend";
+		resendStreamFrame(streamInFlight.front());
+	}
+	return true;
+}
+
+// wait until all streamed frames are acknowledged
+bool CortexController::flushStream(int timeout_ms) {
+	bool ok = true;
+	while (ok && !streamInFlight.empty())
+		ok = pollStream(timeout_ms, true);
+	return ok;
+}
 
 bool CortexController::receive(string& str, int timeout_ms) {
 
@@ -828,12 +1119,11 @@ bool CortexController::receive(string& str, int timeout_ms) {
 	string rawResponse ="";
 	bool isTimeout = false;
 	do {
-		bytesRead = serialCmd.receive(rawResponse);
+		bytesRead = serialCmd.receive(rawResponse, timeout_ms - (int)(millis() - startTime));
 		if (bytesRead > 0) {
 			response += rawResponse;
 			replyIsOk = checkReponseCode(response, reponsePayload,okOrNOK);
-		} else
-			delay(1); // enough to transfer 64 byte
+		}
 		retryCount--;
 		isTimeout = (millis() - startTime > (unsigned long)timeout_ms);
 	}
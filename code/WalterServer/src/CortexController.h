@@ -9,6 +9,7 @@
 #define MICROCONTROLLERINTERFACE_H_
 
 #include <thread>
+#include <deque>
 #include "string.h"
 
 #include "setup.h"
@@ -30,13 +31,20 @@ public:
 		powerOn = false;
 		ledState = LED_OFF;
 		ledStatePending = true;
-		logSuckingThread= NULL;
 		withChecksum = false;
+		withFrames = false;
+		streamSeq = 0;
+		streamWindow = CommFrame::StreamWindowSize;
+		cortexTimeOffset = 0;
+		cortexTimeSynced = false;
+		cortexTimeSyncTime = 0;
 		logMCToConsole = false;
 		communicationFailureCounter = 0;
 		setup = false;
 		powered = false;
 		enabled = false;
+		cmdDevice = CORTEX_COMMAND_SERIAL_PORT;
+		logDevice = CORTEX_LOGGER_SERIAL_PORT;
 	}
 	static CortexController& getInstance() {
 		static CortexController instance;
@@ -46,6 +54,9 @@ public:
 	// log everything from uC to cout. Used for directly access the uC
 	void loguCToConsole() { logMCToConsole = true; };
 
+	// devices used by setupCommunication, either a name in /dev or an absolute path
+	void setSerialPorts(string cmdDevice, string logDevice);
+
 	// initialize a safe communication. uC's setup is not called, bot remains silent
 	bool setupCommunication();
 
@@ -77,6 +88,13 @@ public:
 	// requires setupBot and power(true) upfront
 	bool move(JointAngles angle_rad, int duration_ms);
 
+	// transfer a trajectory point that is reached at the passed time (millis()). Cortex queues it behind
+	// the points it has already, so points sent a few samples ahead keep the bot moving when one comes late
+	bool moveAt(JointAngles angle_rad, milliseconds time);
+
+	// number of MOVETO frames sent without waiting for their ack (requires binary frames), 0 = stop-and-wait
+	void setStreamWindow(int frames);
+
 	void loop();
 
 	bool isCortexCommunicationOk() { return microControllerOk; };
@@ -88,19 +106,38 @@ private:
 	bool retry(bool replyOk);
 
 	bool callMicroController(string& cmd, string& response, int timeout_ms);
+	bool callMicroController(CommDefType::CommandType cmd, const uint8_t* payload, int payloadLen, string& cmdStr, int timeout_ms);
 	bool receive(string& str, int timeout_ms);
+	bool receiveFrame(uint8_t cmd, int timeout_ms);
+	bool extractFrame(string& buffer, string& frame);
+
+	// streamed MOVETO frames with sequence numbers, see CommFrame
+	struct StreamFrame {
+		uint8_t seq;
+		uint8_t frame[CommFrame::MaxFrameSize];
+		int len;
+		unsigned long sentTime;
+	};
+	bool streamMOVETO(const uint8_t* payload, int payloadLen, string& cmdStr, int timeout_ms);
+	bool pollStream(int timeout_ms, bool wait);
+	bool flushStream(int timeout_ms);
+	void resendStreamFrame(StreamFrame& frame);
+	void resetStream();
+	bool syncCortexTime();
 	bool checkReponseCode(string &s, string& plainResponse, bool &OkOrNOk);
 
 	void sendString(string str);
 
 	bool cmdLED(LEDState state);
 	bool cmdECHO(string s);
-	bool cmdCHECKSUM(bool onOff);
+	bool cmdCHECKSUM(bool onOff, bool binary);
 	bool cmdPOWER(bool onOff);
 	bool cmdSETUP();
 	bool cmdDISABLE();
 	bool cmdENABLE();
 	bool cmdMOVETO(JointAngles angle, int duration_ms);
+	bool cmdMOVETOat(JointAngles angle, uint32_t cortexTime_ms);
+	bool cmdTIME(uint32_t& cortexTime_ms);
 	bool cmdGET(int actuatorNo, ActuatorStateType actuatorState);
 	bool cmdGETall(ActuatorStateType actuatorState[]);
 
@@ -118,23 +155,33 @@ private:
 	bool cmdINFO(bool &powered, bool& setuped, bool &enabled);
 
 	void computeChecksum(string s,uint8_t& hash);
-	void logFetcher();
+	void logReceived(const string& str);
 	bool microControllerPresent(string cmd);
 
 
 	SerialPort serialCmd; 			// serial port to transfer commands
 	SerialPort serialLog; 			// serial port to suck log output from uC
+	string cmdDevice;
+	string logDevice;
 
 	LEDState ledState;	 			// current state of LED (not necessarily transfered)
 	bool ledStatePending;			// true, if LED state needs to be transfered to uC
 	bool powerOn;
 
 
-	std::thread* logSuckingThread = NULL;	// thread that sucks in all uC logs and merges into our log
-	int logSuckingThreadState;		// status of logging thread
+	string currentLogLine;			// uC log received so far without line end
+	int logReceiverState;			// 1 if a log line has been received
 
 	ActuatorStateType currActState[NumberOfActuators];
 	bool withChecksum;
+	bool withFrames;				// MOVETO is sent as binary frame, negotiated via CHECKSUM binary
+	int streamWindow;				// max number of unacknowledged MOVETO frames
+	uint8_t streamSeq;				// sequence number of next streamed frame
+	std::deque<StreamFrame> streamInFlight; // sent but not yet acknowledged frames, oldest first
+	string streamReceiveBuffer;		// replies received but not yet processed
+	int32_t cortexTimeOffset;		// Cortex' millis() minus ours
+	bool cortexTimeSynced;
+	milliseconds cortexTimeSyncTime;// time of last synchronisation
 	bool logMCToConsole = false;
 	bool microControllerOk = false;
 	int communicationFailureCounter = 0;
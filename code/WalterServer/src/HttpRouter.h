@@ -0,0 +1,108 @@
+/*
+ * HttpRouter.h
+ *
+ * Maps the path of an http request to its handler. Exact paths are looked up in a hash map,
+ * prefix routes match whole path segments only, the longest prefix wins.
+ * Query parameters are not split upfront but searched when a handler asks for them.
+ *
+ * Author: JochenAlt
+ */
+
+#ifndef HTTPROUTER_H_
+#define HTTPROUTER_H_
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <string.h>
+
+#include "Util.h"
+
+using namespace std;
+
+// query string of a request, parameters are parsed only when asked for
+class URLParams {
+public:
+	URLParams(const string& pQuery) : query(pQuery) {};
+
+	// url-decoded value of the parameter key, returns false if not present
+	bool get(const char* key, string& value) const {
+		size_t keyLen = strlen(key);
+		size_t pos = 0;
+		while (pos < query.length()) {
+			size_t end = query.find('&', pos);
+			if (end == string::npos)
+				end = query.length();
+			if ((end - pos > keyLen) && (query[pos + keyLen] == '=') && (query.compare(pos, keyLen, key) == 0)) {
+				value = urlDecode(query.substr(pos + keyLen + 1, end - pos - keyLen - 1));
+				return true;
+			}
+			pos = end + 1;
+		}
+		return false;
+	}
+
+	const string& raw() const { return query; };
+private:
+	const string& query;
+};
+
+struct HttpRequest {
+	HttpRequest(const string& pPath, const string& pQuery, const string& pBody) :
+		path(pPath), params(pQuery), body(pBody) {};
+
+	const string& path;
+	string tail;				// prefix routes only, the path behind the prefix without leading '/'
+	URLParams params;
+	const string& body;
+};
+
+// returns true if the request has been executed successfully, response is sent either way
+typedef std::function<bool (HttpRequest& request, string& response)> RouteHandler;
+
+class HttpRouter {
+public:
+	// path has to match completely
+	void addExact(const string& path, RouteHandler handler) {
+		exactRoutes[path] = handler;
+	}
+
+	// matches the prefix itself and everything below, "/cortex" matches "/cortex/led" but not "/cortexled"
+	void addPrefix(const string& prefix, RouteHandler handler) {
+		PrefixRoute route = { prefix, handler };
+		vector<PrefixRoute>::iterator pos = prefixRoutes.begin();
+		while ((pos != prefixRoutes.end()) && (pos->prefix.length() >= prefix.length()))
+			pos++;
+		prefixRoutes.insert(pos, route);
+	}
+
+	// returns false if no route matches, otherwise ok is the result of the handler
+	bool dispatch(HttpRequest& request, string& response, bool& ok) {
+		unordered_map<string, RouteHandler>::iterator exact = exactRoutes.find(request.path);
+		if (exact != exactRoutes.end()) {
+			ok = exact->second(request, response);
+			return true;
+		}
+		for (unsigned i = 0;i<prefixRoutes.size();i++) {
+			const string& prefix = prefixRoutes[i].prefix;
+			const string& path = request.path;
+			if ((path.compare(0, prefix.length(), prefix) == 0) &&
+				((path.length() == prefix.length()) || (path[prefix.length()] == '/'))) {
+				request.tail = (path.length() > prefix.length())?path.substr(prefix.length()+1):"";
+				ok = prefixRoutes[i].handler(request, response);
+				return true;
+			}
+		}
+		return false;
+	}
+private:
+	struct PrefixRoute {
+		string prefix;
+		RouteHandler handler;
+	};
+	unordered_map<string, RouteHandler> exactRoutes;
+	vector<PrefixRoute> prefixRoutes;	// longest prefix first
+};
+
+#endif /* HTTPROUTER_H_ */
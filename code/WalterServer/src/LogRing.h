@@ -0,0 +1,80 @@
+/*
+ * LogRing.h
+ *
+ * Fixed-capacity store of log records with increasing ids. Writers from any thread
+ * reserve their slot with an atomic counter, so a record is found by its id in O(1).
+ * Each slot has its own lock, writers block neither each other nor a reader
+ * that is copying other slots. Records are kept structured, rendering is up to the reader.
+ *
+ * Author: JochenAlt
+ */
+
+#ifndef LOGRING_H_
+#define LOGRING_H_
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+
+// T needs an int member id, which is set when added
+template<typename T, int Capacity>
+class LogRing {
+public:
+	LogRing() : nextId(0) {
+		for (int i = 0;i<Capacity;i++)
+			slots[i].id = -1;
+	};
+
+	// returns the id of the added record. Overwrites the oldest record if the ring is full
+	int add(T& record) {
+		int id = nextId.fetch_add(1);
+		Slot& slot = slots[id % Capacity];
+		std::lock_guard<std::mutex> lock(slot.mutex);
+		if (id > slot.id) {		// a writer who lapped the ring has been faster, drop this one
+			record.id = id;
+			slot.record = std::move(record);
+			slot.id = id;
+		}
+		return id;
+	}
+
+	// copy all records with id >= fromId that are still available, in order of their id.
+	// Stops at a record that is not completely written yet, so the ids of the result have no gaps
+	void get(int fromId, std::vector<T>& records) {
+		int endId = nextId.load();
+		int id = std::max(std::max(fromId, endId - Capacity), 0);
+		for (;id < endId;id++) {
+			Slot& slot = slots[id % Capacity];
+			std::lock_guard<std::mutex> lock(slot.mutex);
+			if (slot.id != id)
+				break;
+			records.push_back(slot.record);
+		}
+	}
+
+	// get the record with the passed id. Returns false if not available (anymore)
+	bool get(int id, T& record) {
+		if (id < 0)
+			return false;
+		Slot& slot = slots[id % Capacity];
+		std::lock_guard<std::mutex> lock(slot.mutex);
+		if (slot.id != id)
+			return false;
+		record = slot.record;
+		return true;
+	}
+
+	// number of records ever added, which is the id of the next one
+	int count() { return nextId.load(); };
+private:
+	struct Slot {
+		std::mutex mutex;
+		int id;
+		T record;
+	};
+	std::atomic<int> nextId;
+	Slot slots[Capacity];
+};
+
+#endif /* LOGRING_H_ */
@@ -8,10 +8,22 @@
 #include "string.h"
 #include "Util.h"
 #include "logger.h"
+
+#ifdef _WIN32
 #include "rs232.h"
+#else
+#include <map>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <termios.h>
+#include <sys/epoll.h>
+#endif
 
 using namespace std;
 
+#ifdef _WIN32
 
 SerialPort::SerialPort() {
 	_port = -1;
@@ -57,13 +69,6 @@ int SerialPort::getArray (char *buffer, int len) {
 	return bytesRead;
 }
 
-int SerialPort::sendString(string str) {
-	str += newlineStr;
-	int written = sendArray((char*)str.c_str(), str.length());
-	return written;
-}
-
-
 int SerialPort::receive(string& str) {
 	str = "";
 	int totalBytesRead = 0;
@@ -82,9 +87,247 @@ int SerialPort::receive(string& str) {
 	return totalBytesRead;
 }
 
+int SerialPort::receive(string& str, int timeout_ms) {
+	unsigned long startTime = millis();
+	int bytesRead = receive(str);
+	while ((bytesRead == 0) && ((int)(millis() - startTime) < timeout_ms)) {
+		delay(1);
+		bytesRead = receive(str);
+	}
+	return bytesRead;
+}
+
+void SerialPort::onReceive(ReceiveCallback pCallback) {
+	callback = pCallback;
+	if (callbackThread == NULL)
+		callbackThread = new std::thread(&SerialPort::callbackLoop, this);
+}
+
+void SerialPort::callbackLoop() {
+	string str;
+	while (true) {
+		if (receive(str) > 0)
+			callback(str);
+		else
+			delay(1);
+	}
+}
+
 void SerialPort::clear() {
 	if (_port >= 0) {
 		string str;
 		while (receive(str) > 0);
 	}
 }
+
+#else
+
+// One thread waiting with epoll on all connected ports. Received data is either passed to
+// the port's callback or collected for SerialPort::receive, which is woken up right away.
+class SerialReactor {
+public:
+	static SerialReactor& getInstance() {
+		static SerialReactor instance;
+		return instance;
+	}
+
+	void add(SerialPort* port) {
+		std::unique_lock<std::mutex> lock(portsMutex);
+		if (reactorThread == NULL)
+			reactorThread = new std::thread(&SerialReactor::loop, this);
+		struct epoll_event event;
+		memset(&event, 0, sizeof(event));
+		event.events = EPOLLIN;
+		event.data.fd = port->fd;
+		if (epoll_ctl(epollFd, EPOLL_CTL_ADD, port->fd, &event) < 0)
+			LOG(ERROR) << "epoll_ctl add failed (" << strerror(errno) << ")";
+		ports[port->fd] = port;
+	}
+
+	// after returning, the reactor does not touch the port anymore
+	void remove(SerialPort* port) {
+		std::unique_lock<std::mutex> lock(portsMutex);
+		epoll_ctl(epollFd, EPOLL_CTL_DEL, port->fd, NULL);
+		ports.erase(port->fd);
+	}
+
+private:
+	SerialReactor() {
+		epollFd = epoll_create1(0);
+		if (epollFd < 0)
+			LOG(ERROR) << "epoll_create failed (" << strerror(errno) << ")";
+		reactorThread = NULL;
+	}
+
+	void loop() {
+		const int MaxEvents = 4;
+		struct epoll_event events[MaxEvents];
+		while (true) {
+			int n = epoll_wait(epollFd, events, MaxEvents, -1);
+			if ((n < 0) && (errno != EINTR)) {
+				LOG(ERROR) << "epoll_wait failed (" << strerror(errno) << ")";
+				delay(100);
+			}
+			for (int i = 0;i<n;i++) {
+				std::unique_lock<std::mutex> lock(portsMutex);
+				std::map<int, SerialPort*>::iterator port = ports.find(events[i].data.fd);
+				if (port == ports.end())
+					continue;
+				if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+					// device is gone, stop polling it to not spin on the hangup
+					LOG(ERROR) << "serial device hang up";
+					epoll_ctl(epollFd, EPOLL_CTL_DEL, port->first, NULL);
+					ports.erase(port);
+					continue;
+				}
+				port->second->dataAvailable();
+			}
+		}
+	}
+
+	int epollFd;
+	std::mutex portsMutex;
+	std::map<int, SerialPort*> ports;
+	std::thread* reactorThread;
+};
+
+// termios speed constant of a baud rate
+static speed_t baudFlag(int baudRate) {
+	switch (baudRate) {
+		case 9600:		return B9600;
+		case 19200:		return B19200;
+		case 38400:		return B38400;
+		case 57600:		return B57600;
+		case 115200:	return B115200;
+		case 230400:	return B230400;
+		default:		return B0;
+	}
+}
+
+SerialPort::SerialPort() {
+	fd = -1;
+}
+
+SerialPort::~SerialPort() {
+	disconnect();
+}
+
+bool SerialPort::connect( string device, int baudRate) {
+	// absolute paths are taken as they are, e.g. the pseudo terminal of the CortexEmulator
+	string path = (device.compare(0, 1, "/") == 0)?device:"/dev/" + device;
+	fd = open(path.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if (fd < 0) {
+		LOG(ERROR) << "port " << path << " not available (" << strerror(errno) << ")";
+		return false;
+	}
+
+	struct termios config;
+	memset(&config, 0, sizeof(config));
+	tcgetattr(fd, &config);
+	config.c_iflag &= ~(INLCR | ICRNL | IXON | IXOFF | ISTRIP);
+	config.c_iflag |= IGNPAR | IGNBRK;
+	config.c_oflag &= ~(OPOST | ONLCR | OCRNL);
+	config.c_cflag &= ~(PARENB | PARODD | CSTOPB | CSIZE | CRTSCTS);
+	config.c_cflag |= CLOCAL | CREAD | CS8;
+	config.c_lflag &= ~(ICANON | ISIG | ECHO | IEXTEN);
+	cfsetospeed(&config, baudFlag(baudRate));
+	cfsetispeed(&config, baudFlag(baudRate));
+
+	// read returns immediately with whatever is there, waiting is done by epoll
+	config.c_cc[VMIN]  = 0;
+	config.c_cc[VTIME] = 0;
+	if (tcsetattr(fd, TCSANOW, &config) < 0) {
+		LOG(ERROR) << "port " << path << " found, but configuration failed (" << strerror(errno) << ")";
+		close(fd);
+		fd = -1;
+		return false;
+	}
+	tcflush(fd, TCIOFLUSH);
+
+	SerialReactor::getInstance().add(this);
+	return true;
+}
+
+void SerialPort::disconnect(void) {
+	if (fd >= 0) {
+		LOG(DEBUG) << "disconnect from serial port";
+		SerialReactor::getInstance().remove(this);
+		close(fd);
+		fd = -1;
+	}
+}
+
+int SerialPort::sendArray(char *buffer, int len) {
+	int bytesWritten = 0;
+	while (bytesWritten < len) {
+		int res = write(fd, buffer + bytesWritten, len - bytesWritten);
+		if (res > 0)
+			bytesWritten += res;
+		else if ((res < 0) && (errno == EAGAIN)) {
+			// output buffer full, wait until the uart drained it a bit
+			struct pollfd pfd = { fd, POLLOUT, 0 };
+			poll(&pfd, 1, 10);
+		} else
+			break;
+	}
+	return bytesWritten;
+}
+
+// called by the reactor whenever data is waiting
+void SerialPort::dataAvailable() {
+	const int BufferSize = 256;
+	char buffer[BufferSize];
+	string str;
+	int bytesRead;
+	while ((bytesRead = read(fd, buffer, BufferSize)) > 0)
+		str.append(buffer, bytesRead);
+	if (str.empty())
+		return;
+
+	if (callback)
+		callback(str);
+	else {
+		std::unique_lock<std::mutex> lock(receivedMutex);
+		received += str;
+		receivedCondition.notify_all();
+	}
+}
+
+int SerialPort::receive(string& str) {
+	std::unique_lock<std::mutex> lock(receivedMutex);
+	str.swap(received);
+	received.clear();
+	return str.length();
+}
+
+int SerialPort::receive(string& str, int timeout_ms) {
+	std::unique_lock<std::mutex> lock(receivedMutex);
+	if (received.empty() && (timeout_ms > 0))
+		receivedCondition.wait_for(lock, std::chrono::milliseconds(timeout_ms), [this]{ return !received.empty(); });
+	str.swap(received);
+	received.clear();
+	return str.length();
+}
+
+void SerialPort::onReceive(ReceiveCallback pCallback) {
+	callback = pCallback;
+}
+
+void SerialPort::clear() {
+	if (fd >= 0)
+		tcflush(fd, TCIFLUSH);
+	std::unique_lock<std::mutex> lock(receivedMutex);
+	received.clear();
+}
+
+#endif
+
+int SerialPort::sendString(string str) {
+	str += newlineStr;
+	int written = sendArray((char*)str.c_str(), str.length());
+	return written;
+}
+
+int SerialPort::sendBinary(const uint8_t* buffer, int len) {
+	return sendArray((char*)buffer, len);
+}
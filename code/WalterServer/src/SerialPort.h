@@ -1,7 +1,9 @@
 /*
  * SerialPort.h
  *
- * Encapsulation class for communicating with the Cortex via serial connection. Uses a portable library underneath.
+ * Encapsulation class for communicating with the Cortex via serial connection.
+ * On Linux, ports are non-blocking file descriptors served by one reactor thread (epoll),
+ * on Windows a portable library is used underneath.
  *
  * Author: JochenAlt
  */
@@ -10,6 +12,11 @@
 #define SERIALPORT_H_
 
 #include <string>
+#include <stdint.h>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
 
 using namespace std;
 
@@ -19,20 +26,44 @@ class SerialPort {
 private:
 
 public:
+	// called by the reactor thread with everything that arrived
+	typedef std::function<void(const string& str)> ReceiveCallback;
+
 	SerialPort();
 	~SerialPort();
 
 	bool connect (string device, int baudRate);
 	void disconnect(void);
 	int sendString(string str);
+	int sendBinary(const uint8_t* buffer, int len); // no newline added
+
+	// returns what has been received so far, does not wait
 	int receive(string& str);
+	// waits until something has been received or timeout_ms passed
+	int receive(string& str, int timeout_ms);
+	// pass received data to callback instead of collecting it for receive
+	void onReceive(ReceiveCallback callback);
 
 	void clear();
 private:
 	int sendArray(char *buffer, int len);
+
+#ifdef _WIN32
 	int getArray (char *buffer, int len);
+	void callbackLoop();
 
 	int _port;
+	std::thread* callbackThread = NULL;
+#else
+	friend class SerialReactor;
+	void dataAvailable();
+
+	int fd;
+	string received;				// data received by the reactor, not yet picked up by receive
+	std::mutex receivedMutex;
+	std::condition_variable receivedCondition;
+#endif
+	ReceiveCallback callback;
 };
 
 #endif /* SERIALPORT_H_ */
@@ -0,0 +1,84 @@
+/*
+ * ThreadSync.h
+ *
+ * Lock-free exchange between the http thread and the motion thread:
+ * a single-producer/single-consumer queue for commands and a seqlock for state snapshots.
+ * Neither of them blocks the motion thread.
+ *
+ * Author: JochenAlt
+ */
+
+#ifndef THREADSYNC_H_
+#define THREADSYNC_H_
+
+#include <atomic>
+
+// Ring buffer with one producer and one consumer thread. Capacity-1 elements can be queued.
+template<typename T, int Capacity>
+class SPSCQueue {
+public:
+	SPSCQueue() : head(0), tail(0) {};
+
+	// called by the producer only. Returns false if queue is full
+	bool push(T& element) {
+		int currTail = tail.load(std::memory_order_relaxed);
+		int nextTail = (currTail + 1) % Capacity;
+		if (nextTail == head.load(std::memory_order_acquire))
+			return false;
+		elements[currTail] = std::move(element);
+		tail.store(nextTail, std::memory_order_release);
+		return true;
+	}
+
+	// called by the consumer only. Returns false if queue is empty
+	bool pop(T& element) {
+		int currHead = head.load(std::memory_order_relaxed);
+		if (currHead == tail.load(std::memory_order_acquire))
+			return false;
+		element = std::move(elements[currHead]);
+		head.store((currHead + 1) % Capacity, std::memory_order_release);
+		return true;
+	}
+
+	bool empty() {
+		return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+	}
+private:
+	T elements[Capacity];
+	std::atomic<int> head;	// next element to pop
+	std::atomic<int> tail;	// next free slot
+};
+
+// One writer publishes a value, readers get a consistent copy without ever blocking the writer.
+// Readers retry if the writer was active while copying, so T should be plain data that is cheap to copy.
+template<typename T>
+class SeqLock {
+public:
+	SeqLock() : sequence(0) {};
+
+	// called by the writer thread only
+	void write(const T& pValue) {
+		unsigned seq = sequence.load(std::memory_order_relaxed);
+		sequence.store(seq + 1, std::memory_order_relaxed); // odd: write in progress
+		std::atomic_thread_fence(std::memory_order_release);
+		value = pValue;
+		sequence.store(seq + 2, std::memory_order_release);
+	}
+
+	T read() {
+		T result;
+		unsigned seqBefore, seqAfter;
+		do {
+			seqBefore = sequence.load(std::memory_order_acquire);
+			result = value;
+			std::atomic_thread_fence(std::memory_order_acquire);
+			seqAfter = sequence.load(std::memory_order_relaxed);
+		} while ((seqBefore & 1) || (seqBefore != seqAfter));
+		return result;
+	}
+private:
+	std::atomic<unsigned> sequence;
+	T value;
+};
+
+#endif /* THREADSYNC_H_ */
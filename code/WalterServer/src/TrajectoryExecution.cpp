@@ -1,11 +1,39 @@
 #include "logger.h"
+#include <math.h>
+#include <sstream>
+#include <iomanip>
+#ifndef _WIN32
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#endif
 
 #include "TrajectoryExecution.h"
 #include "CortexController.h"
 #include "CmdDispatcher.h"
 
+const int MoveAheadSamples = 3;		// poses are reached that many samples after they have been sent
+const int MotionCommandTimeout_ms = 30000;	// http thread gives up waiting for the motion thread, startupBot takes the longest
+
+void JitterStatistics::add(double jitter_us) {
+	samples++;
+	sum_us += jitter_us;
+	sumSquares_us += jitter_us*jitter_us;
+	max_us = max(max_us, fabs(jitter_us));
+}
+
+string JitterStatistics::toString() {
+	std::ostringstream s;
+	double mean = (samples > 0)?sum_us/samples:0;
+	double stddev = (samples > 1)?sqrt(max(0.0, sumSquares_us/samples - mean*mean)):0;
+	s << std::fixed << std::setprecision(1)
+	  << "samples=" << samples << " mean=" << mean << "us stddev=" << stddev << "us max=" << max_us << "us";
+	return s.str();
+}
+
 TrajectoryExecution::TrajectoryExecution() {
 	lastLoopInvocation = 0;
+	jitter.reset();
 }
 
 TrajectoryExecution& TrajectoryExecution::getInstance() {
@@ -34,15 +62,199 @@ string TrajectoryExecution::currentTrajectoryNodeToString(int &indent) {
 	return node.toString(indent);
 }
 
-void TrajectoryExecution::runTrajectory(const string& trajectoryStr) {
-	Trajectory& traj = getTrajectory();
+bool TrajectoryExecution::requestTrajectory(const string& trajectoryStr) {
+	// parse and compile here in the http thread, the motion thread gets the result only
+	Trajectory* traj = new Trajectory();
 	int idx = 0;
-	bool ok = traj.fromString(trajectoryStr, idx);
+	bool ok = traj->fromString(trajectoryStr, idx);
 	if (!ok)
 		LOG(ERROR) << "parse error trajectory";
-	traj.compile();
 
-	playTrajectory();
+	// if the planner sent the compiled samples too, take them if they have been compiled
+	// out of the same trajectory with the same kinematics. Otherwise compile on our own.
+	int samplesIdx = idx;
+	if (!(ok && traj->samplesFromString(trajectoryStr, samplesIdx, Trajectory::getCompilationHash(trajectoryStr.substr(0,idx)))))
+		traj->compile();
+
+	std::shared_ptr<MotionReply> reply = std::make_shared<MotionReply>();
+	std::future<void> done = reply->done.get_future();
+	MotionCommand cmd;
+	cmd.type = MotionCommand::RUN_TRAJECTORY;
+	cmd.trajectory = traj;
+	cmd.reply = reply;
+	if (!commandQueue.push(cmd)) {
+		LOG(ERROR) << "motion command queue full";
+		delete traj;
+		return false;
+	}
+	wakeUpMotionThread();
+	if (done.wait_for(std::chrono::milliseconds(MotionCommandTimeout_ms)) != std::future_status::ready) {
+		LOG(ERROR) << "motion thread did not take the trajectory";
+		setError(WEBSERVER_TIMEOUT);
+		return false;
+	}
+	return reply->ok;
+}
+
+bool TrajectoryExecution::request(MotionCommand::CommandType type, const string& param, string& response) {
+	std::shared_ptr<MotionReply> reply = std::make_shared<MotionReply>();
+	std::future<void> done = reply->done.get_future();
+	MotionCommand cmd;
+	cmd.type = type;
+	cmd.param = param;
+	cmd.trajectory = NULL;
+	cmd.reply = reply;
+	if (!commandQueue.push(cmd)) {
+		LOG(ERROR) << "motion command queue full";
+		setError(UNKNOWN_ERROR);
+		return false;
+	}
+	wakeUpMotionThread();
+	if (done.wait_for(std::chrono::milliseconds(MotionCommandTimeout_ms)) != std::future_status::ready) {
+		LOG(ERROR) << "motion thread did not respond";
+		setError(WEBSERVER_TIMEOUT);
+		return false;
+	}
+
+	// errors are per thread, take over the motion thread's error
+	resetError();
+	setError(reply->error);
+	response = reply->response;
+	return reply->ok;
+}
+
+void TrajectoryExecution::wakeUpMotionThread() {
+	// take the mutex, otherwise the notification might get lost right before the motion thread waits
+	{ std::lock_guard<std::mutex> lock(commandMutex); }
+	commandPending.notify_one();
+}
+
+void TrajectoryExecution::execute(MotionCommand& cmd) {
+	resetError();
+	MotionReply* reply = cmd.reply.get();
+	reply->ok = true;
+	switch (cmd.type) {
+		case MotionCommand::DIRECT_ACCESS:
+			directAccess(cmd.param, reply->response, reply->ok);
+			break;
+		case MotionCommand::STARTUP_BOT:
+			reply->ok = startupBot();
+			break;
+		case MotionCommand::TEARDOWN_BOT:
+			reply->ok = teardownBot();
+			break;
+		case MotionCommand::NULL_POSITION_BOT:
+			reply->ok = moveToNullPosition();
+			break;
+		case MotionCommand::EMERGENCY_STOP_BOT:
+			reply->ok = emergencyStopBot();
+			break;
+		case MotionCommand::SET_ANGLES:
+			reply->ok = setAnglesAsString(cmd.param);
+			break;
+		case MotionCommand::RUN_TRAJECTORY:
+			getTrajectory() = *cmd.trajectory;
+			delete cmd.trajectory;
+			lastMoveValid = false;
+			playTrajectory();
+			break;
+		case MotionCommand::STOP_TRAJECTORY:
+			stopTrajectory();
+			break;
+		default:
+			reply->ok = false;
+	}
+	reply->error = getLastError();
+	publishState();
+	reply->done.set_value();
+}
+
+void TrajectoryExecution::publishState() {
+	MotionState s;
+	s.pose = getCurrentPose();
+	s.botIsUpAndRunning = botIsUpAndRunning;
+	s.jitter = jitter;
+	s.lateness = getLateness();
+	state.write(s);
+}
+
+void TrajectoryExecution::setRealtimePriority() {
+#ifndef _WIN32
+	// FIFO scheduling requires root or CAP_SYS_NICE
+	struct sched_param param;
+	param.sched_priority = sched_get_priority_max(SCHED_FIFO)/2;
+	int res = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+	if (res != 0)
+		LOG(WARNING) << "SCHED_FIFO not permitted (" << strerror(res) << "), motion thread runs with normal priority";
+
+	// pin to the last core, http thread and serial reactor remain on the others
+	int cores = std::thread::hardware_concurrency();
+	if (cores > 1) {
+		cpu_set_t cpuSet;
+		CPU_ZERO(&cpuSet);
+		CPU_SET(cores-1, &cpuSet);
+		res = pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+		if (res != 0)
+			LOG(WARNING) << "pinning motion thread failed (" << strerror(res) << ")";
+	}
+#endif
+}
+
+void TrajectoryExecution::startMotionThread(int pSampleRate) {
+	TrajectoryPlayer::setup(pSampleRate);
+	publishState();
+	if (motionThread == NULL)
+		motionThread = new std::thread(&TrajectoryExecution::motionLoop, this);
+}
+
+void TrajectoryExecution::motionLoop() {
+	setRealtimePriority();
+
+	bool cortexOk = false;
+	bool cortexSetup = false;
+	uint32_t lastTimeCortexSetup = millis();
+	while (true) {
+		MotionCommand cmd;
+		while (commandQueue.pop(cmd))
+			execute(cmd);
+
+		if (cortexOk) {
+			loop();
+			publishState();
+
+			// Cortex did not respond anymore, renegotiate checksum, frames and stream sequence numbers
+			if (!CortexController::getInstance().communicationOk()) {
+				LOG(ERROR) << "Communication with cortex lost, reconnecting";
+				cortexOk = false;
+			}
+		}
+		else {
+			if ((uint32_t)millis() - lastTimeCortexSetup > 1000) {
+				// after the first setup, reconnect only and keep the player's pose
+				if (cortexSetup)
+					cortexOk = CortexController::getInstance().setupCommunication();
+				else
+					cortexOk = cortexSetup = setup(getSampleRate());
+				lastTimeCortexSetup = millis();
+				if (cortexOk) {
+					LOG(INFO) << "Cortex initialized successfully";
+				} else {
+					string error = getLastErrorMessage();
+					LOG(ERROR) << "Communication with cortex failed (" << error.c_str();
+					CommandDispatcher::getInstance().addAlert("communication with Walters cortex failed");
+				}
+			}
+		}
+
+		// sleep until the next sample is due or a command comes in. The deadline is absolute
+		// on the monotonic clock, so the time spent in loop() does not shift the next sample
+		microseconds deadline = getNextSampleDeadline();
+		std::unique_lock<std::mutex> lock(commandMutex);
+		if ((deadline < 0) || !cortexOk)
+			commandPending.wait_for(lock, std::chrono::milliseconds(100), [this]{ return !commandQueue.empty(); });
+		else
+			commandPending.wait_until(lock, MonotonicClock::toTimePoint(deadline), [this]{ return !commandQueue.empty(); });
+	}
 }
 
 void TrajectoryExecution::setPose(const string& poseStr) {
@@ -82,21 +294,24 @@ void TrajectoryExecution::loop() {
 
 // is called by TrajectoryPlayer whenever a new pose is set. Call the cortex and hands over the next coordinates
 void TrajectoryExecution::notifyNewPose(const Pose& pPose) {
-	// ensure that we are not called more often then TrajectorySampleRate
+	// while a trajectory is played, the player's deadlines define the rate. Otherwise (angles set
+	// via the UI) ensure that we are not called more often then TrajectorySampleRate
 	uint32_t now = millis();
 
-	// move the bot to the passed position within the next TrajectorySampleRate ms.
-	if (now>=lastLoopInvocation+getSampleRate()) {
-		// take care that we call the uC with BotTrajectorySampleRate, so add
-		// BotTrajectorySampleRate not to now, but to lastInvocation (otherwise timeing errors would sum up)
-		if (lastLoopInvocation<now-getSampleRate())
-			lastLoopInvocation = now;
-		else
-			lastLoopInvocation += getSampleRate();
+	// move the bot to the passed position, reached MoveAheadSamples samples later
+	if (isOn() || (now>=lastLoopInvocation+getSampleRate())) {
+		lastLoopInvocation = now;
 
 		if (CortexController::getInstance().communicationOk()){
-			int duration = getSampleRate()*200/100; // add 10% in case of timing issues
-			bool ok = CortexController::getInstance().move(pPose.angles, duration);
+			// jitter of MOVETOs while a trajectory is played
+			std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			if (isOn() && lastMoveValid)
+				jitter.add(std::chrono::duration<double, std::micro>(now - lastMoveTime).count() - getSampleRate()*1000.0);
+			lastMoveTime = now;
+			lastMoveValid = isOn();
+
+			// Cortex queues the poses, being a few samples ahead keeps the bot moving when a sample comes late
+			bool ok = CortexController::getInstance().moveAt(pPose.angles, millis() + MoveAheadSamples*getSampleRate());
 			heartbeatSend = ok;
 		} else
 			heartbeatSend = false; // no heartbeat when communication is down
@@ -9,13 +9,76 @@
 #ifndef TRAJECTORYMGR_H_
 #define TRAJECTORYMGR_H_
 
+#include <thread>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+
 #include "TrajectoryPlayer.h"
+#include "ThreadSync.h"
+#include "core.h"
+
+// deviation of the actual MOVETO interval from the sample rate
+struct JitterStatistics {
+	long samples;
+	double sum_us;
+	double sumSquares_us;
+	double max_us;
+
+	void reset() { samples = 0; sum_us = 0; sumSquares_us = 0; max_us = 0; }
+	void add(double jitter_us);
+	string toString();
+};
+
+// state of the motion thread, published for the http thread
+struct MotionState {
+	Pose pose;
+	bool botIsUpAndRunning;
+	JitterStatistics jitter;
+	LatenessHistogram lateness;
+};
+
+// result of a MotionCommand, filled by the motion thread. Shared with the http thread,
+// which might have given up waiting already
+struct MotionReply {
+	std::promise<void> done;
+	bool ok;
+	ErrorCodeType error;
+	string response;
+};
+
+// request passed from the http thread to the motion thread
+struct MotionCommand {
+	enum CommandType { DIRECT_ACCESS, STARTUP_BOT, TEARDOWN_BOT, NULL_POSITION_BOT, EMERGENCY_STOP_BOT,
+					   SET_ANGLES, RUN_TRAJECTORY, STOP_TRAJECTORY };
+	CommandType type;
+	string param;
+	Trajectory* trajectory;		// RUN_TRAJECTORY only, compiled by the http thread, deleted by the motion thread
+	std::shared_ptr<MotionReply> reply;
+};
 
+// Moves the bot. All methods except the request methods below run in the motion thread, which
+// is the only one talking to the cortex. The http thread passes commands via a lock-free queue
+// and reads the state via a seqlock, so web traffic does not delay the next MOVETO.
 class TrajectoryExecution : public TrajectoryPlayer {
 public:
 	TrajectoryExecution();
 	static TrajectoryExecution& getInstance();
 
+	// start the motion thread, which sets up the cortex communication and plays trajectories
+	void startMotionThread(int pSampleRate /* [ms] */);
+
+	// called by the http thread, waits until the motion thread executed the command or MotionCommandTimeout_ms passed
+	bool request(MotionCommand::CommandType type, const string& param, string& response);
+
+	// called by the http thread. Parses and compiles the trajectory, then passes it to the motion thread.
+	// If the trajectory string is followed by the compiled samples, these are taken instead of compiling the trajectory
+	bool requestTrajectory(const string& trajectory);
+
+	// latest state of the motion thread, called by the http thread
+	MotionState getState() { return state.read(); };
+
 	// call this upfront before doing anything.
 	bool setup(int pSampleDuration /* [ms] */);
 
@@ -35,9 +98,6 @@ public:
 	// set the current angles in stringified form
 	bool setAnglesAsString(string angles);
 
-	// set the current trajectory to be player
-	void runTrajectory(const string& trajectory);
-
 	// set the current pose to the bot
 	void setPose(const string& pose);
 
@@ -62,10 +122,26 @@ public:
 	bool heartBeatSendOp();
 
 private:
+	void motionLoop();
+	void wakeUpMotionThread();
+	void execute(MotionCommand& cmd);
+	void publishState();
+	void setRealtimePriority();
+
 	uint32_t lastLoopInvocation = 0;
 	bool botIsUpAndRunning = false;
 	bool heartbeatSend = false;
 
+	std::thread* motionThread = NULL;
+	SPSCQueue<MotionCommand, 16> commandQueue;
+	std::mutex commandMutex;				// used for sleeping until the next command or sample only
+	std::condition_variable commandPending;
+	SeqLock<MotionState> state;
+
+	JitterStatistics jitter;
+	std::chrono::steady_clock::time_point lastMoveTime;
+	bool lastMoveValid = false;				// lastMoveTime belongs to the currently played trajectory
+
 };
 
 
@@ -10,6 +10,7 @@
 
 #include "core.h"
 #include "CmdDispatcher.h"
+#include "CortexController.h"
 #include "Util.h"
 #include "setup.h"
 
@@ -18,8 +19,12 @@ INITIALIZE_EASYLOGGINGPP
 
 static struct mg_serve_http_opts s_http_server_opts;
 
+// a /stream client whose socket has more than this queued gets no push until it caught up
+const size_t StreamMaxBacklog = 64*1024;
+
 #include <stdlib.h>
 #include <ctype.h>
+#include <algorithm>
 
 
 // called when ^C is pressed
@@ -89,22 +94,100 @@ static void ev_handler(struct mg_connection *nc, int ev, void *ev_data)
     			}
     		break;
     	}
+    	case MG_EV_WEBSOCKET_HANDSHAKE_REQUEST: {
+    		struct http_message *hm = (struct http_message *) ev_data;
+    		string uri(hm->uri.p, hm->uri.len);
+    		if (uri.compare("/stream") != 0) {
+    			mg_printf(nc, "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+    			nc->flags |= MG_F_SEND_AND_CLOSE;
+    			break;
+    		}
+    		char topics[64] = "";
+    		mg_get_http_var(&hm->query_string, "topics", topics, sizeof(topics));
+    		StreamClient* client = new StreamClient();
+    		CommandDispatcher::getInstance().initStreamClient(*client, topics);
+    		nc->user_data = client;
+    		break;
+    	}
+    	case MG_EV_CLOSE: {
+    		if (nc->flags & MG_F_IS_WEBSOCKET) {
+    			delete (StreamClient*) nc->user_data;
+    			nc->user_data = NULL;
+    		}
+    		break;
+    	}
     default:
         break;
     }
 }
 
+// push changes to all /stream clients. Clients that do not keep up are skipped, they get
+// everything they missed with the next push once their socket drained
+static void pushStreamUpdates(struct mg_mgr* mgr) {
+	for (struct mg_connection* c = mg_next(mgr, NULL); c != NULL; c = mg_next(mgr, c)) {
+		if (!(c->flags & MG_F_IS_WEBSOCKET) || (c->user_data == NULL))
+			continue;
+		if (c->send_mbuf.len > StreamMaxBacklog)
+			continue;
+		string update = CommandDispatcher::getInstance().getStreamUpdateJson(*(StreamClient*)c->user_data);
+		if (!update.empty())
+			mg_send_websocket_frame(c, WEBSOCKET_OP_TEXT, update.c_str(), update.length());
+	}
+}
 
-int main(void) {
+
+char* getCmdOption(char ** begin, char ** end, const std::string & option)
+{
+    char ** itr = std::find(begin, end, option);
+    if (itr != end && ++itr != end)
+    {
+        return *itr;
+    }
+    return 0;
+}
+
+bool cmdOptionExists(char** begin, char** end, const std::string& option)
+{
+    return std::find(begin, end, option) != end;
+}
+
+void printUsage(string prg) {
+	cout << "usage: " << prg << " [-h] [-p <port>] [-cmd <device>] [-log <device>]" << endl
+		 << "   [-h]                help" << endl
+		 << "   [-p <port>]         http port (default " << SERVER_PORT << ")" << endl
+		 << "   [-cmd <device>]     command port of cortex (default " << CORTEX_COMMAND_SERIAL_PORT << ")" << endl
+		 << "   [-log <device>]     log port of cortex (default " << CORTEX_LOGGER_SERIAL_PORT << ")" << endl
+		 << "   devices are in /dev unless the path is absolute, e.g. a pseudo terminal of the CortexEmulator" << endl;
+}
+
+int main(int argc, char *argv[]) {
 	struct mg_mgr mgr;
 	struct mg_connection *nc = NULL;
 	cs_stat_t st;
 
+	if(cmdOptionExists(argv, argv+argc, "-h")) {
+		printUsage(argv[0]);
+		exit(0);
+    }
+	int serverPort = SERVER_PORT;
+	char* option = getCmdOption(argv, argv + argc, "-p");
+	if (option)
+		serverPort = atoi(option);
+	string cmdDevice = CORTEX_COMMAND_SERIAL_PORT;
+	option = getCmdOption(argv, argv + argc, "-cmd");
+	if (option)
+		cmdDevice = option;
+	string logDevice = CORTEX_LOGGER_SERIAL_PORT;
+	option = getCmdOption(argv, argv + argc, "-log");
+	if (option)
+		logDevice = option;
+	CortexController::getInstance().setSerialPorts(cmdDevice, logDevice);
+
 	mg_mgr_init(&mgr, NULL);
-	string serverport_s = int_to_string(SERVER_PORT);
+	string serverport_s = int_to_string(serverPort);
 	nc = mg_bind(&mgr, serverport_s.c_str(), ev_handler);
 	if (nc == NULL) {
-		LOG(ERROR) << "Cannot bind to " << SERVER_PORT;
+		LOG(ERROR) << "Cannot bind to " << serverPort;
 		exit(1);
 	}
 
@@ -125,30 +208,20 @@ int main(void) {
 	// initialize kinematics and trajectory compilation
 	Kinematics::getInstance().setup();
 
-	// initialize communication to cortex
-	bool cortexOk = false;
+	// communication to cortex and playing trajectories runs in its own thread
+	TrajectoryExecution::getInstance().startMotionThread(CortexSampleRate);
 
-	LOG(INFO) << "Walter's webserver running on port " << SERVER_PORT;
+	LOG(INFO) << "Walter's webserver running on port " << serverPort;
 
-	// ToDo change this loop to two threads running on different cores
-	int lastTimeCortexSetup = millis();
+	// this thread serves http requests and pushes to /stream clients with the motion sample rate
+	uint32_t lastPush = millis();
 	while (true) {
-		if (cortexOk)
-			TrajectoryExecution::getInstance().loop();
-		else {
-			if (millis()> lastTimeCortexSetup+1000 ) {
-				cortexOk = TrajectoryExecution::getInstance().setup(CortexSampleRate);
-				lastTimeCortexSetup = millis();
-				if (cortexOk) {
-					LOG(INFO) << "Cortex initialized successfully";
-				} else {
-					string error = getLastErrorMessage();
-					LOG(ERROR) << "Communication with cortex failed (" << error.c_str();
-					CommandDispatcher::getInstance().addAlert("communication with Walters cortex failed");
-				}
-			}
+		int wait_ms = CortexSampleRate - (int)(millis() - lastPush);
+		mg_mgr_poll(&mgr, max(wait_ms, 0));
+		if ((int)(millis() - lastPush) >= CortexSampleRate) {
+			lastPush = millis();
+			pushStreamUpdates(&mgr);
 		}
-		mg_mgr_poll(&mgr, 10); // check every 10ms for incoming requests
 	}
 	mg_mgr_free(&mgr);
 
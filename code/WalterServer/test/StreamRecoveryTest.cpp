@@ -0,0 +1,124 @@
+/*
+ * StreamRecoveryTest.cpp
+ *
+ * Runs the motion thread against the Cortex emulator and interrupts the line while MOVETO
+ * frames are streamed. The stream has to give up, and the motion thread has to renegotiate
+ * checksum, binary frames and sequence numbers once the line is back.
+ *
+ * usage: stream_test [<emulator binary>]
+ *
+ * Author: JochenAlt
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <csignal>
+#include <string>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "core.h"
+#include "setup.h"
+#include "Util.h"
+#include "Kinematics.h"
+#include "CortexController.h"
+#include "TrajectoryExecution.h"
+#include "logger.h"
+
+INITIALIZE_EASYLOGGINGPP
+
+using namespace std;
+
+const string cmdLink = "/tmp/stream-test-cmd";
+const string logLink = "/tmp/stream-test-log";
+
+static int failures = 0;
+
+#define EXPECT(condition) \
+	if (!(condition)) { \
+		printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+		failures++; \
+	}
+
+// wait until the communication with Cortex is in the passed state, at most timeout_ms
+static bool waitForCommunication(bool ok, int timeout_ms) {
+	milliseconds start = millis();
+	while (CortexController::getInstance().communicationOk() != ok) {
+		if (millis() - start > timeout_ms)
+			return false;
+		delay(10);
+	}
+	return true;
+}
+
+// move joint 0 a bit, returns true if the MOVETO went out
+static bool setAngles(int no) {
+	string response;
+	string angles = "angles {0=" + to_string(0.001*(no % 100)) + " 1=0.2 2=-0.2 3=0.2 4=0.2 5=0 6=0.61 }";
+	bool ok = TrajectoryExecution::getInstance().request(MotionCommand::SET_ANGLES, angles, response);
+	delay(CortexSampleRate + 10); // otherwise the next pose is not sent
+	return ok;
+}
+
+// all frames sent so far have been acknowledged, a text command flushes the stream upfront
+static bool echo() {
+	string response;
+	return TrajectoryExecution::getInstance().request(MotionCommand::DIRECT_ACCESS, "ECHO 42", response);
+}
+
+int main(int argc, char *argv[]) {
+	string emulatorBinary = (argc > 1) ? argv[1] : "../../CortexEmulator/cortex_emulator";
+
+	el::Configurations conf;
+	conf.setToDefault();
+	conf.setGlobally(el::ConfigurationType::Enabled, "false");
+	el::Loggers::reconfigureAllLoggers(conf);
+
+	pid_t emulator = fork();
+	if (emulator == 0) {
+		freopen("/dev/null", "w", stdout);
+		execl(emulatorBinary.c_str(), emulatorBinary.c_str(), "-cmd", cmdLink.c_str(), "-log", logLink.c_str(), (char*)NULL);
+		perror(emulatorBinary.c_str());
+		exit(1);
+	}
+	delay(500);
+
+	Kinematics::getInstance().setup();
+	CortexController::getInstance().setSerialPorts(cmdLink, logLink);
+	TrajectoryExecution::getInstance().startMotionThread(CortexSampleRate);
+	EXPECT(waitForCommunication(true, 5000));
+
+	int no = 0;
+	int sent = 0;
+	for (int i = 0;i<10;i++)
+		sent += setAngles(no++)?1:0;
+	EXPECT(sent == 10);
+	EXPECT(echo());
+
+	// line goes down while the stream is running, the stream gives up after a couple of resends
+	kill(emulator, SIGUSR1);
+	for (int i = 0;(i<100) && CortexController::getInstance().communicationOk();i++)
+		setAngles(no++);
+	EXPECT(!CortexController::getInstance().communicationOk());
+
+	// line is back, motion thread reconnects and the stream starts with sequence number 0 again
+	kill(emulator, SIGUSR1);
+	EXPECT(waitForCommunication(true, 5000));
+	sent = 0;
+	for (int i = 0;i<20;i++)
+		sent += setAngles(no++)?1:0;
+	EXPECT(sent == 20);
+	EXPECT(echo());
+	EXPECT(CortexController::getInstance().communicationOk());
+
+	kill(emulator, SIGTERM);
+	waitpid(emulator, NULL, 0);
+
+	// the motion thread runs forever, leave without destructing the singletons it uses
+	if (failures > 0)
+		printf("StreamRecoveryTest: %d checks failed\n", failures);
+	else
+		printf("StreamRecoveryTest: ok\n");
+	fflush(stdout);
+	_exit(failures > 0 ? 1 : 0);
+}